@@ -0,0 +1,263 @@
+#ifndef _FLAT_AGGREGATE_MAP_H_INCLUDED_2026_10_19
+#define _FLAT_AGGREGATE_MAP_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <limits>
+#include "flat_map.h"
+
+/*
+ * Flat map with range aggregates of values
+ *
+ * Flat aggregate map features
+ * - A flat_map with a segment tree over its values, the map is a private base so that
+ *   every change of the elements is seen by the tree
+ * - aggregate() of any key range or iterator range in O(log n)
+ * - The aggregate operation is any associative function object with an identity:
+ *   flat_sum, flat_min, flat_max or a user supplied one
+ * - The tree is built at the end of sort(), or by the first aggregate() after
+ *   insert() and erase()
+ * - set_value() changes a value and updates the tree in O(log n), values changed
+ *   through iterators need invalidate()
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+template<typename T>
+struct flat_sum
+{
+	T identity() const { return T(); }
+	T operator() (const T& a, const T& b) const { return a + b; }
+};
+
+template<typename T>
+struct flat_min
+{
+	T identity() const { return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : (std::numeric_limits<T>::max)(); }
+	T operator() (const T& a, const T& b) const { return b < a ? b : a; }
+};
+
+template<typename T>
+struct flat_max
+{
+	T identity() const { return std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : (std::numeric_limits<T>::min)(); }
+	T operator() (const T& a, const T& b) const { return a < b ? b : a; }
+};
+
+template<typename key_type, typename val_type, typename op_type = flat_sum<val_type>, typename search_type = flat_search_binary>
+class flat_aggregate_map : private flat_map<key_type, val_type, search_type>
+{
+	typedef flat_map<key_type, val_type, search_type> base_type;
+
+public:
+	typedef typename base_type::pair_type pair_type;
+	typedef typename base_type::iterator iterator;
+	typedef typename base_type::iterator_pair iterator_pair;
+	typedef typename base_type::lazy_iterator lazy_iterator;
+
+	// the flat_map is a private base, every call that changes its elements goes through
+	// this class; sort_first() and the lazy iteration reorder only an unsorted map,
+	// whose tree is invalid already
+	using base_type::reserve;
+	using base_type::find;
+	using base_type::lower_bound;
+	using base_type::upper_bound;
+	using base_type::equal_range;
+	using base_type::empty;
+	using base_type::size;
+	using base_type::begin;
+	using base_type::end;
+	using base_type::split;
+	using base_type::search;
+	using base_type::capacity;
+	using base_type::set_shrink_threshold;
+	using base_type::shrink_to_fit;
+	using base_type::sort_first;
+	using base_type::first_k;
+	using base_type::nth_key;
+	using base_type::lazy_begin;
+	using base_type::lazy_end;
+
+	flat_aggregate_map(const op_type &op = op_type()) : m_op(op), m_bBuilt(false) {};
+
+	void clear();
+	void insert(const pair_type &p);
+	void insert(const key_type &k, const val_type &v);
+	iterator erase(const key_type &k);
+	iterator erase(iterator i0);
+	iterator erase(iterator i0, iterator i1);
+	void swap(flat_aggregate_map& other);
+	void sort(bool bPriorityFirstUnique = false);
+	void adopt_sorted(std::vector<pair_type> &v);
+
+	// aggregate of the values with keys in [k0, k1]
+	val_type aggregate(const key_type &k0, const key_type &k1);
+	// aggregate of the values in [i0, i1)
+	val_type aggregate(iterator i0, iterator i1);
+	// number of keys in [k0, k1]
+	size_t count(const key_type &k0, const key_type &k1);
+	size_t count(const key_type &k) { return base_type::count(k); }
+
+	void set_value(iterator it, const val_type &v);
+	void invalidate() { m_bBuilt = false; }
+
+	size_t memory_usage() const { return base_type::memory_usage() + m_tree.capacity()*sizeof(val_type); }
+
+private:
+	void build();
+
+	op_type m_op;
+	std::vector<val_type> m_tree;	// leaves are at [n, 2n), node i aggregates 2i and 2i+1
+	bool m_bBuilt;
+};
+
+//------------------------------------- flat_aggregate_map -----------------------------------------
+
+template<typename key_type, typename val_type, typename op_type, typename search_type>
+inline void flat_aggregate_map<key_type, val_type, op_type, search_type>::clear()
+{
+	base_type::clear();
+	m_tree.clear();
+	m_bBuilt = false;
+}
+
+template<typename key_type, typename val_type, typename op_type, typename search_type>
+inline void flat_aggregate_map<key_type, val_type, op_type, search_type>::insert(const pair_type &p)
+{
+	base_type::insert(p);
+	m_bBuilt = false;
+}
+
+template<typename key_type, typename val_type, typename op_type, typename search_type>
+inline void flat_aggregate_map<key_type, val_type, op_type, search_type>::insert(const key_type &k, const val_type &v)
+{
+	base_type::insert(k, v);
+	m_bBuilt = false;
+}
+
+template<typename key_type, typename val_type, typename op_type, typename search_type>
+inline typename flat_aggregate_map<key_type, val_type, op_type, search_type>::iterator flat_aggregate_map<key_type, val_type, op_type, search_type>::erase(const key_type &k)
+{
+	iterator it = base_type::find(k);
+	if (it == base_type::end()) return it;
+	return erase(it);
+}
+
+template<typename key_type, typename val_type, typename op_type, typename search_type>
+inline typename flat_aggregate_map<key_type, val_type, op_type, search_type>::iterator flat_aggregate_map<key_type, val_type, op_type, search_type>::erase(iterator i0)
+{
+	m_bBuilt = false;
+	return base_type::erase(i0);
+}
+
+template<typename key_type, typename val_type, typename op_type, typename search_type>
+inline typename flat_aggregate_map<key_type, val_type, op_type, search_type>::iterator flat_aggregate_map<key_type, val_type, op_type, search_type>::erase(iterator i0, iterator i1)
+{
+	m_bBuilt = false;
+	return base_type::erase(i0, i1);
+}
+
+template<typename key_type, typename val_type, typename op_type, typename search_type>
+inline void flat_aggregate_map<key_type, val_type, op_type, search_type>::swap(flat_aggregate_map<key_type, val_type, op_type, search_type>& other)
+{
+	base_type::swap(other);
+	std::swap(m_op, other.m_op);
+	m_tree.swap(other.m_tree);
+	std::swap(m_bBuilt, other.m_bBuilt);
+}
+
+template<typename key_type, typename val_type, typename op_type, typename search_type>
+void inline flat_aggregate_map<key_type, val_type, op_type, search_type>::sort(bool bPriorityFirstUnique /*= false*/)
+{
+	base_type::sort(bPriorityFirstUnique);
+	build();
+}
+
+template<typename key_type, typename val_type, typename op_type, typename search_type>
+inline void flat_aggregate_map<key_type, val_type, op_type, search_type>::adopt_sorted(std::vector<pair_type> &v)
+{
+	base_type::adopt_sorted(v);
+	m_bBuilt = false;
+}
+
+template<typename key_type, typename val_type, typename op_type, typename search_type>
+inline void flat_aggregate_map<key_type, val_type, op_type, search_type>::build()
+{
+	iterator i0 = base_type::begin();
+	size_t n = base_type::end() - i0;
+	m_tree.resize(2 * n);
+	for (size_t i = 0; i < n; i++)
+		m_tree[n + i] = i0[i].second;
+	for (size_t i = n; i-- > 1; )
+		m_tree[i] = m_op(m_tree[2 * i], m_tree[2 * i + 1]);
+	m_bBuilt = true;
+}
+
+template<typename key_type, typename val_type, typename op_type, typename search_type>
+inline val_type flat_aggregate_map<key_type, val_type, op_type, search_type>::aggregate(iterator i0, iterator i1)
+{
+	if (!m_bBuilt) build();
+	size_t n = m_tree.size() / 2;
+	size_t l = (i0 - base_type::begin()) + n;
+	size_t r = (i1 - base_type::begin()) + n;
+
+	// left and right parts are kept apart, the operation needs not be commutative
+	val_type vl = m_op.identity();
+	val_type vr = m_op.identity();
+	for (; l < r; l >>= 1, r >>= 1)
+	{
+		if (l & 1) vl = m_op(vl, m_tree[l++]);
+		if (r & 1) vr = m_op(m_tree[--r], vr);
+	}
+	return m_op(vl, vr);
+}
+
+template<typename key_type, typename val_type, typename op_type, typename search_type>
+inline val_type flat_aggregate_map<key_type, val_type, op_type, search_type>::aggregate(const key_type &k0, const key_type &k1)
+{
+	if (k1 < k0) return m_op.identity();
+	iterator i0 = base_type::lower_bound(k0);
+	return aggregate(i0, base_type::upper_bound(k1));
+}
+
+template<typename key_type, typename val_type, typename op_type, typename search_type>
+inline size_t flat_aggregate_map<key_type, val_type, op_type, search_type>::count(const key_type &k0, const key_type &k1)
+{
+	if (k1 < k0) return 0;
+	iterator i0 = base_type::lower_bound(k0);
+	return base_type::upper_bound(k1) - i0;
+}
+
+template<typename key_type, typename val_type, typename op_type, typename search_type>
+inline void flat_aggregate_map<key_type, val_type, op_type, search_type>::set_value(iterator it, const val_type &v)
+{
+	it->second = v;
+	if (!m_bBuilt) return;
+	size_t i = (it - base_type::begin()) + m_tree.size() / 2;
+	m_tree[i] = v;
+	for (i >>= 1; i > 0; i >>= 1)
+		m_tree[i] = m_op(m_tree[2 * i], m_tree[2 * i + 1]);
+}
+
+#endif // _FLAT_AGGREGATE_MAP_H_INCLUDED_2026_10_19
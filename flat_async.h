@@ -0,0 +1,287 @@
+#ifndef _FLAT_ASYNC_H_INCLUDED_2026_10_19
+#define _FLAT_ASYNC_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <thread>
+#include <functional>
+#include "flat_map.h"
+
+/*
+ * Flat map sorted in the background (C++11)
+ *
+ * Flat async map features
+ * - insert() stages elements, sort_async() merges them into a new sorted map
+ *   on a background thread or a user executor and publishes it when done
+ * - Lookups never sort: they search the published map, and while a sort
+ *   is running they either wait for it or scan the elements being sorted
+ * - One writer thread calls insert(), sort_async(), sort(), wait() and clear(),
+ *   any number of threads may call the lookups and snapshot()
+ * - A sort that throws publishes nothing, its elements are staged again and
+ *   the next wait(), sort() or sort_async() rethrows the exception
+ * - LOOKUP_WAIT lookups, wait() and the destructor block until the sort has run:
+ *   an executor must run its tasks on its own, one that queues them for the
+ *   calling thread deadlocks there and needs LOOKUP_SCAN and a run before wait()
+ * - Staged elements are not visible before sort_async(), the last insert
+ *   of a key wins as in flat_map
+ * - While a sort runs the old and the new map both exist
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+template<typename key_type, typename val_type, typename search_type = flat_search_binary>
+class flat_async_map
+{
+public:
+	typedef flat_map<key_type, val_type, search_type> map_type;
+	typedef typename map_type::pair_type pair_type;
+	typedef std::function<void(std::function<void()>)> executor_type;
+
+	// what a lookup does while a sort is running
+	enum { LOOKUP_WAIT, LOOKUP_SCAN };
+
+	flat_async_map(int nLookupMode = LOOKUP_WAIT) : m_current(std::make_shared<map_type>()), m_nLookupMode(nLookupMode) {};
+	~flat_async_map() { try { wait(); } catch (...) {} }
+
+	// writer only, lookups running meanwhile keep the mode they started with
+	void set_lookup_mode(int nLookupMode);
+	// writer only, runs the sorts, by default each sort runs on a new thread
+	void set_executor(const executor_type &executor) { m_executor = executor; }
+
+	void reserve(size_t size) { m_staging.reserve(size); }
+	void insert(const pair_type &p) { m_staging.push_back(p); }
+	void insert(const key_type &k, const val_type &v) { m_staging.push_back(pair_type(k, v)); }
+	size_t staged() const { return m_staging.size(); }
+	void clear();
+
+	// starts merging the staged elements into the map, waits for a running sort first
+	void sort_async();
+	void sort() { sort_async(); wait(); }
+	// waits for a running sort and rethrows its exception
+	void wait();
+	bool ready() const;
+
+	bool find(const key_type &k, val_type &v) const;
+	size_t count(const key_type &k) const { val_type v; return find(k, v) ? 1 : 0; }
+	// the published map, it does not change and stays valid while it is held
+	std::shared_ptr<map_type> snapshot() const;
+
+	flat_async_map(const flat_async_map&) = delete;
+	flat_async_map &operator=(const flat_async_map&) = delete;
+
+private:
+	typedef std::vector<pair_type> pairs_type;
+
+	static std::shared_ptr<map_type> merge(const std::shared_ptr<map_type> &current, const pairs_type &tail);
+
+	mutable std::mutex m_mutex;
+	std::shared_ptr<map_type> m_current;
+	std::shared_ptr<const pairs_type> m_sorting;	// elements of the running sort
+	std::shared_ptr<const pairs_type> m_failed;	// elements of a sort that threw, staged again by wait()
+	std::shared_future<void> m_future;
+	pairs_type m_staging;
+	executor_type m_executor;
+	int m_nLookupMode;		// guarded by m_mutex, lookups read it from any thread
+};
+
+template<typename key_type, typename val_type, typename search_type>
+inline std::shared_ptr<typename flat_async_map<key_type, val_type, search_type>::map_type>
+	flat_async_map<key_type, val_type, search_type>::merge(const std::shared_ptr<map_type> &current, const pairs_type &tail)
+{
+	// the tail is sorted by the lazy append path of a flat_map, the last insert wins
+	map_type sorted;
+	sorted.reserve(tail.size());
+	for (size_t i = 0; i < tail.size(); i++)
+		sorted.insert(tail[i]);
+
+	std::vector<pair_type> ar;
+	ar.reserve(current->size() + sorted.size());
+	typename map_type::iterator it = current->begin();
+	for (typename map_type::iterator itTail = sorted.begin(); itTail != sorted.end(); ++itTail)
+	{
+		for (; it != current->end() && it->first < itTail->first; ++it)
+			ar.push_back(*it);
+		if (it != current->end() && !(itTail->first < it->first))
+			++it;
+		ar.push_back(*itTail);
+	}
+	ar.insert(ar.end(), it, current->end());
+
+	std::shared_ptr<map_type> result = std::make_shared<map_type>();
+	result->adopt_sorted(ar);
+	return result;
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline void flat_async_map<key_type, val_type, search_type>::sort_async()
+{
+	wait();
+	if (m_staging.empty())
+		return;
+
+	std::shared_ptr<pairs_type> tail = std::make_shared<pairs_type>();
+	tail->swap(m_staging);
+	std::shared_ptr<map_type> current = snapshot();
+	std::shared_ptr<std::packaged_task<void()> > task = std::make_shared<std::packaged_task<void()> >([this, current, tail]()
+	{
+		std::shared_ptr<map_type> result;
+		try
+		{
+			result = merge(current, *tail);
+		}
+		catch (...)
+		{
+			// the packaged task keeps the exception for wait()
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_failed = tail;
+			m_sorting.reset();
+			throw;
+		}
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_current = result;
+		m_sorting.reset();
+	});
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_sorting = tail;
+		m_future = task->get_future().share();
+	}
+	try
+	{
+		if (m_executor)
+			m_executor([task]() { (*task)(); });
+		else
+			std::thread([task]() { (*task)(); }).detach();
+	}
+	catch (...)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_sorting.reset();
+			m_future = std::shared_future<void>();
+		}
+		m_staging.insert(m_staging.begin(), tail->begin(), tail->end());
+		throw;
+	}
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline void flat_async_map<key_type, val_type, search_type>::wait()
+{
+	std::shared_future<void> future;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		future = m_future;
+	}
+	if (!future.valid())
+		return;
+	future.wait();
+
+	std::shared_ptr<const pairs_type> failed;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		failed.swap(m_failed);
+		m_future = std::shared_future<void>();
+	}
+	// the elements of a failed sort are older than the ones staged since
+	if (failed)
+		m_staging.insert(m_staging.begin(), failed->begin(), failed->end());
+	future.get();
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline void flat_async_map<key_type, val_type, search_type>::set_lookup_mode(int nLookupMode)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_nLookupMode = nLookupMode;
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline bool flat_async_map<key_type, val_type, search_type>::ready() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return !m_sorting;
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline void flat_async_map<key_type, val_type, search_type>::clear()
+{
+	// the elements of a failed sort are dropped with the rest
+	try { wait(); } catch (...) {}
+	m_staging.clear();
+	std::shared_ptr<map_type> empty = std::make_shared<map_type>();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_current = empty;
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline std::shared_ptr<typename flat_async_map<key_type, val_type, search_type>::map_type> flat_async_map<key_type, val_type, search_type>::snapshot() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_current;
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline bool flat_async_map<key_type, val_type, search_type>::find(const key_type &k, val_type &v) const
+{
+	std::shared_ptr<map_type> current;
+	std::shared_ptr<const pairs_type> sorting;
+	std::shared_future<void> future;
+	int nLookupMode;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		current = m_current;
+		sorting = m_sorting;
+		future = m_future;
+		nLookupMode = m_nLookupMode;
+	}
+	if (sorting)
+	{
+		if (nLookupMode == LOOKUP_WAIT)
+		{
+			future.wait();
+			current = snapshot();
+		}
+		else
+		{
+			// the elements being sorted are newer than the published ones
+			for (size_t i = sorting->size(); i-- > 0; )
+				if ((*sorting)[i].first == k)
+				{
+					v = (*sorting)[i].second;
+					return true;
+				}
+		}
+	}
+	typename map_type::iterator it = current->find(k);
+	if (it == current->end())
+		return false;
+	v = it->second;
+	return true;
+}
+
+#endif // _FLAT_ASYNC_H_INCLUDED_2026_10_19
@@ -0,0 +1,855 @@
+#include "flat_set.h"
+#include "flat_map.h"
+#include "flat_packed_set.h"
+#include "flat_roaring_set.h"
+#include "small_flat_map.h"
+#include "flat_string_map.h"
+#include "flat_blocked_map.h"
+#include "flat_map_builder.h"
+#include "flat_aggregate_map.h"
+#include "flat_grouped_multimap.h"
+#include "flat_rle_multiset.h"
+#include "flat_numa.h"
+#include "flat_durable_map.h"
+#include "flat_async.h"
+#include "flat_parallel.h"
+#include "flat_versioned_map.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <functional>
+
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+/*
+ * Benchmarks of flat containers (C++11)
+ *
+ * g++ -O2 -std=c++11 -pthread flat_benchmark.cpp -o flat_benchmark
+ * flat_benchmark [number of elements] [number of emulated NUMA nodes]
+ */
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double elapsed_ms(bench_clock::time_point t0)
+{
+	return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+template<class S>
+static double bench_count(S &set, const std::vector<uint64_t> &queries, size_t &nFound)
+{
+	set.begin(); // sorts and builds the search index
+	bench_clock::time_point t0 = bench_clock::now();
+	for (size_t i = 0; i < queries.size(); i++)
+		nFound += set.count(queries[i]);
+	return elapsed_ms(t0) * 1e6 / queries.size();
+}
+
+template<class S>
+static void fill_set(S &set, const std::vector<uint64_t> &keys)
+{
+	set.reserve(keys.size());
+	for (size_t i = 0; i < keys.size(); i++)
+		set.insert(keys[i]);
+}
+
+// Lookup cost of search policies on uniform and skewed key distributions
+static void bench_search(size_t n)
+{
+	printf("search policies, %lu keys, ns per count()\n", static_cast<unsigned long>(n));
+	printf("  %-10s %12s %14s %12s %12s\n", "keys", "binary", "interpolation", "learned", "hash");
+
+	std::mt19937_64 rng(42);
+	const char *names[] = { "uniform", "skewed" };
+	for (int d = 0; d < 2; d++)
+	{
+		std::vector<uint64_t> keys(n);
+		for (size_t i = 0; i < n; i++)
+		{
+			double u = static_cast<double>(rng() >> 11) / 9007199254740992.;
+			if (d == 1) u = u * u * u * u;
+			keys[i] = static_cast<uint64_t>(u * 1e15);
+		}
+
+		// half of the queries hit, half are random misses
+		std::vector<uint64_t> queries(n);
+		for (size_t i = 0; i < n; i++)
+			queries[i] = (i & 1) ? keys[rng() % n] : static_cast<uint64_t>(rng() % 1000000000000000ULL);
+
+		flat_set<uint64_t> set0;
+		flat_set<uint64_t, flat_search_interpolation> set1;
+		flat_set<uint64_t, flat_search_learned> set2;
+		flat_set<uint64_t, flat_search_hash<> > set3;
+		fill_set(set0, keys);
+		fill_set(set1, keys);
+		fill_set(set2, keys);
+		fill_set(set3, keys);
+
+		size_t n0 = 0, n1 = 0, n2 = 0, n3 = 0;
+		double t0 = bench_count(set0, queries, n0);
+		double t1 = bench_count(set1, queries, n1);
+		double t2 = bench_count(set2, queries, n2);
+		double t3 = bench_count(set3, queries, n3);
+		printf("  %-10s %12.1f %14.1f %12.1f %12.1f%s\n", names[d], t0, t1, t2, t3,
+			(n0 == n1 && n0 == n2 && n0 == n3) ? "" : "  MISMATCH");
+	}
+}
+
+// Memory and lookup cost of the compressed set against flat_set
+static void bench_packed(size_t n)
+{
+	std::mt19937_64 rng(7);
+	std::vector<uint64_t> keys(n);
+	uint64_t v = 1ULL << 40;
+	for (size_t i = 0; i < n; i++)
+		keys[i] = (v += 1 + rng() % 64);
+
+	std::vector<uint64_t> queries(n);
+	for (size_t i = 0; i < n; i++)
+		queries[i] = keys[rng() % n] + (i & 1);
+
+	flat_set<uint64_t> set0;
+	flat_packed_set<uint64_t> set1;
+	fill_set(set0, keys);
+	fill_set(set1, keys);
+	size_t n0 = 0, n1 = 0;
+	double t0 = bench_count(set0, queries, n0);
+	double t1 = bench_count(set1, queries, n1);
+
+	printf("packed set, %lu keys with gaps below 64\n", static_cast<unsigned long>(n));
+	printf("  %-16s %14s %12s\n", "", "bytes per key", "ns/count()");
+	printf("  %-16s %14.2f %12.1f\n", "flat_set", 8.0, t0);
+	printf("  %-16s %14.2f %12.1f%s\n", "flat_packed_set", static_cast<double>(set1.memory_usage()) / n, t1,
+		n0 == n1 ? "" : "  MISMATCH");
+}
+
+// Membership checks on a dense set of 32 bit values
+static void bench_roaring(size_t n)
+{
+	std::mt19937_64 rng(11);
+	std::vector<uint64_t> keys(n);
+	for (size_t i = 0; i < n; i++)
+		keys[i] = rng() % (n * 4);
+
+	std::vector<uint64_t> queries(n);
+	for (size_t i = 0; i < n; i++)
+		queries[i] = rng() % (n * 4);
+
+	flat_set<uint32_t> set0;
+	flat_roaring_set set1;
+	set0.reserve(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		set0.insert(static_cast<uint32_t>(keys[i]));
+		set1.insert(static_cast<uint32_t>(keys[i]));
+	}
+	set0.begin();
+	set1.sort();
+
+	size_t n0 = 0, n1 = 0;
+	bench_clock::time_point t = bench_clock::now();
+	for (size_t i = 0; i < n; i++)
+		n0 += set0.count(static_cast<uint32_t>(queries[i]));
+	double t0 = elapsed_ms(t) * 1e6 / n;
+	t = bench_clock::now();
+	for (size_t i = 0; i < n; i++)
+		n1 += set1.count(static_cast<uint32_t>(queries[i]));
+	double t1 = elapsed_ms(t) * 1e6 / n;
+
+	printf("roaring set, %lu random values below %lu\n", static_cast<unsigned long>(n), static_cast<unsigned long>(n * 4));
+	printf("  %-16s %14s %12s\n", "", "bytes per key", "ns/count()");
+	printf("  %-16s %14.2f %12.1f\n", "flat_set", 4.0, t0);
+	printf("  %-16s %14.2f %12.1f%s\n", "flat_roaring_set", static_cast<double>(set1.memory_usage()) / set1.size(), t1,
+		n0 == n1 ? "" : "  MISMATCH");
+}
+
+// Building and querying many tiny maps
+template<class M>
+static double bench_tiny_maps(size_t nMaps, size_t nKeys, size_t &nFound)
+{
+	std::vector<M> maps(nMaps);
+	bench_clock::time_point t0 = bench_clock::now();
+	for (size_t i = 0; i < nMaps; i++)
+	{
+		for (size_t k = 0; k < nKeys; k++)
+			maps[i].insert(static_cast<int>((i + k * 7) % 16), static_cast<int>(k));
+		nFound += maps[i].count(static_cast<int>(i % 16));
+	}
+	return elapsed_ms(t0);
+}
+
+static void bench_small(size_t n)
+{
+	size_t nMaps = n / 8;
+	size_t n0 = 0, n1 = 0;
+	double t0 = bench_tiny_maps<flat_map<int, int> >(nMaps, 8, n0);
+	double t1 = bench_tiny_maps<small_flat_map<int, int, 16> >(nMaps, 8, n1);
+
+	printf("small maps, %lu maps of 8 keys, build and one count()\n", static_cast<unsigned long>(nMaps));
+	printf("  %-16s %12s\n", "", "ms");
+	printf("  %-16s %12.1f\n", "flat_map", t0);
+	printf("  %-16s %12.1f%s\n", "small_flat_map", t1, n0 == n1 ? "" : "  MISMATCH");
+}
+
+// Lookups of URL like keys with long common prefixes
+static void bench_strings(size_t n)
+{
+	std::mt19937_64 rng(13);
+	const char *hosts[] = { "https://example.com/api/v1/", "https://metrics.example.org/", "cpu.load.", "disk." };
+	std::vector<std::string> keys(n);
+	for (size_t i = 0; i < n; i++)
+		keys[i] = hosts[rng() % 4] + std::to_string(rng() % (n * 2));
+
+	std::vector<std::string> queries(n);
+	for (size_t i = 0; i < n; i++)
+		queries[i] = (i & 1) ? keys[rng() % n] : hosts[rng() % 4] + std::to_string(rng() % (n * 2));
+
+	flat_map<std::string, int> map0;
+	flat_string_map<int> map1;
+	map0.reserve(n);
+	map1.reserve(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		map0.insert(keys[i], static_cast<int>(i));
+		map1.insert(keys[i], static_cast<int>(i));
+	}
+
+	size_t nMem0 = n * sizeof(std::pair<std::string, int>);
+	for (flat_map<std::string, int>::iterator it = map0.begin(); it != map0.end(); ++it)
+		if (it->first.capacity() > 15) nMem0 += it->first.capacity() + 1;
+
+	size_t n0 = 0, n1 = 0;
+	bench_clock::time_point t = bench_clock::now();
+	for (size_t i = 0; i < n; i++)
+		n0 += map0.count(queries[i]);
+	double t0 = elapsed_ms(t) * 1e6 / n;
+	map1.begin();
+	t = bench_clock::now();
+	for (size_t i = 0; i < n; i++)
+		n1 += map1.count(queries[i]);
+	double t1 = elapsed_ms(t) * 1e6 / n;
+
+	printf("string map, %lu URL like keys\n", static_cast<unsigned long>(n));
+	printf("  %-16s %14s %12s\n", "", "bytes per key", "ns/count()");
+	printf("  %-16s %14.2f %12.1f\n", "flat_map", static_cast<double>(nMem0) / map0.size(), t0);
+	printf("  %-16s %14.2f %12.1f%s\n", "flat_string_map", static_cast<double>(map1.memory_usage()) / map1.size(), t1,
+		n0 == n1 ? "" : "  MISMATCH");
+}
+
+// In place updates and a full scan of a large map
+template<class M>
+static void bench_updates(M &map, const std::vector<uint64_t> &keys, size_t nOps, double &tUpdate, double &tScan, uint64_t &nSum)
+{
+	for (size_t i = 0; i < keys.size(); i++)
+		map.insert(keys[i], i);
+	map.begin();
+
+	bench_clock::time_point t = bench_clock::now();
+	for (size_t i = 0; i < nOps; i++)
+	{
+		typename M::iterator it = map.find(keys[i * 7919 % keys.size()]);
+		if (it != map.end()) map.erase(it);
+		map.insert(keys[i * 7919 % keys.size()] + 1, i);
+		nSum += map.count(keys[i]);
+	}
+	tUpdate = elapsed_ms(t) * 1e6 / nOps;
+
+	t = bench_clock::now();
+	for (typename M::iterator it = map.begin(); it != map.end(); ++it)
+		nSum += it->second;
+	tScan = elapsed_ms(t) * 1e6 / keys.size();
+}
+
+static void bench_blocked(size_t n)
+{
+	std::mt19937_64 rng(17);
+	std::vector<uint64_t> keys(n);
+	for (size_t i = 0; i < n; i++)
+		keys[i] = rng() << 1;
+
+	double tUpdate0, tUpdate1, tScan0, tScan1;
+	uint64_t nSum0 = 0, nSum1 = 0;
+	flat_map<uint64_t, uint64_t> map0;
+	flat_blocked_map<uint64_t, uint64_t> map1;
+	bench_updates(map0, keys, 200, tUpdate0, tScan0, nSum0);
+	bench_updates(map1, keys, 200, tUpdate1, tScan1, nSum1);
+
+	printf("blocked map, %lu keys, erase + insert + count\n", static_cast<unsigned long>(n));
+	printf("  %-16s %12s %12s\n", "", "ns/update", "ns/element");
+	printf("  %-16s %12.1f %12.2f\n", "flat_map", tUpdate0, tScan0);
+	printf("  %-16s %12.1f %12.2f%s\n", "flat_blocked_map", tUpdate1, tScan1, nSum0 == nSum1 ? "" : "  MISMATCH");
+}
+
+// Building one map from the elements of several producer threads
+static void bench_builder(size_t n)
+{
+	const size_t nProducers = 8;
+	std::mt19937_64 rng(19);
+	std::vector<uint64_t> keys(n);
+	for (size_t i = 0; i < n; i++)
+		keys[i] = rng() % (n * 4);
+
+	bench_clock::time_point t = bench_clock::now();
+	flat_map<uint64_t, uint64_t> map0;
+	map0.reserve(n);
+	for (size_t i = 0; i < n; i++)
+		map0.insert(keys[i], i);
+	map0.begin();
+	double t0 = elapsed_ms(t);
+
+	t = bench_clock::now();
+	flat_map_builder<uint64_t, uint64_t> builder(nProducers);
+	std::vector<std::thread> threads;
+	for (size_t p = 0; p < nProducers; p++)
+		threads.push_back(std::thread([&, p]()
+		{
+			for (size_t i = p * n / nProducers; i < (p + 1) * n / nProducers; i++)
+				builder.insert(p, keys[i], i);
+		}));
+	for (size_t p = 0; p < nProducers; p++)
+		threads[p].join();
+	flat_map<uint64_t, uint64_t> map1;
+	builder.build(map1);
+	double t1 = elapsed_ms(t);
+
+	printf("bulk build, %lu elements, %lu producers, %u hardware threads\n", static_cast<unsigned long>(n),
+		static_cast<unsigned long>(nProducers), std::thread::hardware_concurrency());
+	printf("  %-16s %12s\n", "", "ms");
+	printf("  %-16s %12.1f\n", "flat_map", t0);
+	printf("  %-16s %12.1f%s\n", "flat_map_builder", t1,
+		(map0.size() == map1.size() && std::equal(map0.begin(), map0.end(), map1.begin())) ? "" : "  MISMATCH");
+}
+
+// Sums of values over key ranges of a time series
+static void bench_aggregate(size_t n)
+{
+	std::mt19937_64 rng(23);
+	flat_aggregate_map<uint64_t, double> map1;
+	map1.reserve(n);
+	for (size_t i = 0; i < n; i++)
+		map1.insert(i * 1000 + rng() % 1000, static_cast<double>(rng() % 100));
+	map1.sort();
+
+	const size_t nQueries = 1000;
+	std::vector<uint64_t> ranges(2 * nQueries);
+	for (size_t i = 0; i < nQueries; i++)
+	{
+		ranges[2 * i] = rng() % (n * 1000);
+		ranges[2 * i + 1] = ranges[2 * i] + n * 100;
+	}
+
+	double s0 = 0, s1 = 0;
+	bench_clock::time_point t = bench_clock::now();
+	for (size_t i = 0; i < nQueries; i++)
+	{
+		flat_aggregate_map<uint64_t, double>::iterator it1 = map1.upper_bound(ranges[2 * i + 1]);
+		for (flat_aggregate_map<uint64_t, double>::iterator it = map1.lower_bound(ranges[2 * i]); it != it1; ++it)
+			s0 += it->second;
+	}
+	double t0 = elapsed_ms(t) * 1e6 / nQueries;
+	t = bench_clock::now();
+	for (size_t i = 0; i < nQueries; i++)
+		s1 += map1.aggregate(ranges[2 * i], ranges[2 * i + 1]);
+	double t1 = elapsed_ms(t) * 1e6 / nQueries;
+
+	printf("range sums, %lu points, ranges of %lu points\n", static_cast<unsigned long>(n), static_cast<unsigned long>(n / 10));
+	printf("  %-16s %12s\n", "", "ns/query");
+	printf("  %-16s %12.1f\n", "iteration", t0);
+	printf("  %-16s %12.1f%s\n", "aggregate()", t1, s0 == s1 ? "" : "  MISMATCH");
+}
+
+// count() and memory of a multimap with about 64 values per key
+static void bench_grouped(size_t n)
+{
+	std::mt19937_64 rng(29);
+	size_t nKeys = n / 64 + 1;
+	flat_multimap<uint64_t, uint64_t> map0;
+	flat_grouped_multimap<uint64_t, uint64_t> map1;
+	map0.reserve(n);
+	map1.reserve(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		uint64_t k = (rng() % nKeys) * 1000;
+		map0.insert(k, i);
+		map1.insert(k, i);
+	}
+
+	std::vector<uint64_t> queries(n);
+	for (size_t i = 0; i < n; i++)
+		queries[i] = (rng() % nKeys) * 1000 + (i & 1);
+	size_t n0 = 0, n1 = 0;
+	double t0 = bench_count(map0, queries, n0);
+	double t1 = bench_count(map1, queries, n1);
+
+	printf("grouped multimap, %lu values of %lu keys\n", static_cast<unsigned long>(n), static_cast<unsigned long>(nKeys));
+	printf("  %-22s %14s %12s\n", "", "bytes per value", "ns/count()");
+	printf("  %-22s %14.2f %12.1f\n", "flat_multimap", static_cast<double>(sizeof(std::pair<uint64_t, uint64_t>)), t0);
+	printf("  %-22s %14.2f %12.1f%s\n", "flat_grouped_multimap", static_cast<double>(map1.memory_usage()) / n, t1,
+		n0 == n1 ? "" : "  MISMATCH");
+}
+
+// Building a histogram like multiset of 1000 distinct values
+static void bench_rle(size_t n)
+{
+	std::mt19937_64 rng(31);
+	std::vector<uint64_t> keys(n);
+	for (size_t i = 0; i < n; i++)
+		keys[i] = rng() % 1000;
+
+	bench_clock::time_point t = bench_clock::now();
+	flat_multiset<uint64_t> set0;
+	for (size_t i = 0; i < n; i++)
+		set0.insert(keys[i]);
+	set0.begin();
+	double t0 = elapsed_ms(t);
+
+	t = bench_clock::now();
+	flat_rle_multiset<uint64_t> set1;
+	for (size_t i = 0; i < n; i++)
+		set1.insert(keys[i]);
+	set1.begin();
+	double t1 = elapsed_ms(t);
+
+	printf("rle multiset, %lu values, 1000 distinct\n", static_cast<unsigned long>(n));
+	printf("  %-18s %12s %12s\n", "", "bytes", "build ms");
+	printf("  %-18s %12lu %12.1f\n", "flat_multiset", static_cast<unsigned long>(n * sizeof(uint64_t)), t0);
+	printf("  %-18s %12lu %12.1f%s\n", "flat_rle_multiset", static_cast<unsigned long>(set1.memory_usage()), t1,
+		set0.count(500) == set1.count(500) ? "" : "  MISMATCH");
+}
+
+// Lookups of which 80% are misses, with and without a Bloom filter
+static void bench_bloom(size_t n)
+{
+	std::mt19937_64 rng(37);
+	std::vector<uint64_t> keys(n);
+	for (size_t i = 0; i < n; i++)
+		keys[i] = rng();
+	std::vector<uint64_t> queries(n);
+	for (size_t i = 0; i < n; i++)
+		queries[i] = (i % 5 == 0) ? keys[rng() % n] : rng();
+
+	flat_set<uint64_t> set0;
+	flat_set<uint64_t, flat_search_bloom<> > set1;
+	fill_set(set0, keys);
+	fill_set(set1, keys);
+	size_t n0 = 0, n1 = 0;
+	double t0 = bench_count(set0, queries, n0);
+	double t1 = bench_count(set1, queries, n1);
+
+	printf("bloom filter, %lu keys, 80%% misses\n", static_cast<unsigned long>(n));
+	printf("  %-16s %14s %12s\n", "", "bytes per key", "ns/count()");
+	printf("  %-16s %14.2f %12.1f\n", "binary", 0., t0);
+	printf("  %-16s %14.2f %12.1f%s\n", "bloom", static_cast<double>(set1.search().memory_usage()) / n, t1,
+		n0 == n1 ? "" : "  MISMATCH");
+}
+
+// Lookups from threads on all nodes, one shared map against per node replicas
+static void bench_numa(size_t n, size_t nEmulatedNodes)
+{
+	flat_numa_topology topology = nEmulatedNodes == 0 ? flat_numa_topology() : flat_numa_topology(nEmulatedNodes);
+	std::mt19937_64 rng(41);
+	flat_map<uint64_t, uint64_t> map0;
+	map0.reserve(n);
+	for (size_t i = 0; i < n; i++)
+		map0.insert(rng() % (n * 2), i);
+	map0.begin();
+	flat_numa_map<uint64_t, uint64_t> map1(topology);
+	map1.freeze(map0);
+
+	// one thread per CPU, bound to the node of the CPU
+	std::vector<size_t> threadNodes;
+	for (size_t node = 0; node < topology.nodes(); node++)
+		for (size_t i = 0; i < topology.cpus(node).size(); i++)
+			threadNodes.push_back(node);
+	std::vector<uint64_t> queries(n);
+	for (size_t i = 0; i < n; i++)
+		queries[i] = rng() % (n * 2);
+
+	size_t n0 = 0, n1 = 0;
+	double t[2];
+	for (int nRun = 0; nRun < 2; nRun++)
+	{
+		std::vector<size_t> found(threadNodes.size() * 8, 0);
+		bench_clock::time_point t0 = bench_clock::now();
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < threadNodes.size(); i++)
+			threads.push_back(std::thread([&, i]()
+			{
+				topology.bind_thread(threadNodes[i]);
+				size_t nFound = 0;
+				for (size_t q = 0; q < queries.size(); q++)
+					nFound += nRun == 0 ? map0.count(queries[q]) : map1.count(queries[q]);
+				found[i * 8] = nFound;
+			}));
+		for (size_t i = 0; i < threads.size(); i++)
+			threads[i].join();
+		t[nRun] = elapsed_ms(t0) * 1e6 / n;
+		for (size_t i = 0; i < threadNodes.size(); i++)
+			(nRun == 0 ? n0 : n1) += found[i * 8];
+	}
+
+	printf("numa lookups, %lu elements, %lu nodes%s, %lu threads\n", static_cast<unsigned long>(n),
+		static_cast<unsigned long>(topology.nodes()), topology.emulated() ? " (emulated)" : "",
+		static_cast<unsigned long>(threadNodes.size()));
+	printf("  %-16s %14s %12s\n", "", "bytes", "ns/count()");
+	printf("  %-16s %14lu %12.1f\n", "shared flat_map", static_cast<unsigned long>(map0.size() * sizeof(std::pair<uint64_t, uint64_t>)), t[0]);
+	printf("  %-16s %14lu %12.1f%s\n", "flat_numa_map", static_cast<unsigned long>(map1.memory_usage()), t[1],
+		n0 == n1 ? "" : "  MISMATCH");
+}
+
+// Logging inserts, checkpoint and recovery from a checkpoint or from the log alone
+static void bench_durable(size_t n)
+{
+	const char *szPath = "flat_benchmark_durable";
+	remove("flat_benchmark_durable.ckpt");
+	remove("flat_benchmark_durable.wal");
+	std::mt19937_64 rng(43);
+	double t[4];
+	size_t nLogBytes, nSize[2];
+	{
+		flat_durable_map<uint64_t, uint64_t> map1;
+		map1.open(szPath);
+		map1.set_group_commit(1024);
+		map1.set_sync_batch(64);
+		bench_clock::time_point t0 = bench_clock::now();
+		for (size_t i = 0; i < n; i++)
+			map1.insert(rng(), i);
+		map1.commit();
+		t[0] = elapsed_ms(t0);
+		nLogBytes = map1.log_bytes();
+
+		t0 = bench_clock::now();
+		map1.close();
+		flat_durable_map<uint64_t, uint64_t> map2;
+		map2.open(szPath);
+		t[1] = elapsed_ms(t0);
+
+		t0 = bench_clock::now();
+		map2.checkpoint();
+		t[2] = elapsed_ms(t0);
+		nSize[0] = map2.size();
+	}
+	bench_clock::time_point t0 = bench_clock::now();
+	flat_durable_map<uint64_t, uint64_t> map3;
+	map3.open(szPath);
+	t[3] = elapsed_ms(t0);
+	nSize[1] = map3.size();
+	map3.close();
+	remove("flat_benchmark_durable.ckpt");
+	remove("flat_benchmark_durable.wal");
+
+	double nMB = n * sizeof(std::pair<uint64_t, uint64_t>) / 1e6;
+	printf("durable map, %lu elements, %.1f MB of elements, %.1f MB of log\n", static_cast<unsigned long>(n), nMB, nLogBytes / 1e6);
+	printf("  %-20s %12s %12s\n", "", "ms", "MB/s");
+	printf("  %-20s %12.1f %12.1f\n", "logged inserts", t[0], nMB * 1e3 / t[0]);
+	printf("  %-20s %12.1f %12.1f\n", "recovery from log", t[1], nMB * 1e3 / t[1]);
+	printf("  %-20s %12.1f %12.1f\n", "checkpoint", t[2], nMB * 1e3 / t[2]);
+	printf("  %-20s %12.1f %12.1f%s\n", "recovery from ckpt", t[3], nMB * 1e3 / t[3], nSize[0] == nSize[1] ? "" : "  MISMATCH");
+}
+
+// The 10 smallest keys of an unsorted map: full sort against incremental sorting
+static void bench_lazy(size_t n)
+{
+	std::mt19937_64 rng(47);
+	flat_map<uint64_t, uint64_t> map0, map1, map2;
+	for (size_t i = 0; i < n; i++)
+	{
+		uint64_t k = rng() % n;
+		map0.insert(k, i);
+		map1.insert(k, i);
+		map2.insert(k, i);
+	}
+
+	uint64_t s0 = 0, s1 = 0, s2 = 0;
+	bench_clock::time_point t = bench_clock::now();
+	flat_map<uint64_t, uint64_t>::iterator it0 = map0.begin();
+	for (int i = 0; i < 10; i++, ++it0)
+		s0 += it0->first + it0->second;
+	double t0 = elapsed_ms(t);
+
+	t = bench_clock::now();
+	flat_map<uint64_t, uint64_t>::iterator_pair top = map1.first_k(10);
+	for (flat_map<uint64_t, uint64_t>::iterator it = top.first; it != top.second; ++it)
+		s1 += it->first + it->second;
+	double t1 = elapsed_ms(t);
+
+	t = bench_clock::now();
+	flat_map<uint64_t, uint64_t>::lazy_iterator it2 = map2.lazy_begin();
+	for (int i = 0; i < 10; i++, ++it2)
+		s2 += it2->first + it2->second;
+	double t2 = elapsed_ms(t);
+
+	printf("10 smallest keys, %lu elements\n", static_cast<unsigned long>(n));
+	printf("  %-16s %12s\n", "", "ms");
+	printf("  %-16s %12.1f\n", "sort()", t0);
+	printf("  %-16s %12.1f%s\n", "first_k()", t1, s0 == s1 ? "" : "  MISMATCH");
+	printf("  %-16s %12.1f%s\n", "lazy_iterator", t2, s0 == s2 ? "" : "  MISMATCH");
+}
+
+// Latency of the first lookup after a bulk load, sorting in place against sorting in the background
+static void bench_async(size_t n)
+{
+	std::mt19937_64 rng(53);
+	std::vector<uint64_t> keys(n);
+	for (size_t i = 0; i < n; i++)
+		keys[i] = rng() % n;
+
+	flat_map<uint64_t, uint64_t> map0;
+	flat_async_map<uint64_t, uint64_t> map1(flat_async_map<uint64_t, uint64_t>::LOOKUP_SCAN);
+	for (size_t i = 0; i < n; i++)
+	{
+		map0.insert(keys[i], i);
+		map1.insert(keys[i], i);
+	}
+
+	bench_clock::time_point t = bench_clock::now();
+	size_t n0 = map0.count(keys[n / 2]);
+	double t0 = elapsed_ms(t);
+
+	t = bench_clock::now();
+	map1.sort_async();
+	double t1 = elapsed_ms(t);
+	t = bench_clock::now();
+	size_t n1 = map1.count(keys[n / 2]);
+	double t2 = elapsed_ms(t);
+	t = bench_clock::now();
+	map1.wait();
+	double t3 = elapsed_ms(t);
+
+	printf("first lookup after a bulk load, %lu elements\n", static_cast<unsigned long>(n));
+	printf("  %-28s %12s\n", "", "ms");
+	printf("  %-28s %12.1f\n", "flat_map find()", t0);
+	printf("  %-28s %12.1f\n", "flat_async_map sort_async()", t1);
+	printf("  %-28s %12.1f%s\n", "flat_async_map find() (scan)", t2, n0 == n1 ? "" : "  MISMATCH");
+	printf("  %-28s %12.1f\n", "rest of the background sort", t3);
+}
+
+template<size_t nBytes>
+struct bench_payload
+{
+	uint64_t ar[nBytes / 8];
+};
+
+template<size_t nBytes>
+static void bench_indirect_size(size_t n)
+{
+	typedef std::pair<uint64_t, bench_payload<nBytes> > pair_type;
+	std::mt19937_64 rng(59);
+	std::vector<pair_type> ar(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		ar[i].first = rng() % n;
+		ar[i].second.ar[0] = i;
+	}
+
+	std::vector<pair_type> ar0(ar), ar1(ar);
+	bench_clock::time_point t = bench_clock::now();
+	std::stable_sort(ar0.begin(), ar0.end(), flat_less_first<pair_type>());
+	double t0 = elapsed_ms(t);
+	t = bench_clock::now();
+	flat_sort_indirect(ar1, 0);
+	double t1 = elapsed_ms(t);
+
+	bool bOk = ar0.size() == ar1.size();
+	for (size_t i = 0; bOk && i < ar0.size(); i++)
+		bOk = ar0[i].first == ar1[i].first && ar0[i].second.ar[0] == ar1[i].second.ar[0];
+	printf("  %-16lu %12.1f %12.1f%s\n", static_cast<unsigned long>(sizeof(pair_type)), t0, t1, bOk ? "" : "  MISMATCH");
+}
+
+// Sorting pairs by moving them against sorting (key, position) entries, to pick FLAT_INDIRECT_SORT_BYTES
+static void bench_indirect(size_t n)
+{
+	printf("direct and indirect sort, %lu elements, threshold %d bytes\n", static_cast<unsigned long>(n), FLAT_INDIRECT_SORT_BYTES);
+	printf("  %-16s %12s %12s\n", "pair bytes", "direct ms", "indirect ms");
+	bench_indirect_size<8>(n);
+	bench_indirect_size<24>(n);
+	bench_indirect_size<56>(n);
+	bench_indirect_size<120>(n);
+	bench_indirect_size<248>(n);
+}
+
+// Full scan of a map on one thread against flat_parallel_reduce and flat_parallel_for_each
+static void bench_parallel(size_t n)
+{
+	std::mt19937_64 rng(61);
+	flat_map<uint64_t, uint64_t> map1;
+	map1.reserve(n);
+	for (size_t i = 0; i < n; i++)
+		map1.insert(rng(), i);
+	map1.sort();
+
+	bench_clock::time_point t = bench_clock::now();
+	uint64_t s0 = 0;
+	for (flat_map<uint64_t, uint64_t>::iterator it = map1.begin(); it != map1.end(); ++it)
+		s0 += (it->first >> 32) ^ it->second;
+	double t0 = elapsed_ms(t);
+
+	t = bench_clock::now();
+	uint64_t s1 = flat_parallel_reduce(map1, static_cast<uint64_t>(0),
+		[](uint64_t acc, const std::pair<uint64_t, uint64_t> &p) { return acc + ((p.first >> 32) ^ p.second); },
+		[](uint64_t lhs, uint64_t rhs) { return lhs + rhs; });
+	double t1 = elapsed_ms(t);
+
+	t = bench_clock::now();
+	flat_parallel_for_each(map1, [](std::pair<uint64_t, uint64_t> &p) { p.second = (p.first >> 32) ^ p.second; });
+	double t2 = elapsed_ms(t);
+	uint64_t s2 = 0;
+	for (flat_map<uint64_t, uint64_t>::iterator it = map1.begin(); it != map1.end(); ++it)
+		s2 += it->second;
+
+	printf("full scan, %lu elements, %lu threads\n", static_cast<unsigned long>(n), static_cast<unsigned long>(flat_thread_pool::instance().threads() + 1));
+	printf("  %-24s %12s\n", "", "ms");
+	printf("  %-24s %12.1f\n", "one thread", t0);
+	printf("  %-24s %12.1f%s\n", "flat_parallel_reduce", t1, s0 == s1 ? "" : "  MISMATCH");
+	printf("  %-24s %12.1f%s\n", "flat_parallel_for_each", t2, s0 == s2 ? "" : "  MISMATCH");
+}
+
+// Snapshots taken every 1000 updates, copies of a flat_map against flat_versioned_map snapshots
+static void bench_versioned(size_t n)
+{
+	std::mt19937_64 rng(67);
+	std::vector<std::pair<uint64_t, uint64_t> > ar(n);
+	for (size_t i = 0; i < n; i++)
+		ar[i] = std::make_pair(i * 2, i);
+	std::vector<uint64_t> keys(n);
+	for (size_t i = 0; i < n; i++)
+		keys[i] = rng() % (2 * n);
+
+	flat_map<uint64_t, uint64_t> map0;
+	std::vector<std::pair<uint64_t, uint64_t> > ar0(ar);
+	map0.adopt_sorted(ar0);
+	flat_versioned_map<uint64_t, uint64_t> map1;
+	map1.assign_sorted(ar.begin(), ar.end());
+
+	const size_t nSnapshots = 20;
+	bench_clock::time_point t = bench_clock::now();
+	for (size_t s = 0; s < nSnapshots; s++)
+	{
+		for (size_t i = 0; i < 1000; i++)
+			map0.insert(keys[s * 1000 + i], i);
+		flat_map<uint64_t, uint64_t> copy(map0);
+		map0.count(0);
+	}
+	double t0 = elapsed_ms(t);
+
+	t = bench_clock::now();
+	size_t nShared = 0;
+	for (size_t s = 0; s < nSnapshots; s++)
+	{
+		flat_versioned_map<uint64_t, uint64_t> snap = map1.snapshot();
+		for (size_t i = 0; i < 1000; i++)
+			map1.insert(keys[s * 1000 + i], i);
+		nShared += map1.shared_chunks();
+	}
+	double t1 = elapsed_ms(t);
+
+	uint64_t s0 = 0, s1 = 0;
+	t = bench_clock::now();
+	for (size_t i = 0; i < n; i++)
+		s0 += map0.count(keys[i]);
+	double t2 = elapsed_ms(t);
+	t = bench_clock::now();
+	for (size_t i = 0; i < n; i++)
+		s1 += map1.count(keys[i]);
+	double t3 = elapsed_ms(t);
+
+	printf("%lu snapshots of 1000 updates, %lu elements, %lu of %lu chunks shared after each\n", static_cast<unsigned long>(nSnapshots),
+		static_cast<unsigned long>(n), static_cast<unsigned long>(nShared / nSnapshots), static_cast<unsigned long>(map1.chunks()));
+	printf("  %-20s %12s %12s\n", "", "updates ms", "lookups ms");
+	printf("  %-20s %12.1f %12.1f\n", "flat_map copies", t0, t2);
+	printf("  %-20s %12.1f %12.1f%s\n", "flat_versioned_map", t1, t3, s0 == s1 ? "" : "  MISMATCH");
+}
+
+// (key, value) lookups in a few hot keys, values in insert order against values sorted by std::less
+static void bench_value_order(size_t n)
+{
+	typedef flat_multimap<uint64_t, uint64_t> map0_type;
+	typedef flat_multimap_by_value<uint64_t, uint64_t> map1_type;
+	std::mt19937_64 rng(71);
+	map0_type map0;
+	map1_type map1;
+	for (size_t i = 0; i < n; i++)
+	{
+		uint64_t k = rng() % 10, v = rng();
+		map0.insert(k, v);
+		map1.insert(k, v);
+	}
+	map0.begin();
+	map1.begin();
+
+	const size_t nQueries = 1000;
+	std::vector<std::pair<uint64_t, uint64_t> > queries(nQueries);
+	for (size_t i = 0; i < nQueries; i++)
+		queries[i] = *(map0.begin() + rng() % n);
+
+	size_t n0 = 0, n1 = 0;
+	bench_clock::time_point t = bench_clock::now();
+	for (size_t i = 0; i < nQueries; i++)
+		n0 += map0.find(queries[i].first, queries[i].second) != map0.end() ? 1 : 0;
+	double t0 = elapsed_ms(t);
+	t = bench_clock::now();
+	for (size_t i = 0; i < nQueries; i++)
+		n1 += map1.find(queries[i].first, queries[i].second) != map1.end() ? 1 : 0;
+	double t1 = elapsed_ms(t);
+
+	printf("find(key, value), %lu elements in 10 keys, %lu queries\n", static_cast<unsigned long>(n), static_cast<unsigned long>(nQueries));
+	printf("  %-20s %12s\n", "", "ms");
+	printf("  %-20s %12.2f\n", "insertion order", t0);
+	printf("  %-20s %12.2f%s\n", "std::less<uint64_t>", t1, n0 == n1 ? "" : "  MISMATCH");
+}
+
+int main (int argc, char **argv)
+{
+	size_t n = 1000000;
+	if (argc > 1) n = strtoul(argv[1], 0, 10);
+	size_t nEmulatedNodes = 0;
+	if (argc > 2) nEmulatedNodes = strtoul(argv[2], 0, 10);
+
+	bench_search(n);
+	bench_bloom(n);
+	bench_packed(n);
+	bench_roaring(n);
+	bench_small(n);
+	bench_strings(n);
+	bench_blocked(n);
+	bench_builder(n);
+	bench_aggregate(n);
+	bench_grouped(n);
+	bench_rle(n);
+	bench_numa(n, nEmulatedNodes);
+	bench_durable(n);
+	bench_lazy(n);
+	bench_async(n);
+	bench_indirect(n);
+	bench_parallel(n);
+	bench_versioned(n);
+	bench_value_order(n);
+	return 0;
+}
@@ -0,0 +1,347 @@
+#ifndef _FLAT_BLOCKED_MAP_H_INCLUDED_2026_10_19
+#define _FLAT_BLOCKED_MAP_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include "flat_search.h"
+
+/*
+ * Minimalistic map C++ template based on a vector of sorted chunks
+ *
+ * Flat blocked map features
+ * - Elements are stored in sorted chunks of at most nChunkSize elements
+ * - The first key of every chunk is kept in a separate fence array
+ * - A lookup is a binary search of the fences and then of one chunk
+ * - insert() and erase() are done in place and shift elements of one chunk only,
+ *   a full chunk is split in two, a chunk shrinking below a quarter is merged with a neighbour
+ * - A duplicate key replaces the value of the stored one, the last one wins
+ * - Iterators walk every chunk contiguously and are invalidated by insert() and erase()
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+template<typename key_type, typename val_type, size_t nChunkSize = 256>
+class flat_blocked_map
+{
+	// a full chunk is split in two halves, nChunkSize < 2 fails to compile
+	typedef char chunk_size_check[nChunkSize >= 2 ? 1 : -1];
+
+public:
+	typedef std::pair<key_type, val_type> pair_type;
+	typedef std::vector<pair_type> chunk_type;
+
+	// Bidirectional iterator, a chunk index and a position inside the chunk
+	class iterator
+	{
+	public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef pair_type value_type;
+		typedef ptrdiff_t difference_type;
+		typedef pair_type* pointer;
+		typedef pair_type& reference;
+
+		iterator() : m_pChunks(0), m_nChunk(0), m_nPos(0) {};
+
+		pair_type& operator* () const { return (*m_pChunks)[m_nChunk][m_nPos]; }
+		pair_type* operator-> () const { return &(*m_pChunks)[m_nChunk][m_nPos]; }
+		iterator& operator++ ();
+		iterator& operator-- ();
+		iterator operator++ (int) { iterator it(*this); ++(*this); return it; }
+		iterator operator-- (int) { iterator it(*this); --(*this); return it; }
+		bool operator== (const iterator& rhs) const { return m_nChunk == rhs.m_nChunk && m_nPos == rhs.m_nPos; }
+		bool operator!= (const iterator& rhs) const { return !(*this == rhs); }
+
+	private:
+		friend class flat_blocked_map;
+		iterator(std::vector<chunk_type> *pChunks, size_t nChunk, size_t nPos) : m_pChunks(pChunks), m_nChunk(nChunk), m_nPos(nPos) {};
+
+		std::vector<chunk_type> *m_pChunks;
+		size_t m_nChunk;
+		size_t m_nPos;
+	};
+	typedef std::pair<iterator, iterator> iterator_pair;
+
+	flat_blocked_map() : m_nSize(0) {};
+
+	void clear();
+	void insert(const pair_type &p);
+	void insert(const key_type &k, const val_type &v);
+	iterator find(const key_type &k);
+	iterator lower_bound(const key_type &k);
+	iterator upper_bound(const key_type &k);
+	iterator_pair equal_range(const key_type &k);
+	size_t count(const key_type &k);
+	bool empty() const { return m_nSize == 0; }
+	size_t size() const { return m_nSize; }
+	iterator erase(const key_type &k);
+	iterator erase(iterator i0);
+	iterator erase(iterator i0, iterator i1);
+	void swap(flat_blocked_map& other);
+
+	iterator begin() { return iterator(&m_chunks, 0, 0); }
+	iterator end() { return iterator(&m_chunks, m_chunks.size(), 0); }
+
+	size_t chunks() const { return m_chunks.size(); }
+	size_t memory_usage() const;
+
+private:
+	size_t find_chunk(const key_type &k) const;
+	iterator make_iterator(size_t nChunk, size_t nPos);
+	void insert_chunk(size_t nChunk);
+	void remove_chunk(size_t nChunk);
+
+	std::vector<chunk_type> m_chunks;
+	std::vector<key_type> m_fences;		// first key of every chunk
+	size_t m_nSize;
+};
+
+//------------------------------------- iterator -----------------------------------------
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_blocked_map<key_type, val_type, nChunkSize>::iterator& flat_blocked_map<key_type, val_type, nChunkSize>::iterator::operator++ ()
+{
+	if (++m_nPos == (*m_pChunks)[m_nChunk].size())
+	{
+		m_nChunk++;
+		m_nPos = 0;
+	}
+	return *this;
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_blocked_map<key_type, val_type, nChunkSize>::iterator& flat_blocked_map<key_type, val_type, nChunkSize>::iterator::operator-- ()
+{
+	if (m_nPos == 0)
+		m_nPos = (*m_pChunks)[--m_nChunk].size();
+	m_nPos--;
+	return *this;
+}
+
+//------------------------------------- flat_blocked_map -----------------------------------------
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline void flat_blocked_map<key_type, val_type, nChunkSize>::clear()
+{
+	m_chunks.clear();
+	m_fences.clear();
+	m_nSize = 0;
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline size_t flat_blocked_map<key_type, val_type, nChunkSize>::find_chunk(const key_type &k) const
+{
+	// the last chunk with a fence not greater than k, or the first chunk
+	size_t n = std::upper_bound(m_fences.begin(), m_fences.end(), k) - m_fences.begin();
+	return n ? n - 1 : 0;
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_blocked_map<key_type, val_type, nChunkSize>::iterator flat_blocked_map<key_type, val_type, nChunkSize>::make_iterator(size_t nChunk, size_t nPos)
+{
+	if (nChunk < m_chunks.size() && nPos == m_chunks[nChunk].size())
+	{
+		nChunk++;
+		nPos = 0;
+	}
+	return iterator(&m_chunks, nChunk, nPos);
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline void flat_blocked_map<key_type, val_type, nChunkSize>::insert_chunk(size_t nChunk)
+{
+	// chunks are moved by swap() to avoid copying their elements
+	m_chunks.push_back(chunk_type());
+	for (size_t i = m_chunks.size() - 1; i > nChunk; i--)
+		m_chunks[i].swap(m_chunks[i - 1]);
+	m_chunks[nChunk].reserve(nChunkSize);
+	m_fences.insert(m_fences.begin() + nChunk, key_type());
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline void flat_blocked_map<key_type, val_type, nChunkSize>::remove_chunk(size_t nChunk)
+{
+	for (size_t i = nChunk; i + 1 < m_chunks.size(); i++)
+		m_chunks[i].swap(m_chunks[i + 1]);
+	m_chunks.pop_back();
+	m_fences.erase(m_fences.begin() + nChunk);
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline void flat_blocked_map<key_type, val_type, nChunkSize>::insert(const pair_type &p)
+{
+	if (m_chunks.empty())
+	{
+		insert_chunk(0);
+		m_chunks[0].push_back(p);
+		m_fences[0] = p.first;
+		m_nSize = 1;
+		return;
+	}
+
+	size_t c = find_chunk(p.first);
+	typename chunk_type::iterator it = std::lower_bound(m_chunks[c].begin(), m_chunks[c].end(), p.first, flat_search_less_elem<key_type, flat_key_first>(flat_key_first()));
+	if (it != m_chunks[c].end() && !(p.first < it->first))
+	{
+		it->second = p.second;
+		return;
+	}
+
+	size_t nPos = it - m_chunks[c].begin();
+	if (m_chunks[c].size() == nChunkSize)
+	{
+		// splitting a full chunk in halves
+		size_t nHalf = nChunkSize / 2;
+		insert_chunk(c + 1);
+		m_chunks[c + 1].assign(m_chunks[c].begin() + nHalf, m_chunks[c].end());
+		m_chunks[c].resize(nHalf);
+		m_fences[c + 1] = m_chunks[c + 1][0].first;
+		if (nPos > nHalf)
+		{
+			c++;
+			nPos -= nHalf;
+		}
+	}
+	m_chunks[c].insert(m_chunks[c].begin() + nPos, p);
+	if (nPos == 0) m_fences[c] = p.first;
+	m_nSize++;
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline void flat_blocked_map<key_type, val_type, nChunkSize>::insert(const key_type &k, const val_type &v)
+{
+	insert(std::make_pair(k, v));
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_blocked_map<key_type, val_type, nChunkSize>::iterator flat_blocked_map<key_type, val_type, nChunkSize>::lower_bound(const key_type &k)
+{
+	if (m_chunks.empty()) return end();
+	size_t c = find_chunk(k);
+	typename chunk_type::iterator it = std::lower_bound(m_chunks[c].begin(), m_chunks[c].end(), k, flat_search_less_elem<key_type, flat_key_first>(flat_key_first()));
+	return make_iterator(c, it - m_chunks[c].begin());
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_blocked_map<key_type, val_type, nChunkSize>::iterator flat_blocked_map<key_type, val_type, nChunkSize>::upper_bound(const key_type &k)
+{
+	if (m_chunks.empty()) return end();
+	size_t c = find_chunk(k);
+	typename chunk_type::iterator it = std::upper_bound(m_chunks[c].begin(), m_chunks[c].end(), k, flat_search_less_key<key_type, flat_key_first>(flat_key_first()));
+	return make_iterator(c, it - m_chunks[c].begin());
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_blocked_map<key_type, val_type, nChunkSize>::iterator flat_blocked_map<key_type, val_type, nChunkSize>::find(const key_type &k)
+{
+	iterator it = lower_bound(k);
+	if (it == end() || k < it->first)
+		return end();
+	return it;
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_blocked_map<key_type, val_type, nChunkSize>::iterator_pair flat_blocked_map<key_type, val_type, nChunkSize>::equal_range(const key_type &k)
+{
+	iterator it = find(k);
+	if (it == end())
+		return iterator_pair(lower_bound(k), lower_bound(k));
+	iterator it1 = it;
+	return iterator_pair(it, ++it1);
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline size_t flat_blocked_map<key_type, val_type, nChunkSize>::count(const key_type &k)
+{
+	if (find(k) == end()) return 0;
+	return 1;
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_blocked_map<key_type, val_type, nChunkSize>::iterator flat_blocked_map<key_type, val_type, nChunkSize>::erase(const key_type &k)
+{
+	iterator it = find(k);
+	if (it == end()) return it;
+	return erase(it);
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_blocked_map<key_type, val_type, nChunkSize>::iterator flat_blocked_map<key_type, val_type, nChunkSize>::erase(iterator i0)
+{
+	size_t c = i0.m_nChunk;
+	size_t nPos = i0.m_nPos;
+	m_chunks[c].erase(m_chunks[c].begin() + nPos);
+	m_nSize--;
+
+	if (m_chunks[c].empty())
+	{
+		remove_chunk(c);
+		return make_iterator(c, 0);
+	}
+	if (nPos == 0) m_fences[c] = m_chunks[c][0].first;
+
+	// merging a small chunk with the smaller of its neighbours
+	if (m_chunks[c].size() < nChunkSize / 4 && m_chunks.size() > 1)
+	{
+		bool bPrev = c > 0 && (c + 1 == m_chunks.size() || m_chunks[c - 1].size() < m_chunks[c + 1].size());
+		size_t nLeft = bPrev ? c - 1 : c;
+		if (m_chunks[nLeft].size() + m_chunks[nLeft + 1].size() <= nChunkSize)
+		{
+			if (bPrev) nPos += m_chunks[nLeft].size();
+			m_chunks[nLeft].insert(m_chunks[nLeft].end(), m_chunks[nLeft + 1].begin(), m_chunks[nLeft + 1].end());
+			remove_chunk(nLeft + 1);
+			c = nLeft;
+		}
+	}
+	return make_iterator(c, nPos);
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_blocked_map<key_type, val_type, nChunkSize>::iterator flat_blocked_map<key_type, val_type, nChunkSize>::erase(iterator i0, iterator i1)
+{
+	size_t n = std::distance(i0, i1);
+	for (size_t i = 0; i < n; i++)
+		i0 = erase(i0);
+	return i0;
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline void flat_blocked_map<key_type, val_type, nChunkSize>::swap(flat_blocked_map<key_type, val_type, nChunkSize>& other)
+{
+	m_chunks.swap(other.m_chunks);
+	m_fences.swap(other.m_fences);
+	std::swap(m_nSize, other.m_nSize);
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline size_t flat_blocked_map<key_type, val_type, nChunkSize>::memory_usage() const
+{
+	size_t n = m_chunks.capacity()*sizeof(chunk_type) + m_fences.capacity()*sizeof(key_type);
+	for (size_t i = 0; i < m_chunks.size(); i++)
+		n += m_chunks[i].capacity()*sizeof(pair_type);
+	return n;
+}
+
+#endif // _FLAT_BLOCKED_MAP_H_INCLUDED_2026_10_19
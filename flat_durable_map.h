@@ -0,0 +1,423 @@
+#ifndef _FLAT_DURABLE_MAP_H_INCLUDED_2026_10_19
+#define _FLAT_DURABLE_MAP_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+#include "flat_map.h"
+
+/*
+ * Durable flat map with a write-ahead log and checkpoints
+ *
+ * Flat durable map features
+ * - insert() and erase() append compact binary records to <path>.wal
+ * - Records are written in groups (group commit) and the log is synced
+ *   once per a configurable number of groups, commit() syncs at once
+ * - checkpoint() writes the sorted elements to <path>.ckpt and truncates
+ *   the log, it also runs when the log grows beyond set_checkpoint_bytes()
+ * - open() loads the checkpoint as is and replays the log tail through
+ *   the lazy append path of a flat_map, recovery costs one sort of the tail
+ * - A torn or corrupted record ends the log, it and later records are lost
+ * - Keys and values must be trivially copyable, they are stored as raw bytes
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+template<typename key_type, typename val_type, typename search_type = flat_search_binary>
+class flat_durable_map
+{
+public:
+	typedef flat_map<key_type, val_type, search_type> map_type;
+	typedef typename map_type::pair_type pair_type;
+	typedef typename map_type::iterator iterator;
+	typedef typename map_type::iterator_pair iterator_pair;
+
+	flat_durable_map() : m_pLog(0), m_nGroupRecords(64), m_nSyncBatch(1), m_nCheckpointBytes(0),
+		m_nBuffered(0), m_nUnsynced(0), m_nLogBytes(0) {};
+	~flat_durable_map() { close(); }
+
+	// loads <path>.ckpt, replays <path>.wal and continues the log
+	bool open(const std::string &path);
+	// commits the log and closes the files, the map keeps its elements
+	void close();
+	bool is_open() const { return m_pLog != 0; }
+
+	// records per log write, 1 writes every record at once
+	void set_group_commit(size_t nRecords) { m_nGroupRecords = std::max(static_cast<size_t>(1), nRecords); }
+	// log writes per sync, 0 leaves syncing to the operating system
+	void set_sync_batch(size_t nWrites) { m_nSyncBatch = nWrites; }
+	// log size which triggers a checkpoint, 0 checkpoints only on request
+	void set_checkpoint_bytes(size_t nBytes) { m_nCheckpointBytes = nBytes; }
+
+	void insert(const pair_type &p) { insert(p.first, p.second); }
+	void insert(const key_type &k, const val_type &v);
+	iterator erase(const key_type &k);
+	void clear();
+	// writes the buffered records and syncs the log
+	bool commit();
+	// writes the sorted elements and truncates the log
+	bool checkpoint();
+
+	iterator find(const key_type &k) { return m_map.find(k); }
+	iterator lower_bound(const key_type &k) { return m_map.lower_bound(k); }
+	iterator upper_bound(const key_type &k) { return m_map.upper_bound(k); }
+	iterator_pair equal_range(const key_type &k) { return m_map.equal_range(k); }
+	size_t count(const key_type &k) { return m_map.count(k); }
+	size_t size() { return m_map.size(); }
+	bool empty() { return m_map.empty(); }
+	iterator begin() { return m_map.begin(); }
+	iterator end() { return m_map.end(); }
+
+	// the map itself, changes made through it are not logged
+	map_type &map() { return m_map; }
+	size_t log_bytes() const { return m_nLogBytes + m_buffer.size(); }
+
+private:
+	flat_durable_map(const flat_durable_map&);
+	flat_durable_map &operator=(const flat_durable_map&);
+
+	enum { RECORD_INSERT = 'I', RECORD_ERASE = 'E', RECORD_CLEAR = 'C' };
+	enum { CHECKPOINT_VERSION = 1 };
+
+	static uint32_t checksum(const char *p, size_t nSize);
+	static bool sync_file(FILE *f);
+	static void sync_dir(const std::string &path);
+	void append(char nType, const key_type *pKey, const val_type *pVal);
+	bool flush(bool bSync);
+	bool load_checkpoint();
+	void replay_log();
+
+	map_type m_map;
+	std::string m_path;
+	FILE *m_pLog;
+	std::vector<char> m_buffer;
+	size_t m_nGroupRecords;
+	size_t m_nSyncBatch;
+	size_t m_nCheckpointBytes;
+	size_t m_nBuffered;
+	size_t m_nUnsynced;
+	size_t m_nLogBytes;
+};
+
+template<typename key_type, typename val_type, typename search_type>
+inline uint32_t flat_durable_map<key_type, val_type, search_type>::checksum(const char *p, size_t nSize)
+{
+	// FNV-1a
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < nSize; i++)
+		h = (h ^ static_cast<unsigned char>(p[i])) * 16777619u;
+	return h;
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline bool flat_durable_map<key_type, val_type, search_type>::sync_file(FILE *f)
+{
+	if (fflush(f) != 0)
+		return false;
+#if defined(_WIN32)
+	return _commit(_fileno(f)) == 0;
+#else
+	return fsync(fileno(f)) == 0;
+#endif
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline void flat_durable_map<key_type, val_type, search_type>::sync_dir(const std::string &path)
+{
+	// makes the rename of a checkpoint durable
+#if !defined(_WIN32)
+	std::string dir = path.substr(0, path.find_last_of('/') + 1);
+	int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+	if (fd >= 0)
+	{
+		fsync(fd);
+		::close(fd);
+	}
+#else
+	(void)path;
+#endif
+}
+
+//------------------------------------- log -----------------------------------------
+
+template<typename key_type, typename val_type, typename search_type>
+inline void flat_durable_map<key_type, val_type, search_type>::append(char nType, const key_type *pKey, const val_type *pVal)
+{
+	// record: type, key, value (inserts only), checksum of the previous bytes
+	size_t nStart = m_buffer.size();
+	m_buffer.push_back(nType);
+	if (pKey != 0)
+		m_buffer.insert(m_buffer.end(), reinterpret_cast<const char*>(pKey), reinterpret_cast<const char*>(pKey) + sizeof(key_type));
+	if (pVal != 0)
+		m_buffer.insert(m_buffer.end(), reinterpret_cast<const char*>(pVal), reinterpret_cast<const char*>(pVal) + sizeof(val_type));
+	uint32_t nChecksum = checksum(&m_buffer[nStart], m_buffer.size() - nStart);
+	m_buffer.insert(m_buffer.end(), reinterpret_cast<const char*>(&nChecksum), reinterpret_cast<const char*>(&nChecksum) + sizeof(nChecksum));
+
+	if (++m_nBuffered >= m_nGroupRecords)
+		flush(false);
+	if (m_nCheckpointBytes != 0 && m_nLogBytes >= m_nCheckpointBytes)
+		checkpoint();
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline bool flat_durable_map<key_type, val_type, search_type>::flush(bool bSync)
+{
+	if (m_pLog == 0)
+		return false;
+	bool bOk = true;
+	if (!m_buffer.empty())
+	{
+		bOk = fwrite(&m_buffer[0], 1, m_buffer.size(), m_pLog) == m_buffer.size();
+		m_nLogBytes += m_buffer.size();
+		m_buffer.clear();
+		m_nBuffered = 0;
+		m_nUnsynced++;
+	}
+	if (bSync || (m_nSyncBatch != 0 && m_nUnsynced >= m_nSyncBatch))
+	{
+		bOk = sync_file(m_pLog) && bOk;
+		m_nUnsynced = 0;
+	}
+	else
+		bOk = fflush(m_pLog) == 0 && bOk;
+	return bOk;
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline void flat_durable_map<key_type, val_type, search_type>::insert(const key_type &k, const val_type &v)
+{
+	m_map.insert(k, v);
+	if (m_pLog != 0)
+		append(RECORD_INSERT, &k, &v);
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline typename flat_durable_map<key_type, val_type, search_type>::iterator flat_durable_map<key_type, val_type, search_type>::erase(const key_type &k)
+{
+	iterator it = m_map.erase(k);
+	if (m_pLog != 0)
+		append(RECORD_ERASE, &k, 0);
+	return it;
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline void flat_durable_map<key_type, val_type, search_type>::clear()
+{
+	m_map.clear();
+	if (m_pLog != 0)
+		append(RECORD_CLEAR, 0, 0);
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline bool flat_durable_map<key_type, val_type, search_type>::commit()
+{
+	return flush(true);
+}
+
+//------------------------------------- checkpoint and recovery -----------------------------------------
+
+template<typename key_type, typename val_type, typename search_type>
+inline bool flat_durable_map<key_type, val_type, search_type>::checkpoint()
+{
+	if (m_pLog == 0 || !commit())
+		return false;
+
+	// checkpoint: magic, version, key and value sizes, count, sorted pairs
+	std::string tmp = m_path + ".ckpt.tmp";
+	FILE *f = fopen(tmp.c_str(), "wb");
+	if (f == 0)
+		return false;
+	uint32_t header[4] = { 0x504b4346u, CHECKPOINT_VERSION, static_cast<uint32_t>(sizeof(key_type)), static_cast<uint32_t>(sizeof(val_type)) };
+	uint64_t nCount = m_map.size();
+	bool bOk = fwrite(header, sizeof(header), 1, f) == 1 && fwrite(&nCount, sizeof(nCount), 1, f) == 1;
+	if (bOk && nCount != 0)
+		bOk = fwrite(&*m_map.begin(), sizeof(pair_type), m_map.size(), f) == m_map.size();
+	bOk = sync_file(f) && bOk;
+	fclose(f);
+	std::string ckpt = m_path + ".ckpt";
+#if defined(_WIN32)
+	remove(ckpt.c_str());
+#endif
+	if (!bOk || rename(tmp.c_str(), ckpt.c_str()) != 0)
+	{
+		remove(tmp.c_str());
+		return false;
+	}
+	sync_dir(m_path);
+
+	// a crash before the truncation replays records already in the checkpoint, which is harmless
+	std::string wal = m_path + ".wal";
+	fclose(m_pLog);
+	m_pLog = fopen(wal.c_str(), "wb");
+	m_nLogBytes = 0;
+	m_nUnsynced = 0;
+	return m_pLog != 0 && sync_file(m_pLog);
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline bool flat_durable_map<key_type, val_type, search_type>::load_checkpoint()
+{
+	std::string ckpt = m_path + ".ckpt";
+	FILE *f = fopen(ckpt.c_str(), "rb");
+	if (f == 0)
+		return true;
+	uint32_t header[4];
+	uint64_t nCount = 0;
+	bool bOk = fread(header, sizeof(header), 1, f) == 1 && fread(&nCount, sizeof(nCount), 1, f) == 1 &&
+		header[0] == 0x504b4346u && header[1] == CHECKPOINT_VERSION &&
+		header[2] == sizeof(key_type) && header[3] == sizeof(val_type);
+	std::vector<pair_type> ar;
+	if (bOk)
+	{
+		ar.resize(static_cast<size_t>(nCount));
+		if (nCount != 0)
+			bOk = fread(&ar[0], sizeof(pair_type), ar.size(), f) == ar.size();
+	}
+	fclose(f);
+	if (bOk)
+		m_map.adopt_sorted(ar);
+	return bOk;
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline void flat_durable_map<key_type, val_type, search_type>::replay_log()
+{
+	std::string wal = m_path + ".wal";
+	FILE *f = fopen(wal.c_str(), "rb");
+	if (f == 0)
+		return;
+	std::vector<char> log;
+	char buf[65536];
+	for (size_t n; (n = fread(buf, 1, sizeof(buf), f)) != 0; )
+		log.insert(log.end(), buf, buf + n);
+	fclose(f);
+
+	// the tail goes through the lazy append path, last record of a key wins;
+	// erased keys are kept as tombstones until the merge with the checkpoint
+	flat_map<key_type, std::pair<val_type, bool> > tail;
+	size_t nClear = 0;
+	size_t nPos = 0;
+	m_nLogBytes = 0;
+	while (nPos < log.size())
+	{
+		char nType = log[nPos];
+		size_t nSize = 1 + (nType == RECORD_CLEAR ? 0 : sizeof(key_type)) + (nType == RECORD_INSERT ? sizeof(val_type) : 0);
+		uint32_t nChecksum;
+		if ((nType != RECORD_INSERT && nType != RECORD_ERASE && nType != RECORD_CLEAR) || nPos + nSize + sizeof(nChecksum) > log.size())
+			break;
+		memcpy(&nChecksum, &log[nPos + nSize], sizeof(nChecksum));
+		if (nChecksum != checksum(&log[nPos], nSize))
+			break;
+		if (nType == RECORD_CLEAR)
+		{
+			tail.clear();
+			nClear++;
+		}
+		else
+		{
+			key_type k;
+			std::pair<val_type, bool> v(val_type(), nType == RECORD_INSERT);
+			memcpy(static_cast<void*>(&k), &log[nPos + 1], sizeof(key_type));
+			if (v.second)
+				memcpy(static_cast<void*>(&v.first), &log[nPos + 1 + sizeof(key_type)], sizeof(val_type));
+			tail.insert(k, v);
+		}
+		nPos += nSize + sizeof(nChecksum);
+	}
+	m_nLogBytes = nPos;
+	if (nClear != 0)
+		m_map.clear();
+	if (tail.empty())
+		return;
+
+	// merge of the checkpoint with the sorted tail
+	std::vector<pair_type> ar;
+	ar.reserve(m_map.size() + tail.size());
+	iterator it = m_map.begin();
+	for (typename flat_map<key_type, std::pair<val_type, bool> >::iterator itTail = tail.begin(); itTail != tail.end(); ++itTail)
+	{
+		for (; it != m_map.end() && it->first < itTail->first; ++it)
+			ar.push_back(*it);
+		if (it != m_map.end() && !(itTail->first < it->first))
+			++it;
+		if (itTail->second.second)
+			ar.push_back(pair_type(itTail->first, itTail->second.first));
+	}
+	ar.insert(ar.end(), it, m_map.end());
+	m_map.adopt_sorted(ar);
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline bool flat_durable_map<key_type, val_type, search_type>::open(const std::string &path)
+{
+	close();
+	m_map.clear();
+	m_path = path;
+	if (!load_checkpoint())
+		return false;
+	replay_log();
+
+	// a torn tail is cut off, new records follow the last valid one
+	std::string wal = m_path + ".wal";
+	m_pLog = fopen(wal.c_str(), "r+b");
+	if (m_pLog == 0)
+		m_pLog = fopen(wal.c_str(), "w+b");
+	if (m_pLog == 0)
+		return false;
+#if !defined(_WIN32)
+	if (ftruncate(fileno(m_pLog), static_cast<off_t>(m_nLogBytes)) != 0)
+	{
+		close();
+		return false;
+	}
+#else
+	_chsize_s(_fileno(m_pLog), static_cast<__int64>(m_nLogBytes));
+#endif
+	fseek(m_pLog, 0, SEEK_END);
+	return true;
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline void flat_durable_map<key_type, val_type, search_type>::close()
+{
+	if (m_pLog == 0)
+		return;
+	commit();
+	fclose(m_pLog);
+	m_pLog = 0;
+	m_nLogBytes = 0;
+	m_nUnsynced = 0;
+}
+
+#endif // _FLAT_DURABLE_MAP_H_INCLUDED_2026_10_19
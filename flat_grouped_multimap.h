@@ -0,0 +1,311 @@
+#ifndef _FLAT_GROUPED_MULTIMAP_H_INCLUDED_2026_10_19
+#define _FLAT_GROUPED_MULTIMAP_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <algorithm>
+#include "flat_search.h"
+
+/*
+ * Minimalistic multimap C++ template storing every key once
+ *
+ * Flat grouped multimap features
+ * - Unique keys, offsets of their values and all values are kept in three vectors
+ *   (compressed sparse row layout), values of a key are contiguous
+ * - equal_range() is one search of the keys and a slice of the values, count() is O(1) after it
+ * - Values of a key keep their insertion order
+ * - Adds are kept aside and merged into the groups on the next lookup
+ * - Lookup strategy for the keys is selected by a search policy (see flat_search.h)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+template<typename key_type, typename val_type, typename search_type = flat_search_binary>
+class flat_grouped_multimap
+{
+public:
+	typedef std::pair<key_type, val_type> pair_type;
+	typedef typename std::vector<val_type>::iterator value_iterator;
+	typedef std::pair<value_iterator, value_iterator> value_range;
+
+	// Random access iterator over groups, a key and the values stored with it
+	class iterator
+	{
+	public:
+		iterator() : m_pMap(0), m_i(0) {};
+
+		const key_type& key() const { return m_pMap->m_keys[m_i]; }
+		value_iterator begin() const { return m_pMap->m_values.begin() + m_pMap->m_offsets[m_i]; }
+		value_iterator end() const { return m_pMap->m_values.begin() + m_pMap->m_offsets[m_i + 1]; }
+		size_t size() const { return m_pMap->m_offsets[m_i + 1] - m_pMap->m_offsets[m_i]; }
+
+		iterator& operator++ () { ++m_i; return *this; }
+		iterator& operator-- () { --m_i; return *this; }
+		iterator operator++ (int) { iterator it(*this); ++m_i; return it; }
+		iterator operator-- (int) { iterator it(*this); --m_i; return it; }
+		iterator operator+ (ptrdiff_t n) const { return iterator(m_pMap, m_i + n); }
+		ptrdiff_t operator- (const iterator& rhs) const { return static_cast<ptrdiff_t>(m_i) - static_cast<ptrdiff_t>(rhs.m_i); }
+		bool operator== (const iterator& rhs) const { return m_i == rhs.m_i; }
+		bool operator!= (const iterator& rhs) const { return m_i != rhs.m_i; }
+
+	private:
+		friend class flat_grouped_multimap;
+		iterator(flat_grouped_multimap *pMap, size_t i) : m_pMap(pMap), m_i(i) {};
+
+		flat_grouped_multimap *m_pMap;
+		size_t m_i;
+	};
+
+	flat_grouped_multimap() : m_offsets(1, 0) {};
+
+	void clear();
+	void reserve(size_t size);
+	void insert(const pair_type &p);
+	void insert(const key_type &k, const val_type &v);
+	iterator find(const key_type &k);
+	iterator lower_bound(const key_type &k);
+	iterator upper_bound(const key_type &k);
+	value_range equal_range(const key_type &k);
+	size_t count(const key_type &k);
+	size_t size();
+	size_t groups();
+	bool empty();
+	iterator erase(const key_type &k);
+	iterator erase(iterator it);
+	void swap(flat_grouped_multimap& other);
+
+	iterator begin();
+	iterator end();
+
+	search_type &search() { return m_search; }
+	size_t memory_usage() const;
+
+	void sort();
+
+private:
+	template<class T>
+	struct flat_grouped_less_key
+	{
+		bool operator() (const T& lhs, const T& rhs) const
+		{
+			return lhs.first < rhs.first;
+		}
+	};
+
+	std::vector<key_type> m_keys;
+	std::vector<size_t> m_offsets;		// values of key i are at [m_offsets[i], m_offsets[i + 1])
+	std::vector<val_type> m_values;
+	std::vector<pair_type> m_pending;	// adds not merged yet
+	search_type m_search;
+};
+
+//------------------------------------- flat_grouped_multimap -----------------------------------------
+
+template<typename key_type, typename val_type, typename search_type>
+inline void flat_grouped_multimap<key_type, val_type, search_type>::clear()
+{
+	m_keys.clear();
+	m_offsets.assign(1, 0);
+	m_values.clear();
+	m_pending.clear();
+	m_search.invalidate();
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline void flat_grouped_multimap<key_type, val_type, search_type>::reserve(size_t size)
+{
+	m_pending.reserve(size);
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline void flat_grouped_multimap<key_type, val_type, search_type>::insert(const pair_type &p)
+{
+	m_pending.push_back(p);
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline void flat_grouped_multimap<key_type, val_type, search_type>::insert(const key_type &k, const val_type &v)
+{
+	m_pending.push_back(std::make_pair(k, v));
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline typename flat_grouped_multimap<key_type, val_type, search_type>::iterator flat_grouped_multimap<key_type, val_type, search_type>::find(const key_type &k)
+{
+	if (!m_pending.empty()) sort();
+	return iterator(this, m_search.find(m_keys.begin(), m_keys.end(), k, flat_key_self()) - m_keys.begin());
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline typename flat_grouped_multimap<key_type, val_type, search_type>::iterator flat_grouped_multimap<key_type, val_type, search_type>::lower_bound(const key_type &k)
+{
+	if (!m_pending.empty()) sort();
+	return iterator(this, m_search.lower_bound(m_keys.begin(), m_keys.end(), k, flat_key_self()) - m_keys.begin());
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline typename flat_grouped_multimap<key_type, val_type, search_type>::iterator flat_grouped_multimap<key_type, val_type, search_type>::upper_bound(const key_type &k)
+{
+	if (!m_pending.empty()) sort();
+	return iterator(this, m_search.upper_bound(m_keys.begin(), m_keys.end(), k, flat_key_self()) - m_keys.begin());
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline typename flat_grouped_multimap<key_type, val_type, search_type>::value_range flat_grouped_multimap<key_type, val_type, search_type>::equal_range(const key_type &k)
+{
+	iterator it = find(k);
+	if (it == end())
+		return value_range(m_values.end(), m_values.end());
+	return value_range(it.begin(), it.end());
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline size_t flat_grouped_multimap<key_type, val_type, search_type>::count(const key_type &k)
+{
+	iterator it = find(k);
+	if (it == end()) return 0;
+	return it.size();
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline size_t flat_grouped_multimap<key_type, val_type, search_type>::size()
+{
+	if (!m_pending.empty()) sort();
+	return m_values.size();
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline size_t flat_grouped_multimap<key_type, val_type, search_type>::groups()
+{
+	if (!m_pending.empty()) sort();
+	return m_keys.size();
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline bool flat_grouped_multimap<key_type, val_type, search_type>::empty()
+{
+	return m_values.empty() && m_pending.empty();
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline typename flat_grouped_multimap<key_type, val_type, search_type>::iterator flat_grouped_multimap<key_type, val_type, search_type>::erase(const key_type &k)
+{
+	iterator it = find(k);
+	if (it == end()) return it;
+	return erase(it);
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline typename flat_grouped_multimap<key_type, val_type, search_type>::iterator flat_grouped_multimap<key_type, val_type, search_type>::erase(iterator it)
+{
+	size_t i = it.m_i;
+	size_t n = it.size();
+	m_values.erase(it.begin(), it.end());
+	m_keys.erase(m_keys.begin() + i);
+	m_offsets.erase(m_offsets.begin() + i + 1);
+	for (size_t j = i + 1; j < m_offsets.size(); j++)
+		m_offsets[j] -= n;
+	m_search.invalidate();
+	return iterator(this, i);
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline void flat_grouped_multimap<key_type, val_type, search_type>::swap(flat_grouped_multimap<key_type, val_type, search_type>& other)
+{
+	m_keys.swap(other.m_keys);
+	m_offsets.swap(other.m_offsets);
+	m_values.swap(other.m_values);
+	m_pending.swap(other.m_pending);
+	std::swap(m_search, other.m_search);
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline typename flat_grouped_multimap<key_type, val_type, search_type>::iterator flat_grouped_multimap<key_type, val_type, search_type>::begin()
+{
+	if (!m_pending.empty()) sort();
+	return iterator(this, 0);
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline typename flat_grouped_multimap<key_type, val_type, search_type>::iterator flat_grouped_multimap<key_type, val_type, search_type>::end()
+{
+	if (!m_pending.empty()) sort();
+	return iterator(this, m_keys.size());
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline size_t flat_grouped_multimap<key_type, val_type, search_type>::memory_usage() const
+{
+	return m_keys.capacity()*sizeof(key_type) + m_offsets.capacity()*sizeof(size_t) +
+		m_values.capacity()*sizeof(val_type) + m_pending.capacity()*sizeof(pair_type) + m_search.memory_usage();
+}
+
+template<typename key_type, typename val_type, typename search_type>
+void inline flat_grouped_multimap<key_type, val_type, search_type>::sort()
+{
+	std::stable_sort(m_pending.begin(), m_pending.end(), flat_grouped_less_key<pair_type>());
+
+	// merging the groups with runs of equal pending keys, old values go first
+	size_t nRuns = 0;
+	for (size_t j = 0; j < m_pending.size(); j++)
+		if (j == 0 || m_pending[j - 1].first < m_pending[j].first) nRuns++;
+
+	std::vector<key_type> keys;
+	std::vector<size_t> offsets;
+	std::vector<val_type> values;
+	keys.reserve(m_keys.size() + nRuns);
+	offsets.reserve(m_keys.size() + nRuns + 1);
+	values.reserve(m_values.size() + m_pending.size());
+	offsets.push_back(0);
+
+	const pair_type *p = m_pending.empty() ? 0 : &m_pending[0];
+	const pair_type *pEnd = p + m_pending.size();
+	size_t i = 0;
+	while (i < m_keys.size() || p != pEnd)
+	{
+		bool bGroup = i < m_keys.size() && (p == pEnd || !(p->first < m_keys[i]));
+		bool bPending = p != pEnd && (i == m_keys.size() || !(m_keys[i] < p->first));
+		keys.push_back(bGroup ? m_keys[i] : p->first);
+		if (bGroup)
+		{
+			values.insert(values.end(), m_values.begin() + m_offsets[i], m_values.begin() + m_offsets[i + 1]);
+			i++;
+		}
+		if (bPending)
+		{
+			const key_type &k = p->first;
+			for (; p != pEnd && !(k < p->first); ++p)
+				values.push_back(p->second);
+		}
+		offsets.push_back(values.size());
+	}
+
+	m_keys.swap(keys);
+	m_offsets.swap(offsets);
+	m_values.swap(values);
+	std::vector<pair_type>().swap(m_pending);
+	m_search.build(m_keys.begin(), m_keys.end(), flat_key_self());
+}
+
+#endif // _FLAT_GROUPED_MULTIMAP_H_INCLUDED_2026_10_19
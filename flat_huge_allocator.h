@@ -0,0 +1,158 @@
+#ifndef _FLAT_HUGE_ALLOCATOR_H_INCLUDED_2026_10_19
+#define _FLAT_HUGE_ALLOCATOR_H_INCLUDED_2026_10_19
+
+#include <new>
+#include <cstddef>
+#include <stdint.h>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+/*
+ * Huge page backed allocator for flat containers with billions of entries
+ *
+ * Flat huge allocator features
+ * - Blocks of 2MB and more are mapped directly and aligned to 2MB
+ * - Transparent huge pages are requested with madvise(MADV_HUGEPAGE)
+ * - bHugeTLB = true maps from the reserved hugetlbfs pool (MAP_HUGETLB)
+ *   and falls back to a regular mapping when the pool is exhausted
+ * - Small blocks and non-Linux platforms use operator new
+ * - Use reserve() before bulk inserts: vector growth copies the whole array
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+template<typename T, bool bHugeTLB = false>
+class flat_huge_allocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template<typename U>
+	struct rebind
+	{
+		typedef flat_huge_allocator<U, bHugeTLB> other;
+	};
+
+	static const size_t huge_page_size = 2 * 1024 * 1024;
+
+	flat_huge_allocator() {};
+	template<typename U>
+	flat_huge_allocator(const flat_huge_allocator<U, bHugeTLB>&) {};
+
+	pointer allocate(size_type n, const void* = 0);
+	void deallocate(pointer p, size_type n);
+	size_type max_size() const { return static_cast<size_type>(-1) / sizeof(T); }
+
+#if __cplusplus < 201103L
+	pointer address(reference r) const { return &r; }
+	const_pointer address(const_reference r) const { return &r; }
+	void construct(pointer p, const T& v) { new (static_cast<void*>(p)) T(v); }
+	void destroy(pointer p) { p->~T(); }
+#endif
+
+private:
+	static size_t round_up(size_t nBytes) { return (nBytes + huge_page_size - 1) & ~(huge_page_size - 1); }
+	static void* map_huge(size_t nBytes);
+};
+
+template<typename T, bool bHugeTLB>
+inline void* flat_huge_allocator<T, bHugeTLB>::map_huge(size_t nBytes)
+{
+#if defined(__linux__)
+#if defined(MAP_HUGETLB)
+	if (bHugeTLB)
+	{
+		void *p = mmap(0, nBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED)
+			return p;
+	}
+#endif
+	// over-mapping by one huge page so the block can be trimmed to a 2MB boundary
+	size_t nMapped = nBytes + huge_page_size;
+	char *pMapped = static_cast<char*>(mmap(0, nMapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+	if (static_cast<void*>(pMapped) == MAP_FAILED)
+		return 0;
+	char *pAligned = reinterpret_cast<char*>(round_up(reinterpret_cast<uintptr_t>(pMapped)));
+	if (pAligned != pMapped)
+		munmap(pMapped, pAligned - pMapped);
+	size_t nTail = (pMapped + nMapped) - (pAligned + nBytes);
+	if (nTail != 0)
+		munmap(pAligned + nBytes, nTail);
+#if defined(MADV_HUGEPAGE)
+	madvise(pAligned, nBytes, MADV_HUGEPAGE);
+#endif
+	return pAligned;
+#else
+	(void)nBytes;
+	return 0;
+#endif
+}
+
+template<typename T, bool bHugeTLB>
+inline typename flat_huge_allocator<T, bHugeTLB>::pointer flat_huge_allocator<T, bHugeTLB>::allocate(size_type n, const void* /*= 0*/)
+{
+	if (n > max_size())
+		throw std::bad_alloc();
+	size_t nBytes = n * sizeof(T);
+#if defined(__linux__)
+	if (nBytes >= huge_page_size)
+	{
+		void *p = map_huge(round_up(nBytes));
+		if (p == 0)
+			throw std::bad_alloc();
+		return static_cast<pointer>(p);
+	}
+#endif
+	return static_cast<pointer>(::operator new(nBytes));
+}
+
+template<typename T, bool bHugeTLB>
+inline void flat_huge_allocator<T, bHugeTLB>::deallocate(pointer p, size_type n)
+{
+	size_t nBytes = n * sizeof(T);
+#if defined(__linux__)
+	if (nBytes >= huge_page_size)
+	{
+		munmap(p, round_up(nBytes));
+		return;
+	}
+#endif
+	::operator delete(p);
+}
+
+template<typename T, typename U, bool bHugeTLB>
+inline bool operator== (const flat_huge_allocator<T, bHugeTLB>&, const flat_huge_allocator<U, bHugeTLB>&) { return true; }
+
+template<typename T, typename U, bool bHugeTLB>
+inline bool operator!= (const flat_huge_allocator<T, bHugeTLB>&, const flat_huge_allocator<U, bHugeTLB>&) { return false; }
+
+#endif // _FLAT_HUGE_ALLOCATOR_H_INCLUDED_2026_10_19
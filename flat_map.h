@@ -2,7 +2,11 @@
 #define _FLAT_MAP_H_INCLUDED_2015_01_17
 
 #include <vector>
+#include <memory>
 #include <algorithm>
+#include <functional>
+#include <limits>
+#include "flat_search.h"
 
 /*
  * Minimalistic map C++ template based on vector
@@ -10,6 +14,10 @@
  * Flat map features
  * - Stores keys and values inside a vector, not in a binary tree
  * - Works faster for a work flow in which many adds follows many lookups
+ * - Lookup strategy is selected by a search policy (see flat_search.h)
+ * - Storage allocator is a template parameter (see flat_huge_allocator.h)
+ * - flat_multimap can order the values of equal keys to find (key, value) pairs in O(log n),
+ *   flat_multimap_by_value does it without spelling out the allocator
  *
  * The MIT License (MIT)
  *
@@ -81,18 +89,170 @@
 #endif // (_MSC_VER < 1400)
 #endif // _MSC_VER
 
-template<typename key_type, typename val_type>
+// Pairs larger than this are sorted through an array of (key, position) entries
+// and moved into place once, duplicates are dropped without moving their values
+#ifndef FLAT_INDIRECT_SORT_BYTES
+#define FLAT_INDIRECT_SORT_BYTES 48
+#endif
+
+template<class T>
+inline void flat_move_assign(T &dst, T &src)
+{
+#ifdef ENABLE_MOVE_SEMANTICS
+	dst = std::move(src);
+#else
+	dst = src;
+#endif
+}
+
+template<class T>
+struct flat_less_first
+{
+	bool operator() (const T& lhs, const T& rhs) const
+	{
+		return lhs.first < rhs.first;
+	}
+};
+
+// nUnique: 0 keeps all pairs, 1 keeps the last of equal keys, 2 keeps the first
+template<class vector_type>
+void flat_sort_indirect(vector_type &ar, int nUnique)
+{
+	typedef typename vector_type::value_type::first_type key_type;
+	typedef std::pair<key_type, size_t> entry_type;
+	const size_t npos = static_cast<size_t>(-1);
+
+	size_t n = ar.size();
+	std::vector<entry_type> entries;
+	entries.reserve(n);
+	for (size_t i = 0; i < n; i++)
+		entries.push_back(entry_type(ar[i].first, i));
+	std::stable_sort(entries.begin(), entries.end(), flat_less_first<entry_type>());
+
+	// src[j] is the position of the pair which goes to j, dst is the inverse
+	std::vector<size_t> src;
+	src.reserve(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		if (nUnique == 1 && i + 1 < n && entries[i + 1].first == entries[i].first)
+			continue;
+		if (nUnique == 2 && i > 0 && entries[i - 1].first == entries[i].first)
+			continue;
+		src.push_back(entries[i].second);
+	}
+	std::vector<entry_type>().swap(entries);
+	size_t m = src.size();
+	std::vector<size_t> dst(n, npos);
+	for (size_t j = 0; j < m; j++)
+		dst[src[j]] = j;
+
+	// chains which start at a dropped pair end at a position beyond m
+	for (size_t j = 0; j < m; j++)
+	{
+		if (dst[j] != npos)
+			continue;
+		for (size_t s = j; ; )
+		{
+			size_t i = src[s];
+			flat_move_assign(ar[s], ar[i]);
+			src[s] = npos;
+			if (i >= m)
+				break;
+			s = i;
+		}
+	}
+	// the rest are cycles
+	for (size_t j = 0; j < m; j++)
+	{
+		if (src[j] == npos || src[j] == j)
+			continue;
+#ifdef ENABLE_MOVE_SEMANTICS
+		typename vector_type::value_type tmp(std::move(ar[j]));
+#else
+		typename vector_type::value_type tmp(ar[j]);
+#endif
+		for (size_t s = j; ; )
+		{
+			size_t i = src[s];
+			src[s] = npos;
+			if (i == j)
+			{
+				flat_move_assign(ar[s], tmp);
+				break;
+			}
+			flat_move_assign(ar[s], ar[i]);
+			s = i;
+		}
+	}
+	ar.erase(ar.begin() + m, ar.end());
+}
+
+// Value order of flat_multimap: values of equal keys keep the order of their inserts
+struct flat_insertion_order
+{
+};
+
+// Compares values of pairs by val_less_type, pairs and values can be mixed
+template<class T, class val_less_type>
+struct flat_less_value
+{
+	flat_less_value(const val_less_type &less) : m_less(less) {};
+
+	bool operator() (const T& lhs, const T& rhs) const { return m_less(lhs.second, rhs.second); }
+	bool operator() (const T& p, const typename T::second_type& v) const { return m_less(p.second, v); }
+	bool operator() (const typename T::second_type& v, const T& p) const { return m_less(v, p.second); }
+	val_less_type m_less;
+};
+
+template<class T, class val_less_type>
+struct flat_less_key_value
+{
+	flat_less_key_value(const val_less_type &less) : m_less(less) {};
+
+	bool operator() (const T& lhs, const T& rhs) const
+	{
+		if (lhs.first < rhs.first) return true;
+		if (rhs.first < lhs.first) return false;
+		return m_less(lhs.second, rhs.second);
+	}
+	val_less_type m_less;
+};
+
+// Sorts the values of every group of equal keys of a vector sorted by key
+template<class vector_type>
+inline void flat_order_values(vector_type &, const flat_insertion_order &)
+{
+}
+
+template<class vector_type, class val_less_type>
+inline void flat_order_values(vector_type &ar, const val_less_type &less)
+{
+	typedef typename vector_type::value_type pair_type;
+	size_t n = ar.size();
+	for (size_t i0 = 0, i1; i0 < n; i0 = i1)
+	{
+		for (i1 = i0 + 1; i1 < n && !(ar[i0].first < ar[i1].first); i1++)
+			;
+		if (i1 - i0 > 1)
+			std::stable_sort(ar.begin() + i0, ar.begin() + i1, flat_less_value<pair_type, val_less_type>(less));
+	}
+}
+
+
+template<typename key_type, typename val_type, typename search_type = flat_search_binary, typename allocator_type = std::allocator<std::pair<key_type, val_type> > >
 class flat_map
 {
 public:
 	typedef std::pair<key_type, val_type> pair_type;
-	typedef typename std::vector<pair_type >::iterator iterator;
+	typedef typename std::vector<pair_type, allocator_type>::iterator iterator;
 	typedef std::pair<iterator, iterator> iterator_pair;
 
-	flat_map() : m_bSorted(true) {};
+	class lazy_iterator;
+
+	flat_map() : m_bSorted(true), m_nShrinkPercent(0), m_nPrefix(0), m_nGap(0) {};
 #ifdef ENABLE_MOVE_SEMANTICS
 	flat_map(const flat_map& rhs) = default;
-	flat_map(flat_map&& rhs) NOEXCEPT{ swap(rhs); };
+	flat_map(flat_map&& rhs) NOEXCEPT : m_bSorted(true), m_nShrinkPercent(0), m_nPrefix(0), m_nGap(0) { swap(rhs); };
 	flat_map &operator=(const flat_map &rhs) = default;
 #endif
 
@@ -117,10 +277,62 @@ public:
 
 	iterator begin();
 	iterator end();
+	// at most nParts ranges covering the elements in order, for work on several threads
+	std::vector<iterator_pair> split(size_t nParts);
+
+	search_type &search() { return m_search; }
+
+	size_t capacity() const { return ar.capacity(); }
+	// bytes of the element buffer and of the search structures
+	size_t memory_usage() const { return ar.capacity()*sizeof(pair_type) + m_search.memory_usage(); }
+	// sort() and erase() shrink the buffer when more than nPercent of size() is unused, 0 never shrinks
+	void set_shrink_threshold(unsigned nPercent) { m_nShrinkPercent = nPercent; }
+	void shrink_to_fit();
 
 	void sort(bool bPriorityFirstUnique = false);
+	// takes elements of v, which must be sorted by key without duplicates, v gets the old elements
+	void adopt_sorted(std::vector<pair_type, allocator_type> &v);
+
+	// Incremental sorting: only the smallest keys are sorted and deduplicated (the last wins as in sort()),
+	// the rest stays unsorted until it is needed. Returns the number of sorted elements, at least nCount
+	// unless there are less unique keys. Any other call except lazy iteration sorts the whole map.
+	size_t sort_first(size_t nCount);
+	// the nCount smallest elements, valid until the map changes
+	iterator_pair first_k(size_t nCount);
+	// i-th smallest key, i < size()
+	const key_type &nth_key(size_t i);
+	// iteration which sorts as it advances
+	lazy_iterator lazy_begin();
+	lazy_iterator lazy_end() { return lazy_iterator(this, static_cast<size_t>(-1)); }
+
+	class lazy_iterator
+	{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef pair_type value_type;
+		typedef ptrdiff_t difference_type;
+		typedef pair_type* pointer;
+		typedef pair_type& reference;
+
+		lazy_iterator() : m_pMap(0), m_nPos(0) {};
+		lazy_iterator(flat_map *pMap, size_t nPos) : m_pMap(pMap), m_nPos(nPos) {};
+
+		pair_type &operator*() const { return m_pMap->ar[m_nPos]; }
+		pair_type *operator->() const { return &m_pMap->ar[m_nPos]; }
+		lazy_iterator &operator++() { m_pMap->sort_first(++m_nPos + 1); return *this; }
+		lazy_iterator operator++(int) { lazy_iterator it = *this; ++*this; return it; }
+		bool operator==(const lazy_iterator &rhs) const { return at_end() ? rhs.at_end() : m_nPos == rhs.m_nPos && !rhs.at_end(); }
+		bool operator!=(const lazy_iterator &rhs) const { return !(*this == rhs); }
+
+	private:
+		bool at_end() const { return m_pMap == 0 || m_nPos >= m_pMap->sorted_prefix(); }
+
+		flat_map *m_pMap;
+		size_t m_nPos;
+	};
 
 private:
+	friend class lazy_iterator;
 	template<class T>
 	struct flat_map_less_key
 	{
@@ -151,22 +363,55 @@ private:
 		const typename T::first_type& m_key;
 	};
 
-	std::vector<pair_type> ar;
+	template<class T>
+	struct flat_map_less_key1
+	{
+		flat_map_less_key1(const typename T::first_type& k) : m_key(k) {};
+
+		bool operator() (const T& p) const
+		{
+			return p.first < m_key;
+		}
+		const typename T::first_type& m_key;
+	};
+
+	std::vector<pair_type, allocator_type> ar;
+	search_type m_search;
 	bool m_bSorted;
+	unsigned m_nShrinkPercent;
+
+	// Incremental sorting state: ar[0, m_nPrefix) is sorted and unique, m_nGap dropped duplicates
+	// follow it, then the unsorted rest split by m_bounds, all keys before a bound are less than
+	// the keys after it. The nearest bound is the last one.
+	size_t m_nPrefix;
+	size_t m_nGap;
+	std::vector<size_t> m_bounds;
+
+	void shrink_if_wasted();
+	size_t sorted_prefix() const { return m_bSorted ? ar.size() : m_nPrefix; }
+	void finish_segment(size_t i0, size_t i1, bool bEqualKeys);
+	void reset_prefix();
+#ifdef ENABLE_TEMPLATE_OVERLOADS
+	// a number of another type uses the search policy when key_type holds it exactly, see flat_numeric_key
+	template <typename U> iterator find_other(const U &k, flat_bool<true>) { key_type t; return flat_numeric_key(k, t) ? find(t) : ar.end(); }
+	template <typename U> iterator find_other(const U &k, flat_bool<false>);
+#endif
 };
 
-template<typename key_type, typename val_type>
+// val_less_type orders values of equal keys, see find(k, v)
+template<typename key_type, typename val_type, typename search_type = flat_search_binary, typename allocator_type = std::allocator<std::pair<key_type, val_type> >, typename val_less_type = flat_insertion_order>
 class flat_multimap
 {
 public:
 	typedef std::pair<key_type, val_type> pair_type;
-	typedef typename std::vector<pair_type >::iterator iterator;
+	typedef typename std::vector<pair_type, allocator_type>::iterator iterator;
 	typedef std::pair<iterator, iterator> iterator_pair;
 
-	flat_multimap() : m_bSorted(true) {};
+	flat_multimap() : m_bSorted(true), m_nShrinkPercent(0) {};
+	explicit flat_multimap(const val_less_type &valLess) : m_valLess(valLess), m_bSorted(true), m_nShrinkPercent(0) {};
 #ifdef ENABLE_MOVE_SEMANTICS
 	flat_multimap(const flat_multimap& rhs) = default;
-	flat_multimap(flat_multimap&& rhs) NOEXCEPT{ swap(rhs); };
+	flat_multimap(flat_multimap&& rhs) NOEXCEPT : m_bSorted(true), m_nShrinkPercent(0) { swap(rhs); };
 	flat_multimap &operator=(const flat_multimap &rhs) = default;
 #endif
 
@@ -186,10 +431,38 @@ public:
 	iterator erase(iterator i0, iterator i1);
 	void swap(flat_multimap& other) NOEXCEPT;
 
+	// Pairs of a key and a value. With a val_less_type values of a key are sorted and
+	// searched in O(log n), values are equal when neither is less. With flat_insertion_order
+	// find(), count() and erase() compare the values of the key by == and lower_bound(),
+	// upper_bound() and value_range() do not compile.
+	iterator find(const key_type &k, const val_type &v);
+	iterator lower_bound(const key_type &k, const val_type &v);
+	iterator upper_bound(const key_type &k, const val_type &v);
+	// elements of key k with values in [v0, v1)
+	iterator_pair value_range(const key_type &k, const val_type &v0, const val_type &v1);
+	size_t count(const key_type &k, const val_type &v);
+	// erases one element of key k and value v
+	iterator erase(const key_type &k, const val_type &v);
+	const val_less_type &value_less() const { return m_valLess; }
+
 	iterator begin();
 	iterator end();
+	// at most nParts ranges covering the elements in order, equal keys never straddle two ranges
+	std::vector<iterator_pair> split(size_t nParts);
+
+	search_type &search() { return m_search; }
+
+	size_t capacity() const { return ar.capacity(); }
+	// bytes of the element buffer and of the search structures
+	size_t memory_usage() const { return ar.capacity()*sizeof(pair_type) + m_search.memory_usage(); }
+	// sort() and erase() shrink the buffer when more than nPercent of size() is unused, 0 never shrinks
+	void set_shrink_threshold(unsigned nPercent) { m_nShrinkPercent = nPercent; }
+	void shrink_to_fit();
 
 	void sort();
+	// takes elements of v, which must be sorted by key and then by value with a val_less_type,
+	// v gets the old elements
+	void adopt_sorted(std::vector<pair_type, allocator_type> &v);
 
 private:
 	template<class T>
@@ -222,183 +495,362 @@ private:
 		const typename T::first_type& m_key;
 	};
 
-	std::vector<pair_type> ar;
+	std::vector<pair_type, allocator_type> ar;
+	search_type m_search;
+	val_less_type m_valLess;
 	int m_bSorted;
+	unsigned m_nShrinkPercent;
+
+	void shrink_if_wasted();
+	iterator find_value(iterator_pair pit, const val_type &v, const flat_insertion_order &);
+	template<class L> iterator find_value(iterator_pair pit, const val_type &v, const L &);
+	size_t count_value(iterator_pair pit, const val_type &v, const flat_insertion_order &);
+	template<class L> size_t count_value(iterator_pair pit, const val_type &v, const L &);
+	void sort_pairs(const flat_insertion_order &);
+	template<class L> void sort_pairs(const L &);
+};
+
+// flat_multimap with the values of equal keys ordered by val_less_type and the default allocator
+template<typename key_type, typename val_type, typename val_less_type = std::less<val_type>, typename search_type = flat_search_binary>
+class flat_multimap_by_value : public flat_multimap<key_type, val_type, search_type, std::allocator<std::pair<key_type, val_type> >, val_less_type>
+{
+	typedef flat_multimap<key_type, val_type, search_type, std::allocator<std::pair<key_type, val_type> >, val_less_type> base_type;
+
+public:
+	flat_multimap_by_value() {};
+	explicit flat_multimap_by_value(const val_less_type &valLess) : base_type(valLess) {};
 };
 
 //------------------------------------- flat_map -----------------------------------------
 
-template<typename key_type, typename val_type>
-inline void flat_map<key_type, val_type>::clear()
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline void flat_map<key_type, val_type, search_type, allocator_type>::clear()
 {
+	reset_prefix();
 	ar.clear();
+	m_search.invalidate();
 	m_bSorted = true;
 }
 
-template<typename key_type, typename val_type>
-inline void flat_map<key_type, val_type>::reserve(size_t size)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline void flat_map<key_type, val_type, search_type, allocator_type>::reserve(size_t size)
 {
 	ar.reserve(size);
 }
 
-template<typename key_type, typename val_type>
-inline void flat_map<key_type, val_type>::insert(const pair_type &p)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline void flat_map<key_type, val_type, search_type, allocator_type>::insert(const pair_type &p)
 {
+	reset_prefix();
 	ar.push_back(p);
 	m_bSorted = false;
 }
 
-template<typename key_type, typename val_type>
-inline void flat_map<key_type, val_type>::insert(const key_type &k, const val_type &v)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline void flat_map<key_type, val_type, search_type, allocator_type>::insert(const key_type &k, const val_type &v)
 {
+	reset_prefix();
 	ar.push_back(std::make_pair(k, v));
 	m_bSorted = false;
 }
 
-template<typename key_type, typename val_type>
-inline typename flat_map<key_type, val_type>::iterator flat_map<key_type, val_type>::find(const key_type &k)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline typename flat_map<key_type, val_type, search_type, allocator_type>::iterator flat_map<key_type, val_type, search_type, allocator_type>::find(const key_type &k)
 {
 	if (!m_bSorted) sort();
-	pair_type p;
-	p.first = k;
-	iterator_pair pit = std::equal_range(ar.begin(), ar.end(), p,
-		flat_map_less_key<pair_type>());
-	if (pit.first == pit.second)
-		return ar.end();
-	return pit.first;
+	return m_search.find(ar.begin(), ar.end(), k, flat_key_first());
 }
 
 #ifdef ENABLE_TEMPLATE_OVERLOADS
-template<typename key_type, typename val_type>
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
 template<typename U>
-inline typename flat_map<key_type, val_type>::iterator flat_map<key_type, val_type>::find(const U &k)
+inline typename flat_map<key_type, val_type, search_type, allocator_type>::iterator flat_map<key_type, val_type, search_type, allocator_type>::find(const U &k)
+{
+	return find_other(k, flat_bool<flat_is_number<key_type>::value && flat_is_number<U>::value>());
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+template<typename U>
+inline typename flat_map<key_type, val_type, search_type, allocator_type>::iterator flat_map<key_type, val_type, search_type, allocator_type>::find_other(const U &k, flat_bool<false>)
 {
 	if (ar.size() == 0) return ar.end();
 	if (!m_bSorted) sort();
 
-	int lk = 0;
-	int rk = ar.size() - 1;
-	while (true)
+	size_t lk = 0;
+	size_t rk = ar.size();
+	while (lk < rk)
 	{
-		int i = (lk + rk) / 2;
+		size_t i = lk + (rk - lk) / 2;
 		if (ar[i].first < k)
 			lk = i + 1;
 		else
 			if (ar[i].first == k)
 				return ar.begin() + i;
 			else
-				rk = i - 1;
-		if (lk>rk) return ar.end();
+				rk = i;
 	}
+	return ar.end();
 }
 #endif
 
-template<typename key_type, typename val_type>
-inline typename flat_map<key_type, val_type>::iterator flat_map<key_type, val_type>::lower_bound(const key_type &k)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline typename flat_map<key_type, val_type, search_type, allocator_type>::iterator flat_map<key_type, val_type, search_type, allocator_type>::lower_bound(const key_type &k)
 {
 	if (!m_bSorted) sort();
-	pair_type p;
-	p.first = k;
-	iterator it = std::lower_bound(ar.begin(), ar.end(), p,
-		flat_map_less_key<pair_type>());
-	return it;
+	return m_search.lower_bound(ar.begin(), ar.end(), k, flat_key_first());
 }
 
-template<typename key_type, typename val_type>
-inline typename flat_map<key_type, val_type>::iterator flat_map<key_type, val_type>::upper_bound(const key_type &k)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline typename flat_map<key_type, val_type, search_type, allocator_type>::iterator flat_map<key_type, val_type, search_type, allocator_type>::upper_bound(const key_type &k)
 {
 	if (!m_bSorted) sort();
-	pair_type p;
-	p.first = k;
-	iterator it = std::upper_bound(ar.begin(), ar.end(), p,
-		flat_map_less_key<pair_type>());
-	return it;
+	return m_search.upper_bound(ar.begin(), ar.end(), k, flat_key_first());
 }
 
-template<typename key_type, typename val_type>
-inline typename flat_map<key_type, val_type>::iterator_pair flat_map<key_type, val_type>::equal_range(const key_type &k)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline typename flat_map<key_type, val_type, search_type, allocator_type>::iterator_pair flat_map<key_type, val_type, search_type, allocator_type>::equal_range(const key_type &k)
 {
 	if (!m_bSorted) sort();
-	pair_type p;
-	p.first = k;
-	iterator_pair pit = std::equal_range(ar.begin(), ar.end(), p,
-		flat_map_less_key<pair_type>());
-	return pit;
+	iterator it = m_search.lower_bound(ar.begin(), ar.end(), k, flat_key_first());
+	if (it == ar.end() || k < it->first)
+		return iterator_pair(it, it);
+	return iterator_pair(it, it + 1);
 }
 
-template<typename key_type, typename val_type>
-inline size_t flat_map<key_type, val_type>::count(const key_type &k)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline size_t flat_map<key_type, val_type, search_type, allocator_type>::count(const key_type &k)
 {
 	if (!m_bSorted) sort();
-	pair_type p;
-	p.first = k;
-	bool b = std::binary_search(ar.begin(), ar.end(), p,
-		flat_map_less_key<pair_type>());
-	if (!b) return 0;
+	iterator it = m_search.find(ar.begin(), ar.end(), k, flat_key_first());
+	if (it == ar.end()) return 0;
 	return 1;
 }
 
-template<typename key_type, typename val_type>
-inline size_t flat_map<key_type, val_type>::size()
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline size_t flat_map<key_type, val_type, search_type, allocator_type>::size()
 {
 	if (!m_bSorted) sort();
 	return ar.size();
 }
 
-template<typename key_type, typename val_type>
-inline bool flat_map<key_type, val_type>::empty()
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline bool flat_map<key_type, val_type, search_type, allocator_type>::empty()
 {
 	return ar.size()==0;
 }
 
-template<typename key_type, typename val_type>
-inline typename flat_map<key_type, val_type>::iterator flat_map<key_type, val_type>::erase(const key_type &k)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline typename flat_map<key_type, val_type, search_type, allocator_type>::iterator flat_map<key_type, val_type, search_type, allocator_type>::erase(const key_type &k)
 {
+	reset_prefix();
 	flat_map_equal_key1<pair_type> pred(k);
-	iterator it = ar.erase(std::remove_if(ar.begin(), ar.end(), pred));
-	return it;
+	size_t nPos = ar.erase(std::remove_if(ar.begin(), ar.end(), pred), ar.end()) - ar.begin();
+	m_search.invalidate();
+	shrink_if_wasted();
+	return ar.begin() + nPos;
 }
 
-template<typename key_type, typename val_type>
-inline typename flat_map<key_type, val_type>::iterator flat_map<key_type, val_type>::erase(iterator i0)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline typename flat_map<key_type, val_type, search_type, allocator_type>::iterator flat_map<key_type, val_type, search_type, allocator_type>::erase(iterator i0)
 {
-	iterator it = ar.erase(i0);
-	return it;
+	reset_prefix();
+	size_t nPos = ar.erase(i0) - ar.begin();
+	m_search.invalidate();
+	shrink_if_wasted();
+	return ar.begin() + nPos;
 }
 
-template<typename key_type, typename val_type>
-inline typename flat_map<key_type, val_type>::iterator flat_map<key_type, val_type>::erase(iterator i0, iterator i1)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline typename flat_map<key_type, val_type, search_type, allocator_type>::iterator flat_map<key_type, val_type, search_type, allocator_type>::erase(iterator i0, iterator i1)
 {
-	iterator it = ar.erase(i0, i1);
-	return it;
+	reset_prefix();
+	size_t nPos = ar.erase(i0, i1) - ar.begin();
+	m_search.invalidate();
+	shrink_if_wasted();
+	return ar.begin() + nPos;
 }
 
-template<typename key_type, typename val_type>
-inline void flat_map<key_type, val_type>::swap(flat_map<key_type, val_type>& other) NOEXCEPT
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline void flat_map<key_type, val_type, search_type, allocator_type>::swap(flat_map<key_type, val_type, search_type, allocator_type>& other) NOEXCEPT
 {
 	std::swap(m_bSorted, other.m_bSorted);
+	std::swap(m_nShrinkPercent, other.m_nShrinkPercent);
+	std::swap(m_nPrefix, other.m_nPrefix);
+	std::swap(m_nGap, other.m_nGap);
+	m_bounds.swap(other.m_bounds);
 	std::swap(ar, other.ar);
+	std::swap(m_search, other.m_search);
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline void flat_map<key_type, val_type, search_type, allocator_type>::shrink_to_fit()
+{
+	std::vector<pair_type, allocator_type>(ar.begin(), ar.end(), ar.get_allocator()).swap(ar);
 }
 
-template<typename key_type, typename val_type>
-inline typename flat_map<key_type, val_type>::iterator flat_map<key_type, val_type>::begin()
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline void flat_map<key_type, val_type, search_type, allocator_type>::shrink_if_wasted()
+{
+	if (m_nShrinkPercent != 0 && ar.capacity() > 16 && (ar.capacity() - ar.size()) * 100 > ar.size() * m_nShrinkPercent)
+		shrink_to_fit();
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline void flat_map<key_type, val_type, search_type, allocator_type>::reset_prefix()
+{
+	if (m_bounds.empty())
+		return;
+	// the prefix stays, it only loses the gap
+	ar.erase(ar.begin() + m_nPrefix, ar.begin() + m_nPrefix + m_nGap);
+	m_bounds.clear();
+	m_nPrefix = 0;
+	m_nGap = 0;
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline void flat_map<key_type, val_type, search_type, allocator_type>::finish_segment(size_t i0, size_t i1, bool bEqualKeys)
+{
+	if (!bEqualKeys)
+		std::stable_sort(ar.begin() + i0, ar.begin() + i1, flat_map_less_key<pair_type>());
+	// the last of equal keys is kept and moved down over the gap
+	for (size_t i = i0; i < i1; i++)
+		if (i + 1 == i1 || !(ar[i + 1].first == ar[i].first))
+		{
+			if (m_nPrefix != i)
+				ar[m_nPrefix] = ar[i];
+			m_nPrefix++;
+		}
+	m_nGap = i1 - m_nPrefix;
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline size_t flat_map<key_type, val_type, search_type, allocator_type>::sort_first(size_t nCount)
+{
+	if (m_bSorted)
+		return ar.size();
+	if (m_bounds.empty())
+	{
+		if (ar.size() < 2)
+		{
+			sort();
+			return ar.size();
+		}
+		m_bounds.push_back(ar.size());
+	}
+
+	// incremental quicksort with stable partitions, so equal keys keep the order of insertion
+	const size_t nSmall = 32;
+	while (m_nPrefix < nCount && !m_bounds.empty())
+	{
+		size_t i0 = m_nPrefix + m_nGap;
+		size_t i1 = m_bounds.back();
+		if (i1 - i0 <= nSmall)
+		{
+			finish_segment(i0, i1, false);
+			m_bounds.pop_back();
+			continue;
+		}
+
+		const key_type &k0 = ar[i0].first;
+		const key_type &k1 = ar[i0 + (i1 - i0) / 2].first;
+		const key_type &k2 = ar[i1 - 1].first;
+		key_type pivot = k0 < k1 ? (k1 < k2 ? k1 : (k0 < k2 ? k2 : k0)) : (k0 < k2 ? k0 : (k1 < k2 ? k2 : k1));
+		iterator itLess = std::stable_partition(ar.begin() + i0, ar.begin() + i1, flat_map_less_key1<pair_type>(pivot));
+		iterator itEqual = std::stable_partition(itLess, ar.begin() + i1, flat_map_equal_key1<pair_type>(pivot));
+		size_t nLess = itLess - ar.begin();
+		size_t nEqual = itEqual - ar.begin();
+		if (nLess == i0)
+		{
+			// the smallest keys are all equal to the pivot
+			finish_segment(i0, nEqual, true);
+			if (nEqual == i1)
+				m_bounds.pop_back();
+			continue;
+		}
+		if (nEqual != i1)
+			m_bounds.push_back(nEqual);
+		m_bounds.push_back(nLess);
+	}
+
+	if (m_bounds.empty())
+	{
+		ar.erase(ar.begin() + m_nPrefix, ar.end());
+		m_nPrefix = 0;
+		m_nGap = 0;
+		shrink_if_wasted();
+		m_search.build(ar.begin(), ar.end(), flat_key_first());
+		m_bSorted = true;
+		return ar.size();
+	}
+	return m_nPrefix;
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline typename flat_map<key_type, val_type, search_type, allocator_type>::iterator_pair flat_map<key_type, val_type, search_type, allocator_type>::first_k(size_t nCount)
+{
+	size_t n = std::min(nCount, sort_first(nCount));
+	return iterator_pair(ar.begin(), ar.begin() + n);
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline const key_type &flat_map<key_type, val_type, search_type, allocator_type>::nth_key(size_t i)
+{
+	sort_first(i + 1);
+	return ar[i].first;
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline typename flat_map<key_type, val_type, search_type, allocator_type>::lazy_iterator flat_map<key_type, val_type, search_type, allocator_type>::lazy_begin()
+{
+	sort_first(1);
+	return lazy_iterator(this, 0);
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline void flat_map<key_type, val_type, search_type, allocator_type>::adopt_sorted(std::vector<pair_type, allocator_type> &v)
+{
+	reset_prefix();
+	ar.swap(v);
+	m_search.build(ar.begin(), ar.end(), flat_key_first());
+	m_bSorted = true;
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline typename flat_map<key_type, val_type, search_type, allocator_type>::iterator flat_map<key_type, val_type, search_type, allocator_type>::begin()
 {
 	if (!m_bSorted) sort();
 	return ar.begin();
 }
 
-template<typename key_type, typename val_type>
-inline typename flat_map<key_type, val_type>::iterator flat_map<key_type, val_type>::end()
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline typename flat_map<key_type, val_type, search_type, allocator_type>::iterator flat_map<key_type, val_type, search_type, allocator_type>::end()
 {
 	if (!m_bSorted) sort();
 	return ar.end();
 }
 
-template<typename key_type, typename val_type>
-void inline flat_map<key_type, val_type>::sort(bool bPriorityFirstUnique /*= false*/)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline std::vector<typename flat_map<key_type, val_type, search_type, allocator_type>::iterator_pair> flat_map<key_type, val_type, search_type, allocator_type>::split(size_t nParts)
 {
+	if (!m_bSorted) sort();
+	return flat_split_ranges(ar.begin(), ar.end(), nParts, false, flat_key_first());
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+void inline flat_map<key_type, val_type, search_type, allocator_type>::sort(bool bPriorityFirstUnique /*= false*/)
+{
+	reset_prefix();
 	if (ar.size() < 2)
 	{
+		m_search.build(ar.begin(), ar.end(), flat_key_first());
+		m_bSorted = true;
+		return;
+	}
+	if (sizeof(pair_type) > FLAT_INDIRECT_SORT_BYTES)
+	{
+		flat_sort_indirect(ar, bPriorityFirstUnique ? 2 : 1);
+		shrink_if_wasted();
+		m_search.build(ar.begin(), ar.end(), flat_key_first());
 		m_bSorted = true;
 		return;
 	}
@@ -409,10 +861,10 @@ void inline flat_map<key_type, val_type>::sort(bool bPriorityFirstUnique /*= fal
 	// reversing first and last unique values
 	if (!bPriorityFirstUnique)
 	{
-		int nLast = static_cast<int>(ar.size()) - 1;
-		int nFirstUnique = nLast;
-		int nLastUnique = nLast;
-		for (int i = nLast - 1; i >= 0; i--)
+		size_t nLast = ar.size() - 1;
+		size_t nFirstUnique = nLast;
+		size_t nLastUnique = nLast;
+		for (size_t i = nLast; i-- > 0; )
 		{
 			if (ar[i].first == ar[nLastUnique].first)
 			{
@@ -426,166 +878,288 @@ void inline flat_map<key_type, val_type>::sort(bool bPriorityFirstUnique /*= fal
 		}
 	}
 	ar.erase(std::unique(i0, i1, flat_map_equal_key<pair_type>()), i1);
+	shrink_if_wasted();
 
+	m_search.build(ar.begin(), ar.end(), flat_key_first());
 	m_bSorted = true;
 }
 
 //----------------------------------- flat_multimap ---------------------------------------
 
-template<typename key_type, typename val_type>
-inline void flat_multimap<key_type, val_type>::clear()
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline void flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::clear()
 {
 	ar.clear();
+	m_search.invalidate();
 	m_bSorted = true;
 }
 
-template<typename key_type, typename val_type>
-inline void flat_multimap<key_type, val_type>::reserve(size_t size)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline void flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::reserve(size_t size)
 {
 	ar.reserve(size);
 }
 
-template<typename key_type, typename val_type>
-inline void flat_multimap<key_type, val_type>::insert(const pair_type &p)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline void flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::insert(const pair_type &p)
 {
 	ar.push_back(p);
 	m_bSorted = false;
 }
 
-template<typename key_type, typename val_type>
-inline void flat_multimap<key_type, val_type>::insert(const key_type &k, const val_type &v)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline void flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::insert(const key_type &k, const val_type &v)
 {
 	ar.push_back(std::make_pair(k, v));
 	m_bSorted = false;
 }
 
-template<typename key_type, typename val_type>
-inline typename flat_multimap<key_type, val_type>::iterator flat_multimap<key_type, val_type>::find(const key_type &k)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline typename flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::iterator flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::find(const key_type &k)
 {
 	if (!m_bSorted) sort();
-	pair_type p;
-	p.first = k;
-	iterator_pair pit = std::equal_range(ar.begin(), ar.end(), p,
-		flat_multimap_less_key<pair_type>());
-	if (pit.first == pit.second)
-		return ar.end();
-	return pit.first;
+	return m_search.find(ar.begin(), ar.end(), k, flat_key_first());
 }
 
-template<typename key_type, typename val_type>
-inline typename flat_multimap<key_type, val_type>::iterator flat_multimap<key_type, val_type>::lower_bound(const key_type &k)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline typename flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::iterator flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::lower_bound(const key_type &k)
 {
 	if (!m_bSorted) sort();
-	pair_type p;
-	p.first = k;
-	iterator it = std::lower_bound(ar.begin(), ar.end(), p,
-		flat_multimap_less_key<pair_type>());
-	return it;
+	return m_search.lower_bound(ar.begin(), ar.end(), k, flat_key_first());
 }
 
-template<typename key_type, typename val_type>
-inline typename flat_multimap<key_type, val_type>::iterator flat_multimap<key_type, val_type>::upper_bound(const key_type &k)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline typename flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::iterator flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::upper_bound(const key_type &k)
 {
 	if (!m_bSorted) sort();
-	pair_type p;
-	p.first = k;
-	iterator it = std::upper_bound(ar.begin(), ar.end(), p,
-		flat_multimap_less_key<pair_type>());
-	return it;
+	return m_search.upper_bound(ar.begin(), ar.end(), k, flat_key_first());
 }
 
-template<typename key_type, typename val_type>
-inline typename flat_multimap<key_type, val_type>::iterator_pair flat_multimap<key_type, val_type>::equal_range(const key_type &k)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline typename flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::iterator_pair flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::equal_range(const key_type &k)
 {
 	if (!m_bSorted) sort();
-	pair_type p;
-	p.first = k;
-	iterator_pair pit = std::equal_range(ar.begin(), ar.end(), p,
-		flat_multimap_less_key<pair_type>());
-	return pit;
+	iterator it = m_search.lower_bound(ar.begin(), ar.end(), k, flat_key_first());
+	return iterator_pair(it, m_search.upper_bound(ar.begin(), ar.end(), k, flat_key_first()));
 }
 
 
-template<typename key_type, typename val_type>
-inline size_t flat_multimap<key_type, val_type>::count(const key_type &k)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline size_t flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::count(const key_type &k)
 {
-	if (!m_bSorted) sort();
-	pair_type p;
-	p.first = k;
-	iterator_pair pit = std::equal_range(ar.begin(), ar.end(), p,
-		flat_multimap_less_key<pair_type>());
+	iterator_pair pit = equal_range(k);
 	return std::distance(pit.first, pit.second);
 }
 
-template<typename key_type, typename val_type>
-inline size_t flat_multimap<key_type, val_type>::size()
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline size_t flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::size()
 {
 	return ar.size();
 }
 
-template<typename key_type, typename val_type>
-inline bool flat_multimap<key_type, val_type>::empty()
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline bool flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::empty()
 {
 	return ar.size()==0;
 }
 
-template<typename key_type, typename val_type>
-inline typename flat_multimap<key_type, val_type>::iterator flat_multimap<key_type, val_type>::erase(const key_type &k)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline typename flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::iterator flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::erase(const key_type &k)
 {
 	flat_multimap_equal_key1<pair_type> pred(k);
-	iterator it = ar.erase(std::remove_if(ar.begin(), ar.end(), pred), ar.end());
-	return it;
+	size_t nPos = ar.erase(std::remove_if(ar.begin(), ar.end(), pred), ar.end()) - ar.begin();
+	m_search.invalidate();
+	shrink_if_wasted();
+	return ar.begin() + nPos;
 }
 
-template<typename key_type, typename val_type>
-inline typename flat_multimap<key_type, val_type>::iterator flat_multimap<key_type, val_type>::erase(iterator i0)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline typename flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::iterator flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::erase(iterator i0)
 {
-	iterator it = ar.erase(i0);
-	return it;
+	size_t nPos = ar.erase(i0) - ar.begin();
+	m_search.invalidate();
+	shrink_if_wasted();
+	return ar.begin() + nPos;
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline typename flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::iterator flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::erase(iterator i0, iterator i1)
+{
+	size_t nPos = ar.erase(i0, i1) - ar.begin();
+	m_search.invalidate();
+	shrink_if_wasted();
+	return ar.begin() + nPos;
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline typename flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::iterator flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::find(const key_type &k, const val_type &v)
+{
+	return find_value(equal_range(k), v, m_valLess);
 }
 
-template<typename key_type, typename val_type>
-inline typename flat_multimap<key_type, val_type>::iterator flat_multimap<key_type, val_type>::erase(iterator i0, iterator i1)
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline typename flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::iterator flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::find_value(iterator_pair pit, const val_type &v, const flat_insertion_order &)
 {
-	iterator it = ar.erase(i0, i1);
+	for (iterator it = pit.first; it != pit.second; ++it)
+		if (it->second == v)
+			return it;
+	return ar.end();
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+template<class L>
+inline typename flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::iterator flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::find_value(iterator_pair pit, const val_type &v, const L &less)
+{
+	iterator it = std::lower_bound(pit.first, pit.second, v, flat_less_value<pair_type, L>(less));
+	if (it == pit.second || less(v, it->second))
+		return ar.end();
 	return it;
 }
 
-template<typename key_type, typename val_type>
-inline void flat_multimap<key_type, val_type>::swap(flat_multimap<key_type, val_type>& other) NOEXCEPT
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline typename flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::iterator flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::lower_bound(const key_type &k, const val_type &v)
+{
+	iterator_pair pit = equal_range(k);
+	return std::lower_bound(pit.first, pit.second, v, flat_less_value<pair_type, val_less_type>(m_valLess));
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline typename flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::iterator flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::upper_bound(const key_type &k, const val_type &v)
+{
+	iterator_pair pit = equal_range(k);
+	return std::upper_bound(pit.first, pit.second, v, flat_less_value<pair_type, val_less_type>(m_valLess));
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline typename flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::iterator_pair flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::value_range(const key_type &k, const val_type &v0, const val_type &v1)
+{
+	iterator_pair pit = equal_range(k);
+	flat_less_value<pair_type, val_less_type> less(m_valLess);
+	iterator it0 = std::lower_bound(pit.first, pit.second, v0, less);
+	if (!m_valLess(v0, v1))
+		return iterator_pair(it0, it0);
+	return iterator_pair(it0, std::lower_bound(it0, pit.second, v1, less));
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline size_t flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::count(const key_type &k, const val_type &v)
+{
+	return count_value(equal_range(k), v, m_valLess);
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline size_t flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::count_value(iterator_pair pit, const val_type &v, const flat_insertion_order &)
+{
+	size_t n = 0;
+	for (iterator it = pit.first; it != pit.second; ++it)
+		if (it->second == v)
+			n++;
+	return n;
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+template<class L>
+inline size_t flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::count_value(iterator_pair pit, const val_type &v, const L &less)
+{
+	flat_less_value<pair_type, L> lessValue(less);
+	iterator it = std::lower_bound(pit.first, pit.second, v, lessValue);
+	return std::upper_bound(it, pit.second, v, lessValue) - it;
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline typename flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::iterator flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::erase(const key_type &k, const val_type &v)
+{
+	iterator it = find(k, v);
+	if (it == ar.end())
+		return it;
+	return erase(it);
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline void flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::swap(flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>& other) NOEXCEPT
 {
 	std::swap(m_bSorted, other.m_bSorted);
+	std::swap(m_nShrinkPercent, other.m_nShrinkPercent);
 	std::swap(ar, other.ar);
+	std::swap(m_search, other.m_search);
+	std::swap(m_valLess, other.m_valLess);
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline void flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::shrink_to_fit()
+{
+	std::vector<pair_type, allocator_type>(ar.begin(), ar.end(), ar.get_allocator()).swap(ar);
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline void flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::shrink_if_wasted()
+{
+	if (m_nShrinkPercent != 0 && ar.capacity() > 16 && (ar.capacity() - ar.size()) * 100 > ar.size() * m_nShrinkPercent)
+		shrink_to_fit();
 }
 
-template<typename key_type, typename val_type>
-inline typename flat_multimap<key_type, val_type>::iterator flat_multimap<key_type, val_type>::begin()
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline void flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::adopt_sorted(std::vector<pair_type, allocator_type> &v)
+{
+	ar.swap(v);
+	m_search.build(ar.begin(), ar.end(), flat_key_first());
+	m_bSorted = true;
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline typename flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::iterator flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::begin()
 {
 	if (!m_bSorted) sort();
 	return ar.begin();
 }
 
-template<typename key_type, typename val_type>
-inline typename flat_multimap<key_type, val_type>::iterator flat_multimap<key_type, val_type>::end()
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline typename flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::iterator flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::end()
 {
 	if (!m_bSorted) sort();
 	return ar.end();
 }
 
-template<typename key_type, typename val_type>
-void inline flat_multimap<key_type, val_type>::sort()
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline std::vector<typename flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::iterator_pair> flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::split(size_t nParts)
+{
+	if (!m_bSorted) sort();
+	return flat_split_ranges(ar.begin(), ar.end(), nParts, true, flat_key_first());
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+void inline flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::sort()
 {
 	if (ar.size() < 2)
 	{
+		m_search.build(ar.begin(), ar.end(), flat_key_first());
 		m_bSorted = true;
 		return;
 	}
-	iterator i0 = ar.begin();
-	iterator i1 = ar.end();
-	std::stable_sort(i0, i1, flat_multimap_less_key<pair_type>());
+	if (sizeof(pair_type) > FLAT_INDIRECT_SORT_BYTES)
+	{
+		flat_sort_indirect(ar, 0);
+		flat_order_values(ar, m_valLess);
+	}
+	else
+		sort_pairs(m_valLess);
+	m_search.build(ar.begin(), ar.end(), flat_key_first());
 	m_bSorted = true;
 }
 
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+inline void flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::sort_pairs(const flat_insertion_order &)
+{
+	std::stable_sort(ar.begin(), ar.end(), flat_multimap_less_key<pair_type>());
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type, typename val_less_type>
+template<class L>
+inline void flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type>::sort_pairs(const L &less)
+{
+	std::stable_sort(ar.begin(), ar.end(), flat_less_key_value<pair_type, L>(less));
+}
+
 #ifdef ENABLE_MOVE_SEMANTICS
 #undef ENABLE_MOVE_SEMANTICS
 #endif
@@ -0,0 +1,247 @@
+#ifndef _FLAT_MAP_BUILDER_H_INCLUDED_2026_10_19
+#define _FLAT_MAP_BUILDER_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <atomic>
+#include "flat_map.h"
+
+/*
+ * Parallel bulk builder of flat maps (C++11)
+ *
+ * Flat map builder features
+ * - Every producer thread appends into its own buffer, no locks
+ * - build() sorts the buffers in parallel and merges them in parallel,
+ *   every merging thread takes a range of keys
+ * - Duplicates are resolved as if the buffers were inserted one by one in producer order
+ *   and then sorted by flat_map::sort(bPriorityFirstUnique)
+ * - flat_multimap keeps all duplicates in producer order, or in the order of its val_less_type
+ * - Peak memory is about two copies of the elements, pairs need not be default constructible
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+template<typename key_type, typename val_type>
+class flat_map_builder
+{
+public:
+	typedef std::pair<key_type, val_type> pair_type;
+
+	flat_map_builder(size_t nProducers) : m_buffers(nProducers) {};
+
+	size_t producers() const { return m_buffers.size(); }
+	std::vector<pair_type> &buffer(size_t nProducer) { return m_buffers[nProducer].ar; }
+	void insert(size_t nProducer, const key_type &k, const val_type &v) { m_buffers[nProducer].ar.push_back(std::make_pair(k, v)); }
+	void clear();
+
+	// Builds the map and clears the buffers, nThreads == 0 is the number of hardware threads
+	template<typename search_type, typename allocator_type>
+	void build(flat_map<key_type, val_type, search_type, allocator_type> &map, bool bPriorityFirstUnique = false, size_t nThreads = 0);
+	template<typename search_type, typename allocator_type, typename val_less_type>
+	void build(flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type> &map, size_t nThreads = 0);
+
+private:
+	// aligned to a cache line, producers do not share the vector headers
+	struct alignas(64) producer_buffer
+	{
+		std::vector<pair_type> ar;
+	};
+
+	struct less_key
+	{
+		bool operator() (const pair_type& lhs, const pair_type& rhs) const
+		{
+			return lhs.first < rhs.first;
+		}
+	};
+
+	// head of one buffer during a merge, equal keys are taken in producer order
+	struct merge_head
+	{
+		const pair_type *p;
+		const pair_type *pEnd;
+		size_t nProducer;
+
+		bool operator< (const merge_head& rhs) const
+		{
+			if (rhs.p->first < p->first) return true;
+			if (p->first < rhs.p->first) return false;
+			return nProducer > rhs.nProducer;
+		}
+	};
+
+	enum { UNIQUE_LAST, UNIQUE_FIRST, KEEP_ALL };
+
+	template<typename F>
+	static void run_parallel(size_t nTasks, size_t nThreads, F f);
+
+	template<typename result_type>
+	void build(result_type &result, int nMode, size_t nThreads);
+	void merge(size_t nPart, const std::vector<size_t> &bounds, std::vector<pair_type> &out, int nMode) const;
+
+	std::vector<producer_buffer> m_buffers;
+};
+
+template<typename key_type, typename val_type>
+template<typename F>
+inline void flat_map_builder<key_type, val_type>::run_parallel(size_t nTasks, size_t nThreads, F f)
+{
+	std::atomic<size_t> nNext(0);
+	auto worker = [&]()
+	{
+		for (size_t i = nNext++; i < nTasks; i = nNext++)
+			f(i);
+	};
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < std::min(nThreads, nTasks); i++)
+		threads.push_back(std::thread(worker));
+	worker();
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+}
+
+template<typename key_type, typename val_type>
+inline void flat_map_builder<key_type, val_type>::clear()
+{
+	for (size_t i = 0; i < m_buffers.size(); i++)
+		std::vector<pair_type>().swap(m_buffers[i].ar);
+}
+
+template<typename key_type, typename val_type>
+template<typename search_type, typename allocator_type>
+inline void flat_map_builder<key_type, val_type>::build(flat_map<key_type, val_type, search_type, allocator_type> &map, bool bPriorityFirstUnique /*= false*/, size_t nThreads /*= 0*/)
+{
+	std::vector<pair_type, allocator_type> result;
+	build(result, bPriorityFirstUnique ? UNIQUE_FIRST : UNIQUE_LAST, nThreads);
+	map.adopt_sorted(result);
+}
+
+template<typename key_type, typename val_type>
+template<typename search_type, typename allocator_type, typename val_less_type>
+inline void flat_map_builder<key_type, val_type>::build(flat_multimap<key_type, val_type, search_type, allocator_type, val_less_type> &map, size_t nThreads /*= 0*/)
+{
+	std::vector<pair_type, allocator_type> result;
+	build(result, KEEP_ALL, nThreads);
+	flat_order_values(result, map.value_less());
+	map.adopt_sorted(result);
+}
+
+template<typename key_type, typename val_type>
+inline void flat_map_builder<key_type, val_type>::merge(size_t nPart, const std::vector<size_t> &bounds, std::vector<pair_type> &out, int nMode) const
+{
+	// bounds[p * nBuffers + b] is the first element of part p in buffer b
+	size_t nBuffers = m_buffers.size();
+	std::vector<merge_head> heap;
+	size_t nSize = 0;
+	for (size_t b = 0; b < nBuffers; b++)
+	{
+		size_t i0 = bounds[nPart * nBuffers + b];
+		size_t i1 = bounds[(nPart + 1) * nBuffers + b];
+		if (i0 == i1) continue;
+		merge_head h = { &m_buffers[b].ar[0] + i0, &m_buffers[b].ar[0] + i1, b };
+		heap.push_back(h);
+		nSize += i1 - i0;
+	}
+	std::make_heap(heap.begin(), heap.end());
+
+	out.reserve(nSize);
+	while (!heap.empty())
+	{
+		std::pop_heap(heap.begin(), heap.end());
+		merge_head &h = heap.back();
+		if (nMode == KEEP_ALL || out.empty() || out.back().first < h.p->first)
+			out.push_back(*h.p);
+		else if (nMode == UNIQUE_LAST)
+			out.back() = *h.p;
+		if (++h.p == h.pEnd)
+			heap.pop_back();
+		else
+			std::push_heap(heap.begin(), heap.end());
+	}
+}
+
+template<typename key_type, typename val_type>
+template<typename result_type>
+inline void flat_map_builder<key_type, val_type>::build(result_type &result, int nMode, size_t nThreads)
+{
+	if (nThreads == 0) nThreads = std::max(1u, std::thread::hardware_concurrency());
+	size_t nBuffers = m_buffers.size();
+
+	// stable sorts keep the insertion order of equal keys inside a buffer
+	run_parallel(nBuffers, nThreads, [this](size_t b)
+	{
+		std::stable_sort(m_buffers[b].ar.begin(), m_buffers[b].ar.end(), less_key());
+	});
+
+	// splitting the key range into parts of about the same size by sampled keys
+	std::vector<key_type> samples;
+	const size_t nSamples = 64;
+	for (size_t b = 0; b < nBuffers; b++)
+	{
+		const std::vector<pair_type> &ar = m_buffers[b].ar;
+		for (size_t i = 0; i < nSamples && i < ar.size(); i++)
+			samples.push_back(ar[i * ar.size() / std::min(nSamples, ar.size())].first);
+	}
+	std::sort(samples.begin(), samples.end());
+	size_t nParts = std::max(static_cast<size_t>(1), std::min(nThreads * 4, samples.size()));
+
+	std::vector<size_t> bounds((nParts + 1) * nBuffers);
+	for (size_t b = 0; b < nBuffers; b++)
+	{
+		const std::vector<pair_type> &ar = m_buffers[b].ar;
+		bounds[b] = 0;
+		bounds[nParts * nBuffers + b] = ar.size();
+		for (size_t p = 1; p < nParts; p++)
+		{
+			const key_type &k = samples[p * samples.size() / nParts];
+			bounds[p * nBuffers + b] = std::lower_bound(ar.begin(), ar.end(), k,
+				flat_search_less_elem<key_type, flat_key_first>(flat_key_first())) - ar.begin();
+		}
+	}
+
+	std::vector<std::vector<pair_type> > parts(nParts);
+	run_parallel(nParts, nThreads, [&](size_t p)
+	{
+		merge(p, bounds, parts[p], nMode);
+	});
+
+	// at most two copies of the data are alive at once: the buffers go before the result
+	// is allocated, every part goes as soon as it is moved into the result
+	clear();
+	size_t nSize = 0;
+	for (size_t p = 0; p < nParts; p++)
+		nSize += parts[p].size();
+	result.clear();
+	result.reserve(nSize);
+	for (size_t p = 0; p < nParts; p++)
+	{
+		result.insert(result.end(), std::make_move_iterator(parts[p].begin()), std::make_move_iterator(parts[p].end()));
+		std::vector<pair_type>().swap(parts[p]);
+	}
+}
+
+#endif // _FLAT_MAP_BUILDER_H_INCLUDED_2026_10_19
@@ -0,0 +1,168 @@
+#ifndef _FLAT_MEMORY_H_INCLUDED_2026_10_19
+#define _FLAT_MEMORY_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <mutex>
+#include <stdio.h>
+
+/*
+ * Registry of flat containers for memory statistics (C++11)
+ *
+ * Flat memory features
+ * - Any container with a memory_usage() method can be registered under a name
+ * - flat_memory_registration registers a container for its own lifetime
+ * - stats() and dump() report the bytes of every registered container, largest first
+ * - Adding and removing entries is thread safe. total(), stats() and dump() call
+ *   memory_usage() of every container, which reads the container without a lock:
+ *   callers must not run them while another thread changes a registered container
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+struct flat_memory_stats
+{
+	std::string name;
+	size_t nBytes;
+};
+
+class flat_memory_registry
+{
+public:
+	static flat_memory_registry &instance();
+
+	template<class C>
+	void add(const C *p, const std::string &name);
+	void remove(const void *p);
+
+	size_t containers() const;
+	// not synchronized with writers of the containers, see above
+	size_t total() const;
+	std::vector<flat_memory_stats> stats() const;
+	void dump(FILE *f = stderr) const;
+
+private:
+	struct entry
+	{
+		const void *p;
+		size_t (*usage)(const void *p);
+		std::string name;
+	};
+
+	template<class C>
+	static size_t usage_of(const void *p) { return static_cast<const C*>(p)->memory_usage(); }
+
+	mutable std::mutex m_mutex;
+	std::vector<entry> m_entries;
+};
+
+template<class C>
+class flat_memory_registration
+{
+public:
+	flat_memory_registration(const C &c, const std::string &name, flat_memory_registry &registry = flat_memory_registry::instance())
+		: m_p(&c), m_registry(registry) { m_registry.add(m_p, name); };
+	~flat_memory_registration() { m_registry.remove(m_p); }
+
+	flat_memory_registration(const flat_memory_registration&) = delete;
+	flat_memory_registration &operator=(const flat_memory_registration&) = delete;
+
+private:
+	const C *m_p;
+	flat_memory_registry &m_registry;
+};
+
+//------------------------------------- flat_memory_registry -----------------------------------------
+
+inline flat_memory_registry &flat_memory_registry::instance()
+{
+	static flat_memory_registry registry;
+	return registry;
+}
+
+template<class C>
+inline void flat_memory_registry::add(const C *p, const std::string &name)
+{
+	entry e = { p, &usage_of<C>, name };
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entries.push_back(e);
+}
+
+inline void flat_memory_registry::remove(const void *p)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (size_t i = m_entries.size(); i-- > 0; )
+		if (m_entries[i].p == p)
+		{
+			m_entries.erase(m_entries.begin() + i);
+			return;
+		}
+}
+
+inline size_t flat_memory_registry::containers() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.size();
+}
+
+inline size_t flat_memory_registry::total() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t n = 0;
+	for (size_t i = 0; i < m_entries.size(); i++)
+		n += m_entries[i].usage(m_entries[i].p);
+	return n;
+}
+
+inline std::vector<flat_memory_stats> flat_memory_registry::stats() const
+{
+	std::vector<flat_memory_stats> ar;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		ar.resize(m_entries.size());
+		for (size_t i = 0; i < m_entries.size(); i++)
+		{
+			ar[i].name = m_entries[i].name;
+			ar[i].nBytes = m_entries[i].usage(m_entries[i].p);
+		}
+	}
+	std::stable_sort(ar.begin(), ar.end(), [](const flat_memory_stats &lhs, const flat_memory_stats &rhs) { return lhs.nBytes > rhs.nBytes; });
+	return ar;
+}
+
+inline void flat_memory_registry::dump(FILE *f /*= stderr*/) const
+{
+	std::vector<flat_memory_stats> ar = stats();
+	size_t nTotal = 0;
+	for (size_t i = 0; i < ar.size(); i++)
+	{
+		fprintf(f, "%14lu  %s\n", static_cast<unsigned long>(ar[i].nBytes), ar[i].name.c_str());
+		nTotal += ar[i].nBytes;
+	}
+	fprintf(f, "%14lu  total of %lu containers\n", static_cast<unsigned long>(nTotal), static_cast<unsigned long>(ar.size()));
+}
+
+#endif // _FLAT_MEMORY_H_INCLUDED_2026_10_19
@@ -0,0 +1,335 @@
+#ifndef _FLAT_NUMA_H_INCLUDED_2026_10_19
+#define _FLAT_NUMA_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <stdio.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+#ifdef FLAT_NUMA_LIBNUMA
+#include <numa.h>
+#endif
+#include "flat_map.h"
+
+/*
+ * NUMA-aware replicated read-only flat map (C++11)
+ *
+ * Flat NUMA map features
+ * - freeze() sorts a flat_map and copies it once per NUMA node
+ * - Each replica is filled by a thread bound to the CPUs of its node,
+ *   first touch places the pages on that node
+ * - With FLAT_NUMA_LIBNUMA defined (link with -lnuma) the topology comes
+ *   from libnuma and replica pages are bound to their node explicitly
+ * - Without libnuma the topology is read from /sys/devices/system/node
+ * - Lookups go to the replica of the node the calling thread runs on
+ * - Nodes can be emulated by splitting the CPUs, for testing on one node
+ * - Replicas are read only, lookups from many threads need no locking
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+class flat_numa_topology
+{
+public:
+	// detects the nodes of this machine, one node when nothing is known
+	flat_numa_topology();
+	// splits the CPUs of this machine into nEmulatedNodes nodes
+	explicit flat_numa_topology(size_t nEmulatedNodes);
+
+	size_t nodes() const { return m_cpus.size(); }
+	const std::vector<int> &cpus(size_t nNode) const { return m_cpus[nNode]; }
+	int node_id(size_t nNode) const { return m_ids[nNode]; }
+	bool emulated() const { return m_bEmulated; }
+
+	size_t node_of_cpu(int nCpu) const;
+	// node of the CPU the calling thread runs on
+	size_t current_node() const;
+	// restricts the calling thread to the CPUs of a node
+	bool bind_thread(size_t nNode) const;
+
+	static int current_cpu();
+
+private:
+	static bool parse_list(const char *szFile, std::vector<int> &list);
+	static void online_cpus(std::vector<int> &cpus);
+	void index_cpus();
+
+	std::vector<std::vector<int> > m_cpus;
+	std::vector<int> m_ids;
+	std::vector<size_t> m_nodeOfCpu;
+	bool m_bEmulated;
+};
+
+template<typename key_type, typename val_type, typename search_type = flat_search_binary>
+class flat_numa_map
+{
+public:
+	typedef flat_map<key_type, val_type, search_type> map_type;
+	typedef typename map_type::pair_type pair_type;
+
+	flat_numa_map() : m_nSize(0) {};
+	explicit flat_numa_map(const flat_numa_topology &topology) : m_topology(topology), m_nSize(0) {};
+
+	// sorts map and makes one replica of it per node, map itself is not changed otherwise
+	template<typename src_search_type, typename src_allocator_type>
+	void freeze(flat_map<key_type, val_type, src_search_type, src_allocator_type> &map);
+	void clear();
+
+	// the pointers refer to the replica local to the calling thread, nullptr if the key is absent
+	const pair_type *find(const key_type &k);
+	const pair_type *lower_bound(const key_type &k);
+	size_t count(const key_type &k) { return find(k) == nullptr ? 0 : 1; }
+	size_t size() const { return m_nSize; }
+	bool empty() const { return size() == 0; }
+
+	const flat_numa_topology &topology() const { return m_topology; }
+	size_t replicas() const { return m_replicas.size(); }
+	map_type &replica(size_t nNode) { return m_replicas[nNode]; }
+	map_type &local() { return m_replicas[m_topology.current_node()]; }
+	size_t memory_usage() const;
+
+private:
+	flat_numa_topology m_topology;
+	std::vector<map_type> m_replicas;
+	size_t m_nSize;
+};
+
+//------------------------------------- flat_numa_topology -----------------------------------------
+
+inline bool flat_numa_topology::parse_list(const char *szFile, std::vector<int> &list)
+{
+	// sysfs lists look like "0-3,8-11"
+	FILE *f = fopen(szFile, "r");
+	if (f == nullptr)
+		return false;
+	list.clear();
+	int n0, n1;
+	while (fscanf(f, "%d", &n0) == 1)
+	{
+		n1 = n0;
+		int c = fgetc(f);
+		if (c == '-')
+		{
+			if (fscanf(f, "%d", &n1) != 1)
+				break;
+			c = fgetc(f);
+		}
+		for (int i = n0; i <= n1; i++)
+			list.push_back(i);
+		if (c != ',')
+			break;
+	}
+	fclose(f);
+	return !list.empty();
+}
+
+inline void flat_numa_topology::online_cpus(std::vector<int> &cpus)
+{
+	if (parse_list("/sys/devices/system/cpu/online", cpus))
+		return;
+	cpus.clear();
+	for (unsigned i = 0; i < std::max(1u, std::thread::hardware_concurrency()); i++)
+		cpus.push_back(static_cast<int>(i));
+}
+
+inline void flat_numa_topology::index_cpus()
+{
+	m_nodeOfCpu.clear();
+	for (size_t n = m_cpus.size(); n-- > 0; )
+		for (size_t i = 0; i < m_cpus[n].size(); i++)
+		{
+			size_t nCpu = static_cast<size_t>(m_cpus[n][i]);
+			if (nCpu >= m_nodeOfCpu.size())
+				m_nodeOfCpu.resize(nCpu + 1, 0);
+			m_nodeOfCpu[nCpu] = n;
+		}
+}
+
+inline flat_numa_topology::flat_numa_topology() : m_bEmulated(false)
+{
+#ifdef FLAT_NUMA_LIBNUMA
+	if (numa_available() >= 0)
+	{
+		int nCpus = numa_num_configured_cpus();
+		for (int nId = 0; nId <= numa_max_node(); nId++)
+		{
+			std::vector<int> cpus;
+			for (int c = 0; c < nCpus; c++)
+				if (numa_node_of_cpu(c) == nId)
+					cpus.push_back(c);
+			if (cpus.empty())
+				continue;
+			m_cpus.push_back(cpus);
+			m_ids.push_back(nId);
+		}
+	}
+#else
+	std::vector<int> ids;
+	if (parse_list("/sys/devices/system/node/online", ids))
+		for (size_t n = 0; n < ids.size(); n++)
+		{
+			std::vector<int> cpus;
+			std::string file = "/sys/devices/system/node/node" + std::to_string(ids[n]) + "/cpulist";
+			if (!parse_list(file.c_str(), cpus))
+				continue;
+			m_cpus.push_back(cpus);
+			m_ids.push_back(ids[n]);
+		}
+#endif
+	if (m_cpus.empty())
+	{
+		m_cpus.resize(1);
+		online_cpus(m_cpus[0]);
+		m_ids.assign(1, 0);
+	}
+	index_cpus();
+}
+
+inline flat_numa_topology::flat_numa_topology(size_t nEmulatedNodes) : m_bEmulated(true)
+{
+	std::vector<int> cpus;
+	online_cpus(cpus);
+	m_cpus.resize(std::max(static_cast<size_t>(1), nEmulatedNodes));
+	for (size_t n = 0; n < m_cpus.size(); n++)
+	{
+		// contiguous groups of CPUs, nodes share CPUs when there are less CPUs than nodes
+		size_t i0 = n * cpus.size() / m_cpus.size();
+		size_t i1 = (n + 1) * cpus.size() / m_cpus.size();
+		if (i0 == i1)
+			m_cpus[n].push_back(cpus[i0 % cpus.size()]);
+		else
+			m_cpus[n].assign(cpus.begin() + i0, cpus.begin() + i1);
+		m_ids.push_back(static_cast<int>(n));
+	}
+	index_cpus();
+}
+
+inline int flat_numa_topology::current_cpu()
+{
+#if defined(__linux__)
+	return sched_getcpu();
+#else
+	return 0;
+#endif
+}
+
+inline size_t flat_numa_topology::node_of_cpu(int nCpu) const
+{
+	if (nCpu < 0 || static_cast<size_t>(nCpu) >= m_nodeOfCpu.size())
+		return 0;
+	return m_nodeOfCpu[nCpu];
+}
+
+inline size_t flat_numa_topology::current_node() const
+{
+	if (m_cpus.size() == 1)
+		return 0;
+	return node_of_cpu(current_cpu());
+}
+
+inline bool flat_numa_topology::bind_thread(size_t nNode) const
+{
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (size_t i = 0; i < m_cpus[nNode].size(); i++)
+		CPU_SET(m_cpus[nNode][i], &set);
+	return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+	(void)nNode;
+	return false;
+#endif
+}
+
+//------------------------------------- flat_numa_map -----------------------------------------
+
+template<typename key_type, typename val_type, typename search_type>
+template<typename src_search_type, typename src_allocator_type>
+inline void flat_numa_map<key_type, val_type, search_type>::freeze(flat_map<key_type, val_type, src_search_type, src_allocator_type> &map)
+{
+	m_replicas.clear();
+	m_replicas.resize(m_topology.nodes());
+	const pair_type *pBegin = map.size() == 0 ? nullptr : &*map.begin();
+	const pair_type *pEnd = pBegin + map.size();
+	m_nSize = map.size();
+
+	// one thread per node, first touch of the new buffer happens on the node's CPUs
+	std::vector<std::thread> threads;
+	for (size_t n = 0; n < m_topology.nodes(); n++)
+		threads.push_back(std::thread([this, n, pBegin, pEnd]()
+		{
+			m_topology.bind_thread(n);
+			std::vector<pair_type> ar;
+			ar.reserve(pEnd - pBegin);
+#ifdef FLAT_NUMA_LIBNUMA
+			if (!m_topology.emulated() && ar.capacity() != 0 && numa_available() >= 0)
+				numa_tonode_memory(ar.data(), ar.capacity() * sizeof(pair_type), m_topology.node_id(n));
+#endif
+			ar.assign(pBegin, pEnd);
+			m_replicas[n].adopt_sorted(ar);
+		}));
+	for (size_t n = 0; n < threads.size(); n++)
+		threads[n].join();
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline size_t flat_numa_map<key_type, val_type, search_type>::memory_usage() const
+{
+	size_t n = 0;
+	for (size_t i = 0; i < m_replicas.size(); i++)
+		n += m_replicas[i].memory_usage();
+	return n;
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline void flat_numa_map<key_type, val_type, search_type>::clear()
+{
+	m_replicas.clear();
+	m_nSize = 0;
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline const typename flat_numa_map<key_type, val_type, search_type>::pair_type *flat_numa_map<key_type, val_type, search_type>::find(const key_type &k)
+{
+	if (m_replicas.empty())
+		return nullptr;
+	map_type &map = local();
+	typename map_type::iterator it = map.find(k);
+	return it == map.end() ? nullptr : &*it;
+}
+
+template<typename key_type, typename val_type, typename search_type>
+inline const typename flat_numa_map<key_type, val_type, search_type>::pair_type *flat_numa_map<key_type, val_type, search_type>::lower_bound(const key_type &k)
+{
+	if (m_replicas.empty())
+		return nullptr;
+	map_type &map = local();
+	typename map_type::iterator it = map.lower_bound(k);
+	return it == map.end() ? nullptr : &*it;
+}
+
+#endif // _FLAT_NUMA_H_INCLUDED_2026_10_19
@@ -0,0 +1,455 @@
+#ifndef _FLAT_PACKED_SET_H_INCLUDED_2026_10_19
+#define _FLAT_PACKED_SET_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+
+/*
+ * Compressed set of integers C++ template based on vector
+ *
+ * Flat packed set features
+ * - Sorted values are stored in blocks of 128, every block keeps its first
+ *   value in a skip array and the gaps between the values bit-packed with
+ *   the width of the largest gap
+ * - Lookups binary search the skip array and decode a part of a single block
+ * - Iteration decodes the values one by one, block by block
+ * - Inserts are appended to a buffer and merged into the blocks by sort(),
+ *   lazily as in flat_set
+ * - flat_packed_multiset keeps duplicates (zero gaps take no extra bits)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+template<typename T, bool bMultiset = false>
+class flat_packed_set
+{
+public:
+	class iterator;
+	typedef std::pair<iterator, iterator> iterator_pair;
+
+	flat_packed_set() : m_nSize(0) {};
+
+	void clear();
+	void reserve(size_t size);
+	void insert(const T &v);
+	iterator find(const T &v);
+	iterator lower_bound(const T &v);
+	iterator upper_bound(const T &v);
+	iterator_pair equal_range(const T &v);
+	size_t count(const T &v);
+	size_t size();
+	bool empty();
+	iterator erase(const T &v);
+	void swap(flat_packed_set& other);
+
+	iterator begin();
+	iterator end();
+
+	void sort();
+	size_t memory_usage() const;
+
+private:
+	typedef unsigned long long word_type;
+
+	enum { BLOCK_SIZE = 128 };
+
+	struct block
+	{
+		size_t nWord;			// first word of the packed gaps in m_words
+		unsigned short nCount;	// number of values in the block
+		unsigned char nBits;	// width of a packed gap
+	};
+
+public:
+	// Read only forward iterator, values are decoded as it advances
+	class iterator
+	{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const T* pointer;
+		typedef const T& reference;
+
+		iterator() : m_pSet(0), m_nBlock(0), m_nPos(0), m_value() {};
+
+		const T& operator* () const { return m_value; }
+		const T* operator-> () const { return &m_value; }
+		iterator& operator++ ();
+		iterator operator++ (int) { iterator it(*this); ++(*this); return it; }
+		bool operator== (const iterator& rhs) const { return m_nBlock == rhs.m_nBlock && m_nPos == rhs.m_nPos; }
+		bool operator!= (const iterator& rhs) const { return !(*this == rhs); }
+
+	private:
+		friend class flat_packed_set;
+		iterator(const flat_packed_set* pSet, size_t nBlock, size_t nPos, const T& v) :
+			m_pSet(pSet), m_nBlock(nBlock), m_nPos(nPos), m_value(v) {};
+
+		const flat_packed_set* m_pSet;
+		size_t m_nBlock;
+		size_t m_nPos;
+		T m_value;
+	};
+
+private:
+	friend class iterator;
+
+	// Encodes a sorted stream of values into blocks of the target set
+	struct encoder
+	{
+		encoder() : n(0), last(), bLast(false) {};
+		void push(flat_packed_set &s, const T &v);
+		void flush(flat_packed_set &s);
+
+		T buf[BLOCK_SIZE];
+		size_t n;
+		T last;
+		bool bLast;
+	};
+
+	static word_type get_bits(const word_type* pWords, size_t nBit, unsigned nBits);
+	iterator seek(size_t nBlock, const T &v, bool bUpper) const;
+	void encode(const T* pIn, size_t n);
+	iterator first() const;
+	iterator stop() const;
+	size_t distance(const iterator &i0, const iterator &i1) const;
+	void assign(flat_packed_set &other);
+
+	std::vector<T> m_mins;			// skip array, first value of every block
+	std::vector<block> m_blocks;
+	std::vector<word_type> m_words;
+	std::vector<T> m_pending;		// inserted and not merged yet
+	size_t m_nSize;
+};
+
+template<typename T>
+class flat_packed_multiset : public flat_packed_set<T, true>
+{
+};
+
+//------------------------------------- flat_packed_set -----------------------------------------
+
+template<typename T, bool bMultiset>
+inline typename flat_packed_set<T, bMultiset>::word_type flat_packed_set<T, bMultiset>::get_bits(const word_type* pWords, size_t nBit, unsigned nBits)
+{
+	size_t w = nBit >> 6;
+	unsigned s = static_cast<unsigned>(nBit & 63);
+	word_type v = pWords[w] >> s;
+	if (s + nBits > 64) v |= pWords[w + 1] << (64 - s);
+	if (nBits < 64) v &= (static_cast<word_type>(1) << nBits) - 1;
+	return v;
+}
+
+// Decodes the block up to the first value not less than v (greater than v
+// when bUpper is set), the result may point to the start of the next block
+template<typename T, bool bMultiset>
+inline typename flat_packed_set<T, bMultiset>::iterator flat_packed_set<T, bMultiset>::seek(size_t nBlock, const T &v, bool bUpper) const
+{
+	const block &b = m_blocks[nBlock];
+	const unsigned nBits = b.nBits;
+	const size_t n = b.nCount;
+	const word_type* pWords = nBits ? &m_words[b.nWord] : 0;
+
+	word_type x = static_cast<word_type>(m_mins[nBlock]);
+	for (size_t i = 0; i < n; i++)
+	{
+		if (i > 0 && nBits) x += get_bits(pWords, (i - 1) * nBits, nBits);
+		T t = static_cast<T>(x);
+		if (bUpper ? v < t : !(t < v))
+			return iterator(this, nBlock, i, t);
+	}
+	if (nBlock + 1 < m_blocks.size())
+		return iterator(this, nBlock + 1, 0, m_mins[nBlock + 1]);
+	return stop();
+}
+
+template<typename T, bool bMultiset>
+inline void flat_packed_set<T, bMultiset>::encode(const T* pIn, size_t n)
+{
+	word_type nMax = 0;
+	for (size_t i = 1; i < n; i++)
+		nMax = std::max(nMax, static_cast<word_type>(pIn[i]) - static_cast<word_type>(pIn[i - 1]));
+	unsigned nBits = 0;
+	while (nBits < 64 && (nMax >> nBits) != 0) nBits++;
+
+	block b;
+	b.nWord = m_words.size();
+	b.nCount = static_cast<unsigned short>(n);
+	b.nBits = static_cast<unsigned char>(nBits);
+	m_blocks.push_back(b);
+	m_mins.push_back(pIn[0]);
+	if (nBits == 0) return;
+
+	m_words.resize(b.nWord + ((n - 1) * nBits + 63) / 64, 0);
+	word_type* pWords = &m_words[b.nWord];
+	size_t nBit = 0;
+	for (size_t i = 1; i < n; i++, nBit += nBits)
+	{
+		word_type d = static_cast<word_type>(pIn[i]) - static_cast<word_type>(pIn[i - 1]);
+		size_t w = nBit >> 6;
+		unsigned s = static_cast<unsigned>(nBit & 63);
+		pWords[w] |= d << s;
+		if (s + nBits > 64) pWords[w + 1] |= d >> (64 - s);
+	}
+}
+
+template<typename T, bool bMultiset>
+inline void flat_packed_set<T, bMultiset>::encoder::push(flat_packed_set &s, const T &v)
+{
+	if (!bMultiset && bLast && last == v) return;
+	last = v;
+	bLast = true;
+	buf[n++] = v;
+	s.m_nSize++;
+	if (n == BLOCK_SIZE)
+	{
+		s.encode(buf, n);
+		n = 0;
+	}
+}
+
+template<typename T, bool bMultiset>
+inline void flat_packed_set<T, bMultiset>::encoder::flush(flat_packed_set &s)
+{
+	if (n > 0) s.encode(buf, n);
+	n = 0;
+}
+
+template<typename T, bool bMultiset>
+inline typename flat_packed_set<T, bMultiset>::iterator& flat_packed_set<T, bMultiset>::iterator::operator++ ()
+{
+	const block &b = m_pSet->m_blocks[m_nBlock];
+	if (++m_nPos < b.nCount)
+	{
+		if (b.nBits != 0)
+			m_value = static_cast<T>(static_cast<word_type>(m_value) +
+				get_bits(&m_pSet->m_words[b.nWord], (m_nPos - 1) * b.nBits, b.nBits));
+		return *this;
+	}
+	m_nPos = 0;
+	if (++m_nBlock < m_pSet->m_blocks.size())
+		m_value = m_pSet->m_mins[m_nBlock];
+	return *this;
+}
+
+template<typename T, bool bMultiset>
+inline typename flat_packed_set<T, bMultiset>::iterator flat_packed_set<T, bMultiset>::first() const
+{
+	if (m_blocks.empty()) return stop();
+	return iterator(this, 0, 0, m_mins[0]);
+}
+
+template<typename T, bool bMultiset>
+inline typename flat_packed_set<T, bMultiset>::iterator flat_packed_set<T, bMultiset>::stop() const
+{
+	return iterator(this, m_blocks.size(), 0, T());
+}
+
+template<typename T, bool bMultiset>
+inline size_t flat_packed_set<T, bMultiset>::distance(const iterator &i0, const iterator &i1) const
+{
+	if (i0.m_nBlock == i1.m_nBlock) return i1.m_nPos - i0.m_nPos;
+	size_t n = m_blocks[i0.m_nBlock].nCount - i0.m_nPos;
+	for (size_t b = i0.m_nBlock + 1; b < i1.m_nBlock; b++)
+		n += m_blocks[b].nCount;
+	return n + i1.m_nPos;
+}
+
+template<typename T, bool bMultiset>
+inline void flat_packed_set<T, bMultiset>::assign(flat_packed_set &other)
+{
+	m_mins.swap(other.m_mins);
+	m_blocks.swap(other.m_blocks);
+	m_words.swap(other.m_words);
+	m_nSize = other.m_nSize;
+}
+
+template<typename T, bool bMultiset>
+inline void flat_packed_set<T, bMultiset>::clear()
+{
+	m_mins.clear();
+	m_blocks.clear();
+	m_words.clear();
+	m_pending.clear();
+	m_nSize = 0;
+}
+
+template<typename T, bool bMultiset>
+inline void flat_packed_set<T, bMultiset>::reserve(size_t size)
+{
+	m_pending.reserve(size);
+}
+
+template<typename T, bool bMultiset>
+inline void flat_packed_set<T, bMultiset>::insert(const T &v)
+{
+	m_pending.push_back(v);
+}
+
+template<typename T, bool bMultiset>
+inline typename flat_packed_set<T, bMultiset>::iterator flat_packed_set<T, bMultiset>::find(const T &v)
+{
+	iterator it = lower_bound(v);
+	if (it == stop() || v < *it)
+		return stop();
+	return it;
+}
+
+template<typename T, bool bMultiset>
+inline typename flat_packed_set<T, bMultiset>::iterator flat_packed_set<T, bMultiset>::lower_bound(const T &v)
+{
+	if (!m_pending.empty()) sort();
+	if (m_blocks.empty()) return stop();
+
+	// the last block starting below v holds the first value not less than v,
+	// or that value starts the next block
+	size_t b = std::lower_bound(m_mins.begin(), m_mins.end(), v) - m_mins.begin();
+	if (b == 0) return first();
+	return seek(b - 1, v, false);
+}
+
+template<typename T, bool bMultiset>
+inline typename flat_packed_set<T, bMultiset>::iterator flat_packed_set<T, bMultiset>::upper_bound(const T &v)
+{
+	if (!m_pending.empty()) sort();
+	if (m_blocks.empty()) return stop();
+
+	size_t b = std::upper_bound(m_mins.begin(), m_mins.end(), v) - m_mins.begin();
+	if (b == 0) return first();
+	return seek(b - 1, v, true);
+}
+
+template<typename T, bool bMultiset>
+inline typename flat_packed_set<T, bMultiset>::iterator_pair flat_packed_set<T, bMultiset>::equal_range(const T &v)
+{
+	iterator it = lower_bound(v);
+	if (!bMultiset)
+	{
+		iterator it1 = it;
+		if (it1 != stop() && !(v < *it1)) ++it1;
+		return iterator_pair(it, it1);
+	}
+	return iterator_pair(it, upper_bound(v));
+}
+
+template<typename T, bool bMultiset>
+inline size_t flat_packed_set<T, bMultiset>::count(const T &v)
+{
+	iterator_pair pit = equal_range(v);
+	return distance(pit.first, pit.second);
+}
+
+template<typename T, bool bMultiset>
+inline size_t flat_packed_set<T, bMultiset>::size()
+{
+	if (!m_pending.empty()) sort();
+	return m_nSize;
+}
+
+template<typename T, bool bMultiset>
+inline bool flat_packed_set<T, bMultiset>::empty()
+{
+	return m_nSize == 0 && m_pending.empty();
+}
+
+template<typename T, bool bMultiset>
+inline typename flat_packed_set<T, bMultiset>::iterator flat_packed_set<T, bMultiset>::erase(const T &v)
+{
+	iterator_pair pit = equal_range(v);
+	if (pit.first == pit.second) return pit.second;
+
+	// blocks are re-encoded, as in flat_set erasing is linear
+	flat_packed_set res;
+	encoder enc;
+	for (iterator it = first(); it != stop(); ++it)
+		if (*it < v || v < *it)
+			enc.push(res, *it);
+	enc.flush(res);
+	assign(res);
+	return upper_bound(v);
+}
+
+template<typename T, bool bMultiset>
+inline void flat_packed_set<T, bMultiset>::swap(flat_packed_set<T, bMultiset>& other)
+{
+	m_mins.swap(other.m_mins);
+	m_blocks.swap(other.m_blocks);
+	m_words.swap(other.m_words);
+	m_pending.swap(other.m_pending);
+	std::swap(m_nSize, other.m_nSize);
+}
+
+template<typename T, bool bMultiset>
+inline typename flat_packed_set<T, bMultiset>::iterator flat_packed_set<T, bMultiset>::begin()
+{
+	if (!m_pending.empty()) sort();
+	return first();
+}
+
+template<typename T, bool bMultiset>
+inline typename flat_packed_set<T, bMultiset>::iterator flat_packed_set<T, bMultiset>::end()
+{
+	if (!m_pending.empty()) sort();
+	return stop();
+}
+
+template<typename T, bool bMultiset>
+void inline flat_packed_set<T, bMultiset>::sort()
+{
+	if (m_pending.empty()) return;
+	std::sort(m_pending.begin(), m_pending.end());
+
+	// merge the pending values into a new encoding
+	flat_packed_set res;
+	encoder enc;
+	iterator it = first();
+	typename std::vector<T>::const_iterator ip = m_pending.begin();
+	while (it != stop() || ip != m_pending.end())
+	{
+		if (ip == m_pending.end() || (it != stop() && !(*ip < *it)))
+		{
+			enc.push(res, *it);
+			++it;
+		}
+		else
+		{
+			enc.push(res, *ip);
+			++ip;
+		}
+	}
+	enc.flush(res);
+	assign(res);
+	std::vector<T>().swap(m_pending);
+}
+
+template<typename T, bool bMultiset>
+inline size_t flat_packed_set<T, bMultiset>::memory_usage() const
+{
+	return sizeof(*this) + m_mins.capacity()*sizeof(T) + m_blocks.capacity()*sizeof(block) +
+		m_words.capacity()*sizeof(word_type) + m_pending.capacity()*sizeof(T);
+}
+
+#endif // _FLAT_PACKED_SET_H_INCLUDED_2026_10_19
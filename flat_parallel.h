@@ -0,0 +1,289 @@
+#ifndef _FLAT_PARALLEL_H_INCLUDED_2026_10_19
+#define _FLAT_PARALLEL_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+/*
+ * Parallel iteration over flat containers (C++11)
+ *
+ * Flat parallel features
+ * - flat_parallel_for_each() and flat_parallel_reduce() run over the ranges of
+ *   split() of flat_set, flat_multiset, flat_map and flat_multimap, so equal keys
+ *   of a multi container are always handled by one task
+ * - The container is sorted on the calling thread before the work starts and
+ *   must not change until it returns; values may be modified by for_each, keys not
+ * - There are several ranges per thread, flat_thread_pool workers take tasks from
+ *   their own queue and steal from the others when it is empty, the calling thread
+ *   runs tasks as well while it waits
+ * - flat_parallel_reduce() combines the results of the ranges in key order
+ * - The first exception thrown by a task is rethrown after all tasks are done
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+class flat_thread_pool
+{
+public:
+	typedef std::function<void()> task_type;
+
+	// 0 threads: one less than the hardware threads, the thread waiting for the work is the last one
+	explicit flat_thread_pool(size_t nThreads = 0);
+	~flat_thread_pool();
+
+	// the pool used when none is passed
+	static flat_thread_pool &instance();
+
+	size_t threads() const { return m_workers.size(); }
+	// a task submitted by a worker goes to its own queue, others are spread over the queues
+	void submit(const task_type &task);
+	// runs one queued task on the calling thread, false if there was none
+	bool run_one();
+
+	flat_thread_pool(const flat_thread_pool&) = delete;
+	flat_thread_pool &operator=(const flat_thread_pool&) = delete;
+
+private:
+	struct task_queue
+	{
+		std::mutex mutex;
+		std::deque<task_type> tasks;
+	};
+	struct worker_id
+	{
+		const flat_thread_pool *pPool;
+		size_t nQueue;
+	};
+
+	static worker_id &current();
+	bool pop(size_t nQueue, task_type &task);
+	void work(size_t nQueue);
+
+	std::vector<std::unique_ptr<task_queue> > m_queues;
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::atomic<size_t> m_nPending;
+	std::atomic<size_t> m_nNext;
+	bool m_bStop;
+};
+
+// Runs f(0) ... f(nTasks - 1) on the pool and waits for them
+template<class F>
+void flat_parallel_run(flat_thread_pool &pool, size_t nTasks, F f);
+
+// Calls f(element) for every element, 0 ranges: 4 per thread of the pool
+template<class C, class F>
+void flat_parallel_for_each(C &c, F f, flat_thread_pool &pool = flat_thread_pool::instance(), size_t nRanges = 0);
+
+// Every range is folded by acc = fold(acc, element) starting from identity,
+// the results are merged by combine(lhs, rhs) in key order
+template<class C, class T, class Fold, class Combine>
+T flat_parallel_reduce(C &c, const T &identity, Fold fold, Combine combine, flat_thread_pool &pool = flat_thread_pool::instance(), size_t nRanges = 0);
+
+//------------------------------------- flat_thread_pool -----------------------------------------
+
+inline flat_thread_pool::flat_thread_pool(size_t nThreads /*= 0*/) : m_nPending(0), m_nNext(0), m_bStop(false)
+{
+	if (nThreads == 0)
+	{
+		size_t nHardware = std::thread::hardware_concurrency();
+		nThreads = nHardware > 1 ? nHardware - 1 : 1;
+	}
+	for (size_t i = 0; i < nThreads; i++)
+		m_queues.push_back(std::unique_ptr<task_queue>(new task_queue));
+	for (size_t i = 0; i < nThreads; i++)
+		m_workers.push_back(std::thread(&flat_thread_pool::work, this, i));
+}
+
+inline flat_thread_pool::~flat_thread_pool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStop = true;
+	}
+	m_wake.notify_all();
+	for (size_t i = 0; i < m_workers.size(); i++)
+		m_workers[i].join();
+}
+
+inline flat_thread_pool &flat_thread_pool::instance()
+{
+	static flat_thread_pool pool;
+	return pool;
+}
+
+inline flat_thread_pool::worker_id &flat_thread_pool::current()
+{
+	static thread_local worker_id id = { nullptr, 0 };
+	return id;
+}
+
+inline void flat_thread_pool::submit(const task_type &task)
+{
+	size_t nQueue = current().pPool == this ? current().nQueue : m_nNext++ % m_queues.size();
+	{
+		std::lock_guard<std::mutex> lock(m_queues[nQueue]->mutex);
+		m_queues[nQueue]->tasks.push_back(task);
+	}
+	m_nPending++;
+	// a worker checks m_nPending under m_mutex before it sleeps, so the wakeup is not lost
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+	}
+	m_wake.notify_one();
+}
+
+inline bool flat_thread_pool::pop(size_t nQueue, task_type &task)
+{
+	// the newest task of the own queue, its data is likely in cache
+	{
+		task_queue &q = *m_queues[nQueue];
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if (!q.tasks.empty())
+		{
+			task.swap(q.tasks.back());
+			q.tasks.pop_back();
+			m_nPending--;
+			return true;
+		}
+	}
+	// the oldest task of another queue
+	for (size_t i = 1; i < m_queues.size(); i++)
+	{
+		task_queue &q = *m_queues[(nQueue + i) % m_queues.size()];
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if (!q.tasks.empty())
+		{
+			task.swap(q.tasks.front());
+			q.tasks.pop_front();
+			m_nPending--;
+			return true;
+		}
+	}
+	return false;
+}
+
+inline bool flat_thread_pool::run_one()
+{
+	size_t nQueue = current().pPool == this ? current().nQueue : m_nNext % m_queues.size();
+	task_type task;
+	if (!pop(nQueue, task))
+		return false;
+	task();
+	return true;
+}
+
+inline void flat_thread_pool::work(size_t nQueue)
+{
+	current().pPool = this;
+	current().nQueue = nQueue;
+	for (;;)
+	{
+		task_type task;
+		if (pop(nQueue, task))
+		{
+			task();
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_wake.wait(lock, [this]() { return m_bStop || m_nPending > 0; });
+		if (m_bStop && m_nPending == 0)
+			return;
+	}
+}
+
+//------------------------------------- parallel algorithms -----------------------------------------
+
+template<class F>
+inline void flat_parallel_run(flat_thread_pool &pool, size_t nTasks, F f)
+{
+	std::atomic<size_t> nLeft(nTasks);
+	std::exception_ptr error;
+	std::mutex errorMutex;
+	for (size_t i = 0; i < nTasks; i++)
+		pool.submit([&, i]()
+		{
+			try
+			{
+				f(i);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(errorMutex);
+				if (!error)
+					error = std::current_exception();
+			}
+			nLeft--;
+		});
+	// the waiting thread helps, then yields while the last tasks finish
+	while (nLeft > 0)
+		if (!pool.run_one())
+			std::this_thread::yield();
+	if (error)
+		std::rethrow_exception(error);
+}
+
+template<class C, class F>
+inline void flat_parallel_for_each(C &c, F f, flat_thread_pool &pool /*= flat_thread_pool::instance()*/, size_t nRanges /*= 0*/)
+{
+	if (nRanges == 0)
+		nRanges = (pool.threads() + 1) * 4;
+	std::vector<typename C::iterator_pair> ranges = c.split(nRanges);
+	flat_parallel_run(pool, ranges.size(), [&](size_t i)
+	{
+		for (typename C::iterator it = ranges[i].first; it != ranges[i].second; ++it)
+			f(*it);
+	});
+}
+
+template<class C, class T, class Fold, class Combine>
+inline T flat_parallel_reduce(C &c, const T &identity, Fold fold, Combine combine, flat_thread_pool &pool /*= flat_thread_pool::instance()*/, size_t nRanges /*= 0*/)
+{
+	if (nRanges == 0)
+		nRanges = (pool.threads() + 1) * 4;
+	std::vector<typename C::iterator_pair> ranges = c.split(nRanges);
+	std::vector<T> results(ranges.size(), identity);
+	flat_parallel_run(pool, ranges.size(), [&](size_t i)
+	{
+		T acc = identity;
+		for (typename C::iterator it = ranges[i].first; it != ranges[i].second; ++it)
+			acc = fold(acc, *it);
+		results[i] = acc;
+	});
+	T result = identity;
+	for (size_t i = 0; i < results.size(); i++)
+		result = combine(result, results[i]);
+	return result;
+}
+
+#endif // _FLAT_PARALLEL_H_INCLUDED_2026_10_19
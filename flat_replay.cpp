@@ -0,0 +1,219 @@
+#include "flat_set.h"
+#include "flat_map.h"
+#include "flat_blocked_map.h"
+#include "flat_versioned_map.h"
+#include "flat_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <chrono>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+/*
+ * Replays a trace of flat_traced_map or flat_traced_set against containers and policies (C++11)
+ *
+ * g++ -O2 -std=c++11 flat_replay.cpp -o flat_replay
+ * flat_replay <trace> [number of runs]
+ *
+ * Keys are replayed as uint64_t, values as uint64_t. Time is the best of the runs,
+ * memory is taken at the end of the trace and is an estimate for std:: containers.
+ * Sorts of flat_map and flat_set are counted by their search policy, which the containers
+ * build once at the end of every sort().
+ * Unordered containers are skipped for traces with lower_bound.
+ */
+
+typedef std::chrono::steady_clock replay_clock;
+
+struct replay_op
+{
+	char nOp;
+	uint64_t nKey;
+};
+
+// search policy counting its builds, that is the sorts of the container using it
+struct replay_sort_counter
+{
+	static size_t nSorts;
+};
+size_t replay_sort_counter::nSorts = 0;
+
+template<class S>
+struct replay_counting_search : public S
+{
+	template<class It, class KeyOf>
+	void build(It i0, It i1, KeyOf key) { replay_sort_counter::nSorts++; S::build(i0, i1, key); }
+};
+
+// containers which sort, the others show no count
+template<class C>
+static bool replay_sorts(const C &) { return false; }
+template<class S>
+static bool replay_sorts(const flat_set<uint64_t, S> &) { return true; }
+template<class S>
+static bool replay_sorts(const flat_map<uint64_t, uint64_t, S> &) { return true; }
+
+// insert, the last one wins in every container
+template<class C>
+static void replay_insert(C &c, uint64_t k, uint64_t v) { c.insert(k, v); }
+template<class S>
+static void replay_insert(flat_set<uint64_t, S> &c, uint64_t k, uint64_t) { c.insert(k); }
+static void replay_insert(std::set<uint64_t> &c, uint64_t k, uint64_t) { c.insert(k); }
+static void replay_insert(std::unordered_set<uint64_t> &c, uint64_t k, uint64_t) { c.insert(k); }
+static void replay_insert(std::map<uint64_t, uint64_t> &c, uint64_t k, uint64_t v) { c[k] = v; }
+static void replay_insert(std::unordered_map<uint64_t, uint64_t> &c, uint64_t k, uint64_t v) { c[k] = v; }
+
+static uint64_t replay_key(uint64_t k) { return k; }
+template<class P>
+static uint64_t replay_key(const P &p) { return p.first; }
+
+// key of the lower bound or 0 at the end, unordered containers have none
+template<class C>
+static uint64_t replay_lower_bound(C &c, uint64_t k) { typename C::iterator it = c.lower_bound(k); return it == c.end() ? 0 : replay_key(*it); }
+static uint64_t replay_lower_bound(std::unordered_set<uint64_t> &, uint64_t) { return 0; }
+static uint64_t replay_lower_bound(std::unordered_map<uint64_t, uint64_t> &, uint64_t) { return 0; }
+
+template<class C>
+static size_t replay_memory(const C &c, bool &bEstimate) { bEstimate = false; return c.memory_usage(); }
+template<class C>
+static size_t replay_node_memory(const C &c, size_t nNode, size_t nBuckets, bool &bEstimate) { bEstimate = true; return c.size() * nNode + nBuckets * sizeof(void*); }
+static size_t replay_memory(const std::set<uint64_t> &c, bool &bEstimate) { return replay_node_memory(c, sizeof(uint64_t) + 4 * sizeof(void*), 0, bEstimate); }
+static size_t replay_memory(const std::map<uint64_t, uint64_t> &c, bool &bEstimate) { return replay_node_memory(c, 2 * sizeof(uint64_t) + 4 * sizeof(void*), 0, bEstimate); }
+static size_t replay_memory(const std::unordered_set<uint64_t> &c, bool &bEstimate) { return replay_node_memory(c, sizeof(uint64_t) + 2 * sizeof(void*), c.bucket_count(), bEstimate); }
+static size_t replay_memory(const std::unordered_map<uint64_t, uint64_t> &c, bool &bEstimate) { return replay_node_memory(c, 2 * sizeof(uint64_t) + 2 * sizeof(void*), c.bucket_count(), bEstimate); }
+
+// runs the trace, the result depends on the found keys only so all containers must agree
+template<class C>
+static uint64_t replay(C &c, const std::vector<replay_op> &ops)
+{
+	uint64_t n = 0;
+	for (size_t i = 0; i < ops.size(); i++)
+	{
+		uint64_t k = ops[i].nKey;
+		switch (ops[i].nOp)
+		{
+		case FLAT_TRACE_INSERT: replay_insert(c, k, i); break;
+		case FLAT_TRACE_FIND: n += c.find(k) != c.end() ? 1 : 0; break;
+		case FLAT_TRACE_LOWER_BOUND: n += replay_lower_bound(c, k); break;
+		case FLAT_TRACE_ERASE: c.erase(k); break;
+		case FLAT_TRACE_SCAN: for (typename C::iterator it = c.begin(); it != c.end(); ++it) n++; break;
+		case FLAT_TRACE_CLEAR: c.clear(); break;
+		}
+	}
+	return n;
+}
+
+template<class C>
+static void run(const char *name, const std::vector<replay_op> &ops, size_t nRuns, uint64_t &nExpected)
+{
+	double t = 0;
+	uint64_t n = 0;
+	size_t nBytes = 0;
+	bool bEstimate = false;
+	char sorts[32] = "-";
+	for (size_t r = 0; r < nRuns; r++)
+	{
+		C c;
+		replay_sort_counter::nSorts = 0;
+		replay_clock::time_point t0 = replay_clock::now();
+		n = replay(c, ops);
+		double t1 = std::chrono::duration<double, std::milli>(replay_clock::now() - t0).count();
+		if (r == 0 || t1 < t) t = t1;
+		nBytes = replay_memory(c, bEstimate);
+		if (replay_sorts(c))
+			snprintf(sorts, sizeof(sorts), "%lu", static_cast<unsigned long>(replay_sort_counter::nSorts));
+	}
+	if (nExpected == static_cast<uint64_t>(-1))
+		nExpected = n;
+	printf("  %-36s %12.1f %10s %14lu%s%s\n", name, t, sorts, static_cast<unsigned long>(nBytes), bEstimate ? "~" : " ", n == nExpected ? "" : "  MISMATCH");
+}
+
+int main (int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: flat_replay <trace> [number of runs]\n");
+		return 1;
+	}
+	size_t nRuns = 3;
+	if (argc > 2) nRuns = strtoul(argv[2], 0, 10);
+	if (nRuns == 0) nRuns = 1;
+
+	flat_trace_reader reader;
+	if (!reader.open(argv[1]))
+	{
+		fprintf(stderr, "%s is not a trace\n", argv[1]);
+		return 1;
+	}
+	std::vector<replay_op> ops;
+	size_t nCount[256] = { 0 };
+	replay_op op;
+	while (reader.next(op.nOp, op.nKey))
+	{
+		ops.push_back(op);
+		nCount[static_cast<unsigned char>(op.nOp)]++;
+	}
+
+	printf("%s: %s of %u byte keys%s", argv[1], reader.is_set() ? "set" : "map", reader.header().nKeySize, reader.hashed_keys() ? " (hashed)" : "");
+	if (!reader.is_set()) printf(" and %u byte values", reader.header().nValSize);
+	printf(", %lu operations\n", static_cast<unsigned long>(ops.size()));
+	printf("  insert %lu, find %lu, lower_bound %lu, erase %lu, scan %lu, clear %lu\n",
+		static_cast<unsigned long>(nCount[FLAT_TRACE_INSERT]), static_cast<unsigned long>(nCount[FLAT_TRACE_FIND]),
+		static_cast<unsigned long>(nCount[FLAT_TRACE_LOWER_BOUND]), static_cast<unsigned long>(nCount[FLAT_TRACE_ERASE]),
+		static_cast<unsigned long>(nCount[FLAT_TRACE_SCAN]), static_cast<unsigned long>(nCount[FLAT_TRACE_CLEAR]));
+	printf("  %-36s %12s %10s %15s\n", "", "ms", "sorts", "bytes");
+
+	bool bUnordered = nCount[FLAT_TRACE_LOWER_BOUND] == 0;
+	uint64_t nExpected = static_cast<uint64_t>(-1);
+	if (reader.is_set())
+	{
+		run<flat_set<uint64_t, replay_counting_search<flat_search_binary> > >("flat_set", ops, nRuns, nExpected);
+		run<flat_set<uint64_t, replay_counting_search<flat_search_interpolation> > >("flat_set, interpolation", ops, nRuns, nExpected);
+		run<flat_set<uint64_t, replay_counting_search<flat_search_learned> > >("flat_set, learned", ops, nRuns, nExpected);
+		run<flat_set<uint64_t, replay_counting_search<flat_search_hash<> > > >("flat_set, hash", ops, nRuns, nExpected);
+		run<std::set<uint64_t> >("std::set", ops, nRuns, nExpected);
+		if (bUnordered)
+			run<std::unordered_set<uint64_t> >("std::unordered_set", ops, nRuns, nExpected);
+	}
+	else
+	{
+		run<flat_map<uint64_t, uint64_t, replay_counting_search<flat_search_binary> > >("flat_map", ops, nRuns, nExpected);
+		run<flat_map<uint64_t, uint64_t, replay_counting_search<flat_search_interpolation> > >("flat_map, interpolation", ops, nRuns, nExpected);
+		run<flat_map<uint64_t, uint64_t, replay_counting_search<flat_search_learned> > >("flat_map, learned", ops, nRuns, nExpected);
+		run<flat_map<uint64_t, uint64_t, replay_counting_search<flat_search_hash<> > > >("flat_map, hash", ops, nRuns, nExpected);
+		run<flat_blocked_map<uint64_t, uint64_t> >("flat_blocked_map", ops, nRuns, nExpected);
+		run<flat_versioned_map<uint64_t, uint64_t> >("flat_versioned_map", ops, nRuns, nExpected);
+		run<std::map<uint64_t, uint64_t> >("std::map", ops, nRuns, nExpected);
+		if (bUnordered)
+			run<std::unordered_map<uint64_t, uint64_t> >("std::unordered_map", ops, nRuns, nExpected);
+	}
+	return 0;
+}
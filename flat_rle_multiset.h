@@ -0,0 +1,327 @@
+#ifndef _FLAT_RLE_MULTISET_H_INCLUDED_2026_10_19
+#define _FLAT_RLE_MULTISET_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include "flat_search.h"
+
+/*
+ * Minimalistic multiset C++ template storing runs of equal values
+ *
+ * Flat RLE multiset features
+ * - Stores sorted (value, count) pairs, memory and sort time depend on the number of distinct values
+ * - An add of a stored value increments the count of its run, adds of new values are
+ *   merged on the next lookup, or when they outnumber the runs
+ * - count() is one search, erase() of a value only zeroes the count of its run,
+ *   empty runs are dropped by the next sort()
+ * - Iterators yield every copy of a value, expanding the runs
+ * - Lookup strategy is selected by a search policy (see flat_search.h)
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+template<typename T, typename search_type = flat_search_binary>
+class flat_rle_multiset
+{
+public:
+	typedef std::pair<T, size_t> run_type;
+
+	// Read only forward iterator over all copies of the values
+	class iterator
+	{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef ptrdiff_t difference_type;
+		typedef const T* pointer;
+		typedef const T& reference;
+
+		iterator() : m_p(0), m_pEnd(0), m_i(0) {};
+
+		const T& operator* () const { return m_p->first; }
+		const T* operator-> () const { return &m_p->first; }
+		iterator& operator++ ();
+		iterator operator++ (int) { iterator it(*this); ++(*this); return it; }
+		bool operator== (const iterator& rhs) const { return m_p == rhs.m_p && m_i == rhs.m_i; }
+		bool operator!= (const iterator& rhs) const { return !(*this == rhs); }
+
+		// copies of the value left in its run, this one included
+		size_t run_left() const { return m_p->second - m_i; }
+
+	private:
+		friend class flat_rle_multiset;
+		iterator(const run_type *p, const run_type *pEnd) : m_p(p), m_pEnd(pEnd), m_i(0) { skip_empty(); };
+		void skip_empty() { while (m_p != m_pEnd && m_p->second == 0) ++m_p; }
+
+		const run_type *m_p;
+		const run_type *m_pEnd;
+		size_t m_i;
+	};
+	typedef std::pair<iterator, iterator> iterator_pair;
+
+	flat_rle_multiset() : m_nSize(0) {};
+
+	void clear();
+	void reserve(size_t size);
+	void insert(const T &v, size_t n = 1);
+	iterator find(const T &v);
+	iterator lower_bound(const T &v);
+	iterator upper_bound(const T &v);
+	iterator_pair equal_range(const T &v);
+	size_t count(const T &v);
+	size_t size() const { return m_nSize; }
+	size_t distinct();
+	bool empty() const { return m_nSize == 0; }
+	size_t erase(const T &v);
+	size_t erase(const T &v, size_t n);
+	void swap(flat_rle_multiset& other);
+
+	iterator begin();
+	iterator end();
+
+	search_type &search() { return m_search; }
+	size_t memory_usage() const;
+
+	void sort();
+
+private:
+	template<class U>
+	struct flat_rle_less_key
+	{
+		bool operator() (const U& lhs, const U& rhs) const
+		{
+			return lhs.first < rhs.first;
+		}
+	};
+
+	iterator make_iterator(typename std::vector<run_type>::iterator it);
+	typename std::vector<run_type>::iterator find_run(const T &v);
+
+	std::vector<run_type> ar;
+	std::vector<run_type> m_pending;	// adds not merged yet, equal neighbours collapsed
+	search_type m_search;
+	size_t m_nSize;
+};
+
+//------------------------------------- iterator -----------------------------------------
+
+template<typename T, typename search_type>
+inline typename flat_rle_multiset<T, search_type>::iterator& flat_rle_multiset<T, search_type>::iterator::operator++ ()
+{
+	if (++m_i == m_p->second)
+	{
+		++m_p;
+		m_i = 0;
+		skip_empty();
+	}
+	return *this;
+}
+
+//------------------------------------- flat_rle_multiset -----------------------------------------
+
+template<typename T, typename search_type>
+inline void flat_rle_multiset<T, search_type>::clear()
+{
+	ar.clear();
+	m_pending.clear();
+	m_search.invalidate();
+	m_nSize = 0;
+}
+
+template<typename T, typename search_type>
+inline void flat_rle_multiset<T, search_type>::reserve(size_t size)
+{
+	ar.reserve(size);
+}
+
+template<typename T, typename search_type>
+inline void flat_rle_multiset<T, search_type>::insert(const T &v, size_t n /*= 1*/)
+{
+	if (n == 0) return;
+	m_nSize += n;
+
+	// a value with a run only increments its count
+	typename std::vector<run_type>::iterator it = m_search.find(ar.begin(), ar.end(), v, flat_key_first());
+	if (it != ar.end())
+	{
+		it->second += n;
+		return;
+	}
+	if (!m_pending.empty() && !(m_pending.back().first < v) && !(v < m_pending.back().first))
+	{
+		m_pending.back().second += n;
+		return;
+	}
+	m_pending.push_back(run_type(v, n));
+
+	// merging early keeps the adds from growing beyond the number of runs
+	if (m_pending.size() >= 1024 && m_pending.size() >= ar.size())
+		sort();
+}
+
+template<typename T, typename search_type>
+inline typename flat_rle_multiset<T, search_type>::iterator flat_rle_multiset<T, search_type>::make_iterator(typename std::vector<run_type>::iterator it)
+{
+	const run_type *p = ar.empty() ? 0 : &ar[0];
+	return iterator(p + (it - ar.begin()), p + ar.size());
+}
+
+template<typename T, typename search_type>
+inline typename std::vector<typename flat_rle_multiset<T, search_type>::run_type>::iterator flat_rle_multiset<T, search_type>::find_run(const T &v)
+{
+	if (!m_pending.empty()) sort();
+	return m_search.find(ar.begin(), ar.end(), v, flat_key_first());
+}
+
+template<typename T, typename search_type>
+inline typename flat_rle_multiset<T, search_type>::iterator flat_rle_multiset<T, search_type>::find(const T &v)
+{
+	typename std::vector<run_type>::iterator it = find_run(v);
+	if (it == ar.end() || it->second == 0)
+		return end();
+	return make_iterator(it);
+}
+
+template<typename T, typename search_type>
+inline typename flat_rle_multiset<T, search_type>::iterator flat_rle_multiset<T, search_type>::lower_bound(const T &v)
+{
+	if (!m_pending.empty()) sort();
+	return make_iterator(m_search.lower_bound(ar.begin(), ar.end(), v, flat_key_first()));
+}
+
+template<typename T, typename search_type>
+inline typename flat_rle_multiset<T, search_type>::iterator flat_rle_multiset<T, search_type>::upper_bound(const T &v)
+{
+	if (!m_pending.empty()) sort();
+	return make_iterator(m_search.upper_bound(ar.begin(), ar.end(), v, flat_key_first()));
+}
+
+template<typename T, typename search_type>
+inline typename flat_rle_multiset<T, search_type>::iterator_pair flat_rle_multiset<T, search_type>::equal_range(const T &v)
+{
+	typename std::vector<run_type>::iterator it = find_run(v);
+	if (it == ar.end() || it->second == 0)
+	{
+		iterator i0 = lower_bound(v);
+		return iterator_pair(i0, i0);
+	}
+	return iterator_pair(make_iterator(it), make_iterator(it + 1));
+}
+
+template<typename T, typename search_type>
+inline size_t flat_rle_multiset<T, search_type>::count(const T &v)
+{
+	typename std::vector<run_type>::iterator it = find_run(v);
+	if (it == ar.end()) return 0;
+	return it->second;
+}
+
+template<typename T, typename search_type>
+inline size_t flat_rle_multiset<T, search_type>::distinct()
+{
+	if (!m_pending.empty()) sort();
+	size_t n = 0;
+	for (size_t i = 0; i < ar.size(); i++)
+		if (ar[i].second != 0) n++;
+	return n;
+}
+
+template<typename T, typename search_type>
+inline size_t flat_rle_multiset<T, search_type>::erase(const T &v)
+{
+	typename std::vector<run_type>::iterator it = find_run(v);
+	if (it == ar.end()) return 0;
+	size_t n = it->second;
+	it->second = 0;
+	m_nSize -= n;
+	return n;
+}
+
+template<typename T, typename search_type>
+inline size_t flat_rle_multiset<T, search_type>::erase(const T &v, size_t n)
+{
+	typename std::vector<run_type>::iterator it = find_run(v);
+	if (it == ar.end()) return 0;
+	if (n > it->second) n = it->second;
+	it->second -= n;
+	m_nSize -= n;
+	return n;
+}
+
+template<typename T, typename search_type>
+inline void flat_rle_multiset<T, search_type>::swap(flat_rle_multiset<T, search_type>& other)
+{
+	ar.swap(other.ar);
+	m_pending.swap(other.m_pending);
+	std::swap(m_search, other.m_search);
+	std::swap(m_nSize, other.m_nSize);
+}
+
+template<typename T, typename search_type>
+inline typename flat_rle_multiset<T, search_type>::iterator flat_rle_multiset<T, search_type>::begin()
+{
+	if (!m_pending.empty()) sort();
+	return make_iterator(ar.begin());
+}
+
+template<typename T, typename search_type>
+inline typename flat_rle_multiset<T, search_type>::iterator flat_rle_multiset<T, search_type>::end()
+{
+	if (!m_pending.empty()) sort();
+	return make_iterator(ar.end());
+}
+
+template<typename T, typename search_type>
+inline size_t flat_rle_multiset<T, search_type>::memory_usage() const
+{
+	return (ar.capacity() + m_pending.capacity())*sizeof(run_type) + m_search.memory_usage();
+}
+
+template<typename T, typename search_type>
+void inline flat_rle_multiset<T, search_type>::sort()
+{
+	std::sort(m_pending.begin(), m_pending.end(), flat_rle_less_key<run_type>());
+
+	// merging runs of both vectors, equal values are summed and empty runs dropped
+	std::vector<run_type> runs;
+	runs.reserve(ar.size() + m_pending.size());
+	typename std::vector<run_type>::iterator i0 = ar.begin();
+	typename std::vector<run_type>::iterator i1 = m_pending.begin();
+	while (i0 != ar.end() || i1 != m_pending.end())
+	{
+		const run_type &r = (i1 == m_pending.end() || (i0 != ar.end() && !(i1->first < i0->first))) ? *i0++ : *i1++;
+		if (r.second == 0) continue;
+		if (!runs.empty() && !(runs.back().first < r.first))
+			runs.back().second += r.second;
+		else
+			runs.push_back(r);
+	}
+	ar.swap(runs);
+	std::vector<run_type>().swap(m_pending);
+	m_search.build(ar.begin(), ar.end(), flat_key_first());
+}
+
+#endif // _FLAT_RLE_MULTISET_H_INCLUDED_2026_10_19
@@ -0,0 +1,593 @@
+#ifndef _FLAT_ROARING_SET_H_INCLUDED_2026_10_19
+#define _FLAT_ROARING_SET_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+
+/*
+ * Hybrid bitmap set of 32 bit integers based on vector
+ *
+ * Flat roaring set features
+ * - Values are grouped into chunks by their high 16 bits
+ * - A chunk stores the low 16 bits as a sorted array (up to 4096 values),
+ *   as a bitmap (denser chunks) or as runs (after sort())
+ * - Same interface as flat_set, inserts and erases are applied immediately
+ * - In place union, intersection and difference
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+class flat_roaring_set
+{
+public:
+	typedef unsigned int value_type;
+	class iterator;
+	typedef std::pair<iterator, iterator> iterator_pair;
+
+	flat_roaring_set() : m_nSize(0) {};
+
+	void clear();
+	void reserve(size_t) {}		// kept for flat_set compatibility
+	void insert(value_type v);
+	iterator find(value_type v) const;
+	iterator lower_bound(value_type v) const;
+	iterator upper_bound(value_type v) const;
+	iterator_pair equal_range(value_type v) const;
+	size_t count(value_type v) const;
+	size_t size() const { return m_nSize; }
+	bool empty() const { return m_nSize == 0; }
+	iterator erase(value_type v);
+	iterator erase(iterator it);
+	void swap(flat_roaring_set& other);
+
+	iterator begin() const;
+	iterator end() const;
+
+	void sort();	// converts chunks to their smallest representation
+	size_t memory_usage() const;
+
+	void unite(const flat_roaring_set& other);
+	void intersect(const flat_roaring_set& other);
+	void subtract(const flat_roaring_set& other);
+
+private:
+	typedef unsigned long long word_type;
+
+	enum { ARRAY_MAX = 4096, BITMAP_WORDS = 1024, CHUNK_END = 65536 };
+	enum { CHUNK_ARRAY, CHUNK_BITMAP, CHUNK_RUNS };
+
+	struct chunk
+	{
+		chunk() : nKey(0), nKind(CHUNK_ARRAY), nCount(0) {};
+
+		unsigned short nKey;		// high 16 bits of the values
+		unsigned char nKind;
+		unsigned nCount;
+		std::vector<unsigned short> ar;	// sorted values, or (start, length - 1) of the runs
+		std::vector<word_type> bits;
+	};
+
+public:
+	// Read only forward iterator
+	class iterator
+	{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef unsigned int value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const value_type* pointer;
+		typedef const value_type& reference;
+
+		iterator() : m_pSet(0), m_nChunk(0), m_value(0) {};
+
+		const value_type& operator* () const { return m_value; }
+		const value_type* operator-> () const { return &m_value; }
+		iterator& operator++ ();
+		iterator operator++ (int) { iterator it(*this); ++(*this); return it; }
+		bool operator== (const iterator& rhs) const { return m_nChunk == rhs.m_nChunk && m_value == rhs.m_value; }
+		bool operator!= (const iterator& rhs) const { return !(*this == rhs); }
+
+	private:
+		friend class flat_roaring_set;
+		iterator(const flat_roaring_set* pSet, size_t nChunk, value_type v) : m_pSet(pSet), m_nChunk(nChunk), m_value(v) {};
+
+		const flat_roaring_set* m_pSet;
+		size_t m_nChunk;
+		value_type m_value;
+	};
+
+private:
+	friend class iterator;
+
+	enum { OP_OR, OP_AND, OP_ANDNOT };
+
+	static unsigned popcount(word_type w);
+	static unsigned ctz(word_type w);
+	static unsigned next_bit(const std::vector<word_type> &bits, unsigned n, bool bSet);
+
+	static bool chunk_contains(const chunk &c, unsigned nLow);
+	static unsigned chunk_next(const chunk &c, unsigned nLow);
+	static void chunk_to_bits(const chunk &c, std::vector<word_type> &bits);
+	static void chunk_from_bits(chunk &c, std::vector<word_type> &bits, bool bAllowRuns);
+	static bool chunk_add(chunk &c, unsigned nLow);
+	static bool chunk_remove(chunk &c, unsigned nLow);
+	static void chunk_combine(chunk &a, const chunk &b, int nOp);
+
+	size_t chunk_index(unsigned nKey) const;
+	iterator next(size_t nChunk, unsigned nLow) const;
+
+	std::vector<chunk> m_chunks;	// sorted by nKey
+	size_t m_nSize;
+};
+
+//------------------------------------- chunks -----------------------------------------
+
+inline unsigned flat_roaring_set::popcount(word_type w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<unsigned>(__builtin_popcountll(w));
+#else
+	unsigned n = 0;
+	for (; w; w &= w - 1) n++;
+	return n;
+#endif
+}
+
+inline unsigned flat_roaring_set::ctz(word_type w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<unsigned>(__builtin_ctzll(w));
+#else
+	unsigned n = 0;
+	for (; !(w & 1); w >>= 1) n++;
+	return n;
+#endif
+}
+
+// First position not less than n with the bit equal to bSet, CHUNK_END if there is none
+inline unsigned flat_roaring_set::next_bit(const std::vector<word_type> &bits, unsigned n, bool bSet)
+{
+	if (n >= CHUNK_END) return CHUNK_END;
+	size_t w = n >> 6;
+	word_type x = (bSet ? bits[w] : ~bits[w]) & (~static_cast<word_type>(0) << (n & 63));
+	while (x == 0)
+	{
+		if (++w == BITMAP_WORDS) return CHUNK_END;
+		x = bSet ? bits[w] : ~bits[w];
+	}
+	return static_cast<unsigned>(w * 64 + ctz(x));
+}
+
+inline bool flat_roaring_set::chunk_contains(const chunk &c, unsigned nLow)
+{
+	if (c.nKind == CHUNK_BITMAP)
+		return (c.bits[nLow >> 6] >> (nLow & 63)) & 1;
+	if (c.nKind == CHUNK_ARRAY)
+		return std::binary_search(c.ar.begin(), c.ar.end(), static_cast<unsigned short>(nLow));
+	return chunk_next(c, nLow) == nLow;
+}
+
+// Smallest value of the chunk not less than nLow, CHUNK_END if there is none
+inline unsigned flat_roaring_set::chunk_next(const chunk &c, unsigned nLow)
+{
+	if (nLow >= CHUNK_END) return CHUNK_END;
+	if (c.nKind == CHUNK_ARRAY)
+	{
+		std::vector<unsigned short>::const_iterator it =
+			std::lower_bound(c.ar.begin(), c.ar.end(), static_cast<unsigned short>(nLow));
+		return it == c.ar.end() ? static_cast<unsigned>(CHUNK_END) : *it;
+	}
+	if (c.nKind == CHUNK_BITMAP)
+		return next_bit(c.bits, nLow, true);
+	// runs: the first run that ends at or after nLow
+	size_t lo = 0;
+	size_t hi = c.ar.size() / 2;
+	while (lo < hi)
+	{
+		size_t m = (lo + hi) / 2;
+		if (static_cast<unsigned>(c.ar[2 * m]) + c.ar[2 * m + 1] < nLow)
+			lo = m + 1;
+		else
+			hi = m;
+	}
+	if (lo == c.ar.size() / 2) return CHUNK_END;
+	return std::max(nLow, static_cast<unsigned>(c.ar[2 * lo]));
+}
+
+inline void flat_roaring_set::chunk_to_bits(const chunk &c, std::vector<word_type> &bits)
+{
+	if (c.nKind == CHUNK_BITMAP)
+	{
+		bits = c.bits;
+		return;
+	}
+	bits.assign(BITMAP_WORDS, 0);
+	if (c.nKind == CHUNK_ARRAY)
+	{
+		for (size_t i = 0; i < c.ar.size(); i++)
+			bits[c.ar[i] >> 6] |= static_cast<word_type>(1) << (c.ar[i] & 63);
+		return;
+	}
+	for (size_t r = 0; r < c.ar.size(); r += 2)
+		for (unsigned v = c.ar[r], e = v + c.ar[r + 1]; v <= e; v++)
+			bits[v >> 6] |= static_cast<word_type>(1) << (v & 63);
+}
+
+// Picks the smallest representation of the values in bits
+inline void flat_roaring_set::chunk_from_bits(chunk &c, std::vector<word_type> &bits, bool bAllowRuns)
+{
+	unsigned nCount = 0;
+	unsigned nRuns = 0;
+	word_type nPrevTop = 0;
+	for (size_t w = 0; w < BITMAP_WORDS; w++)
+	{
+		word_type x = bits[w];
+		nCount += popcount(x);
+		if (bAllowRuns)
+		{
+			// a run starts at every set bit whose lower neighbour is clear
+			nRuns += popcount(x & ~((x << 1) | nPrevTop));
+			nPrevTop = x >> 63;
+		}
+	}
+	c.nCount = nCount;
+	c.ar.clear();
+
+	if (bAllowRuns && nRuns * 4 < std::min(nCount * 2, static_cast<unsigned>(BITMAP_WORDS * 8)))
+	{
+		c.nKind = CHUNK_RUNS;
+		std::vector<word_type>().swap(c.bits);
+		c.ar.reserve(nRuns * 2);
+		unsigned v = 0;
+		while ((v = next_bit(bits, v, true)) < CHUNK_END)
+		{
+			unsigned e = next_bit(bits, v, false);
+			c.ar.push_back(static_cast<unsigned short>(v));
+			c.ar.push_back(static_cast<unsigned short>(e - 1 - v));
+			v = e;
+		}
+		return;
+	}
+	if (nCount <= ARRAY_MAX)
+	{
+		c.nKind = CHUNK_ARRAY;
+		c.ar.reserve(nCount);
+		for (size_t w = 0; w < BITMAP_WORDS; w++)
+			for (word_type x = bits[w]; x; x &= x - 1)
+				c.ar.push_back(static_cast<unsigned short>(w * 64 + ctz(x)));
+		std::vector<word_type>().swap(c.bits);
+		return;
+	}
+	c.nKind = CHUNK_BITMAP;
+	c.bits.swap(bits);
+}
+
+inline bool flat_roaring_set::chunk_add(chunk &c, unsigned nLow)
+{
+	std::vector<word_type> bits;
+	if (c.nKind == CHUNK_RUNS)
+	{
+		chunk_to_bits(c, bits);
+		chunk_from_bits(c, bits, false);
+	}
+	if (c.nKind == CHUNK_BITMAP)
+	{
+		word_type &w = c.bits[nLow >> 6];
+		word_type m = static_cast<word_type>(1) << (nLow & 63);
+		if (w & m) return false;
+		w |= m;
+		c.nCount++;
+		return true;
+	}
+	std::vector<unsigned short>::iterator it =
+		std::lower_bound(c.ar.begin(), c.ar.end(), static_cast<unsigned short>(nLow));
+	if (it != c.ar.end() && *it == nLow) return false;
+	c.ar.insert(it, static_cast<unsigned short>(nLow));
+	c.nCount++;
+	if (c.nCount > ARRAY_MAX)
+	{
+		chunk_to_bits(c, bits);
+		chunk_from_bits(c, bits, false);
+	}
+	return true;
+}
+
+inline bool flat_roaring_set::chunk_remove(chunk &c, unsigned nLow)
+{
+	std::vector<word_type> bits;
+	if (c.nKind == CHUNK_RUNS)
+	{
+		if (!chunk_contains(c, nLow)) return false;
+		chunk_to_bits(c, bits);
+		chunk_from_bits(c, bits, false);
+	}
+	if (c.nKind == CHUNK_BITMAP)
+	{
+		word_type &w = c.bits[nLow >> 6];
+		word_type m = static_cast<word_type>(1) << (nLow & 63);
+		if (!(w & m)) return false;
+		w &= ~m;
+		if (--c.nCount <= ARRAY_MAX)
+			chunk_from_bits(c, c.bits, false);
+		return true;
+	}
+	std::vector<unsigned short>::iterator it =
+		std::lower_bound(c.ar.begin(), c.ar.end(), static_cast<unsigned short>(nLow));
+	if (it == c.ar.end() || *it != nLow) return false;
+	c.ar.erase(it);
+	c.nCount--;
+	return true;
+}
+
+inline void flat_roaring_set::chunk_combine(chunk &a, const chunk &b, int nOp)
+{
+	if (a.nKind == CHUNK_ARRAY && nOp != OP_OR)
+	{
+		// filtering a small array beats materializing bitmaps
+		size_t n = 0;
+		for (size_t i = 0; i < a.ar.size(); i++)
+			if (chunk_contains(b, a.ar[i]) == (nOp == OP_AND))
+				a.ar[n++] = a.ar[i];
+		a.ar.resize(n);
+		a.nCount = static_cast<unsigned>(n);
+		return;
+	}
+	if (a.nKind == CHUNK_ARRAY && b.nKind == CHUNK_ARRAY)
+	{
+		std::vector<unsigned short> res;
+		res.reserve(a.ar.size() + b.ar.size());
+		std::set_union(a.ar.begin(), a.ar.end(), b.ar.begin(), b.ar.end(), std::back_inserter(res));
+		if (res.size() <= ARRAY_MAX)
+		{
+			a.ar.swap(res);
+			a.nCount = static_cast<unsigned>(a.ar.size());
+			return;
+		}
+	}
+	std::vector<word_type> x, y;
+	chunk_to_bits(a, x);
+	chunk_to_bits(b, y);
+	for (size_t w = 0; w < BITMAP_WORDS; w++)
+	{
+		if (nOp == OP_OR) x[w] |= y[w];
+		else if (nOp == OP_AND) x[w] &= y[w];
+		else x[w] &= ~y[w];
+	}
+	chunk_from_bits(a, x, false);
+}
+
+//------------------------------------- flat_roaring_set -----------------------------------------
+
+inline flat_roaring_set::iterator& flat_roaring_set::iterator::operator++ ()
+{
+	*this = m_pSet->next(m_nChunk, (m_value & 0xFFFF) + 1);
+	return *this;
+}
+
+// Index of the chunk with the key, or of the first chunk with a greater key
+inline size_t flat_roaring_set::chunk_index(unsigned nKey) const
+{
+	size_t lo = 0;
+	size_t hi = m_chunks.size();
+	while (lo < hi)
+	{
+		size_t m = (lo + hi) / 2;
+		if (m_chunks[m].nKey < nKey)
+			lo = m + 1;
+		else
+			hi = m;
+	}
+	return lo;
+}
+
+// First value in the chunks starting from the value nLow of the chunk nChunk
+inline flat_roaring_set::iterator flat_roaring_set::next(size_t nChunk, unsigned nLow) const
+{
+	for (; nChunk < m_chunks.size(); nChunk++, nLow = 0)
+	{
+		unsigned n = chunk_next(m_chunks[nChunk], nLow);
+		if (n < CHUNK_END)
+			return iterator(this, nChunk, (static_cast<value_type>(m_chunks[nChunk].nKey) << 16) | n);
+	}
+	return end();
+}
+
+inline void flat_roaring_set::clear()
+{
+	m_chunks.clear();
+	m_nSize = 0;
+}
+
+inline void flat_roaring_set::insert(value_type v)
+{
+	unsigned nKey = v >> 16;
+	size_t i = chunk_index(nKey);
+	if (i == m_chunks.size() || m_chunks[i].nKey != nKey)
+	{
+		m_chunks.insert(m_chunks.begin() + i, chunk());
+		m_chunks[i].nKey = static_cast<unsigned short>(nKey);
+	}
+	if (chunk_add(m_chunks[i], v & 0xFFFF)) m_nSize++;
+}
+
+inline flat_roaring_set::iterator flat_roaring_set::find(value_type v) const
+{
+	iterator it = lower_bound(v);
+	if (it == end() || *it != v)
+		return end();
+	return it;
+}
+
+inline flat_roaring_set::iterator flat_roaring_set::lower_bound(value_type v) const
+{
+	unsigned nKey = v >> 16;
+	size_t i = chunk_index(nKey);
+	if (i < m_chunks.size() && m_chunks[i].nKey == nKey)
+		return next(i, v & 0xFFFF);
+	return next(i, 0);
+}
+
+inline flat_roaring_set::iterator flat_roaring_set::upper_bound(value_type v) const
+{
+	if (v == 0xFFFFFFFFu) return end();
+	return lower_bound(v + 1);
+}
+
+inline flat_roaring_set::iterator_pair flat_roaring_set::equal_range(value_type v) const
+{
+	iterator it = lower_bound(v);
+	if (it == end() || *it != v)
+		return iterator_pair(it, it);
+	iterator it1 = it;
+	return iterator_pair(it, ++it1);
+}
+
+inline size_t flat_roaring_set::count(value_type v) const
+{
+	unsigned nKey = v >> 16;
+	size_t i = chunk_index(nKey);
+	if (i == m_chunks.size() || m_chunks[i].nKey != nKey) return 0;
+	return chunk_contains(m_chunks[i], v & 0xFFFF) ? 1 : 0;
+}
+
+inline flat_roaring_set::iterator flat_roaring_set::erase(value_type v)
+{
+	unsigned nKey = v >> 16;
+	size_t i = chunk_index(nKey);
+	if (i < m_chunks.size() && m_chunks[i].nKey == nKey && chunk_remove(m_chunks[i], v & 0xFFFF))
+	{
+		m_nSize--;
+		if (m_chunks[i].nCount == 0) m_chunks.erase(m_chunks.begin() + i);
+	}
+	return lower_bound(v);
+}
+
+inline flat_roaring_set::iterator flat_roaring_set::erase(iterator it)
+{
+	return erase(*it);
+}
+
+inline void flat_roaring_set::swap(flat_roaring_set& other)
+{
+	m_chunks.swap(other.m_chunks);
+	std::swap(m_nSize, other.m_nSize);
+}
+
+inline flat_roaring_set::iterator flat_roaring_set::begin() const
+{
+	return next(0, 0);
+}
+
+inline flat_roaring_set::iterator flat_roaring_set::end() const
+{
+	return iterator(this, m_chunks.size(), 0);
+}
+
+inline void flat_roaring_set::sort()
+{
+	std::vector<word_type> bits;
+	for (size_t i = 0; i < m_chunks.size(); i++)
+	{
+		chunk_to_bits(m_chunks[i], bits);
+		chunk_from_bits(m_chunks[i], bits, true);
+	}
+}
+
+inline size_t flat_roaring_set::memory_usage() const
+{
+	size_t n = sizeof(*this) + m_chunks.capacity()*sizeof(chunk);
+	for (size_t i = 0; i < m_chunks.size(); i++)
+		n += m_chunks[i].ar.capacity()*sizeof(unsigned short) + m_chunks[i].bits.capacity()*sizeof(word_type);
+	return n;
+}
+
+inline void flat_roaring_set::unite(const flat_roaring_set& other)
+{
+	std::vector<chunk> res;
+	res.reserve(m_chunks.size() + other.m_chunks.size());
+	size_t i = 0, j = 0;
+	m_nSize = 0;
+	while (i < m_chunks.size() || j < other.m_chunks.size())
+	{
+		if (j == other.m_chunks.size() || (i < m_chunks.size() && m_chunks[i].nKey < other.m_chunks[j].nKey))
+			res.push_back(chunk());
+		else if (i == m_chunks.size() || other.m_chunks[j].nKey < m_chunks[i].nKey)
+		{
+			res.push_back(other.m_chunks[j++]);
+			m_nSize += res.back().nCount;
+			continue;
+		}
+		else
+		{
+			res.push_back(chunk());
+			chunk_combine(m_chunks[i], other.m_chunks[j++], OP_OR);
+		}
+		res.back().nKey = m_chunks[i].nKey;
+		res.back().nKind = m_chunks[i].nKind;
+		res.back().nCount = m_chunks[i].nCount;
+		res.back().ar.swap(m_chunks[i].ar);
+		res.back().bits.swap(m_chunks[i].bits);
+		m_nSize += res.back().nCount;
+		i++;
+	}
+	m_chunks.swap(res);
+}
+
+inline void flat_roaring_set::intersect(const flat_roaring_set& other)
+{
+	size_t n = 0;
+	m_nSize = 0;
+	for (size_t i = 0; i < m_chunks.size(); i++)
+	{
+		size_t j = other.chunk_index(m_chunks[i].nKey);
+		if (j == other.m_chunks.size() || other.m_chunks[j].nKey != m_chunks[i].nKey) continue;
+		chunk_combine(m_chunks[i], other.m_chunks[j], OP_AND);
+		if (m_chunks[i].nCount == 0) continue;
+		m_nSize += m_chunks[i].nCount;
+		if (n != i) std::swap(m_chunks[n], m_chunks[i]);
+		n++;
+	}
+	m_chunks.erase(m_chunks.begin() + n, m_chunks.end());
+}
+
+inline void flat_roaring_set::subtract(const flat_roaring_set& other)
+{
+	size_t n = 0;
+	m_nSize = 0;
+	for (size_t i = 0; i < m_chunks.size(); i++)
+	{
+		size_t j = other.chunk_index(m_chunks[i].nKey);
+		if (j < other.m_chunks.size() && other.m_chunks[j].nKey == m_chunks[i].nKey)
+			chunk_combine(m_chunks[i], other.m_chunks[j], OP_ANDNOT);
+		if (m_chunks[i].nCount == 0) continue;
+		m_nSize += m_chunks[i].nCount;
+		if (n != i) std::swap(m_chunks[n], m_chunks[i]);
+		n++;
+	}
+	m_chunks.erase(m_chunks.begin() + n, m_chunks.end());
+}
+
+#endif // _FLAT_ROARING_SET_H_INCLUDED_2026_10_19
@@ -0,0 +1,762 @@
+#ifndef _FLAT_SEARCH_H_INCLUDED_2026_10_19
+#define _FLAT_SEARCH_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstddef>
+#include <string>
+#include <cmath>
+
+/*
+ * Search policies for flat containers
+ *
+ * A search policy decides how a sorted flat container locates a key.
+ * - flat_search_binary   plain binary search, no auxiliary memory (default)
+ * - flat_search_learned  piecewise linear model of key positions with a bounded
+ *                        error, for large containers with numeric keys
+ * - flat_search_interpolation  guarded interpolation search for numeric keys
+ *                        with a near uniform distribution, no auxiliary memory
+ * - flat_search_hash     open addressing hash table of positions for find(),
+ *                        bounds are found by binary search
+ * - flat_search_bloom    blocked Bloom filter rejecting most misses of find()
+ *                        before another policy searches
+ *
+ * Every policy provides
+ * - build(i0, i1, key)   called by the container at the end of sort()
+ * - invalidate()         called when positions inside the container change,
+ *                        the policy rebuilds itself on the next lookup
+ * - lower_bound(i0, i1, k, key), upper_bound(...), find(...)
+ * - memory_usage()       bytes used by auxiliary structures
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+// Extracts the key from an element of flat_set / flat_multiset
+struct flat_key_self
+{
+	template<class T>
+	const T& operator() (const T& v) const
+	{
+		return v;
+	}
+};
+
+// Extracts the key from an element of flat_map / flat_multimap
+struct flat_key_first
+{
+	template<class T>
+	const typename T::first_type& operator() (const T& p) const
+	{
+		return p.first;
+	}
+};
+
+// element < key, used by lower_bound
+template<class K, class KeyOf>
+struct flat_search_less_elem
+{
+	flat_search_less_elem(KeyOf key) : m_key(key) {};
+
+	template<class T>
+	bool operator() (const T& e, const K& k) const
+	{
+		return m_key(e) < k;
+	}
+	KeyOf m_key;
+};
+
+// key < element, used by upper_bound
+template<class K, class KeyOf>
+struct flat_search_less_key
+{
+	flat_search_less_key(KeyOf key) : m_key(key) {};
+
+	template<class T>
+	bool operator() (const K& k, const T& e) const
+	{
+		return k < m_key(e);
+	}
+	KeyOf m_key;
+};
+
+template<bool b>
+struct flat_bool
+{
+};
+
+// numeric_limits is specialized for T, arrays such as string literals are not numbers
+template<typename T> struct flat_is_number { enum { value = std::numeric_limits<T>::is_specialized }; };
+template<typename T, size_t n> struct flat_is_number<T[n]> { enum { value = false }; };
+
+template<typename T> inline bool flat_is_negative(const T &, flat_bool<false>) { return false; }
+template<typename T> inline bool flat_is_negative(const T &v, flat_bool<true>) { return v < T(); }
+
+// false when the floating point k is out of the range of T, converting it would be undefined
+template<typename T, typename U> inline bool flat_numeric_fits(const U &, flat_bool<true>) { return true; }
+template<typename T, typename U>
+inline bool flat_numeric_fits(const U &k, flat_bool<false>)
+{
+	typedef std::numeric_limits<T> limits;
+	if (limits::is_integer)
+		return k >= static_cast<U>((limits::min)()) && k < static_cast<U>((limits::max)()) + 1;
+	if (!(static_cast<long double>((limits::max)()) < static_cast<long double>((std::numeric_limits<U>::max)())))
+		return true;
+	if (k == std::numeric_limits<U>::infinity() || k == -std::numeric_limits<U>::infinity())
+		return true;
+	return !(static_cast<U>((limits::max)()) < k) && !(k < -static_cast<U>((limits::max)()));
+}
+
+// A number k of another type as a key of type T, used by find<U> of the containers:
+// true and t == k when k converts to T and back without change, false when no key
+// of type T can be equal to k (a fraction, out of range or of the other sign)
+template<typename T, typename U>
+inline bool flat_numeric_key(const U &k, T &t)
+{
+	if (!flat_numeric_fits<T>(k, flat_bool<std::numeric_limits<U>::is_integer>()))
+		return false;
+	t = static_cast<T>(k);
+	if (!flat_numeric_fits<U>(t, flat_bool<std::numeric_limits<T>::is_integer>()))
+		return false;
+	return static_cast<U>(t) == k &&
+		flat_is_negative(t, flat_bool<std::numeric_limits<T>::is_signed>()) == flat_is_negative(k, flat_bool<std::numeric_limits<U>::is_signed>());
+}
+
+// Cuts [first, last) into at most nParts ranges of about the same length, used by split().
+// With bGroups a cut moves forward until it falls between two different keys, so equal keys
+// of a multi container stay in one range. Empty ranges are not returned.
+template<class It, class KeyOf>
+inline std::vector<std::pair<It, It> > flat_split_ranges(It first, It last, size_t nParts, bool bGroups, KeyOf key)
+{
+	std::vector<std::pair<It, It> > ranges;
+	size_t nSize = last - first;
+	if (nParts == 0) nParts = 1;
+	size_t nBegin = 0;
+	for (size_t i = 1; i <= nParts && nBegin < nSize; i++)
+	{
+		size_t nEnd = i == nParts ? nSize : nSize / nParts * i + nSize % nParts * i / nParts;
+		if (nEnd <= nBegin)
+			continue;
+		if (bGroups)
+			while (nEnd < nSize && !(key(first[nEnd - 1]) < key(first[nEnd])))
+				nEnd++;
+		ranges.push_back(std::pair<It, It>(first + nBegin, first + nEnd));
+		nBegin = nEnd;
+	}
+	return ranges;
+}
+
+//---------------------------------- flat_search_binary ------------------------------------
+
+struct flat_search_binary
+{
+	template<class It, class KeyOf>
+	void build(It, It, KeyOf) {}
+	void invalidate() {}
+
+	template<class It, class K, class KeyOf>
+	It lower_bound(It i0, It i1, const K &k, KeyOf key)
+	{
+		return std::lower_bound(i0, i1, k, flat_search_less_elem<K, KeyOf>(key));
+	}
+
+	template<class It, class K, class KeyOf>
+	It upper_bound(It i0, It i1, const K &k, KeyOf key)
+	{
+		return std::upper_bound(i0, i1, k, flat_search_less_key<K, KeyOf>(key));
+	}
+
+	template<class It, class K, class KeyOf>
+	It find(It i0, It i1, const K &k, KeyOf key)
+	{
+		It it = lower_bound(i0, i1, k, key);
+		if (it == i1 || k < key(*it))
+			return i1;
+		return it;
+	}
+
+	size_t memory_usage() const { return 0; }
+};
+
+//---------------------------------- flat_search_learned -----------------------------------
+
+// Keys are split into segments, inside a segment position of every distinct key
+// is predicted by a line with an error of at most epsilon. A lookup finds the
+// segment, predicts the position and searches a window of 2*epsilon elements.
+// Keys must be convertible to double.
+class flat_search_learned
+{
+public:
+	flat_search_learned(size_t nEpsilon = 32) : m_nEpsilon(nEpsilon ? nEpsilon : 1), m_nSize(0), m_bBuilt(false) {};
+
+	void set_epsilon(size_t nEpsilon);
+	size_t epsilon() const { return m_nEpsilon; }
+	size_t segments() const { return m_keys.size(); }
+
+	template<class It, class KeyOf>
+	void build(It i0, It i1, KeyOf key);
+	void invalidate();
+
+	template<class It, class K, class KeyOf>
+	It lower_bound(It i0, It i1, const K &k, KeyOf key);
+	template<class It, class K, class KeyOf>
+	It upper_bound(It i0, It i1, const K &k, KeyOf key);
+	template<class It, class K, class KeyOf>
+	It find(It i0, It i1, const K &k, KeyOf key);
+
+	size_t memory_usage() const;
+
+private:
+	struct segment
+	{
+		double slope;
+		size_t pos;
+	};
+
+	template<class It, class K, class KeyOf>
+	It search(It i0, It i1, const K &k, KeyOf key, bool bUpper);
+
+	size_t predict(double x) const;
+
+	std::vector<double> m_keys;		// first key of every segment
+	std::vector<segment> m_segments;
+	size_t m_nEpsilon;
+	size_t m_nSize;
+	bool m_bBuilt;
+};
+
+inline void flat_search_learned::set_epsilon(size_t nEpsilon)
+{
+	m_nEpsilon = nEpsilon ? nEpsilon : 1;
+	invalidate();
+}
+
+inline void flat_search_learned::invalidate()
+{
+	m_bBuilt = false;
+}
+
+inline size_t flat_search_learned::memory_usage() const
+{
+	return m_keys.capacity()*sizeof(double) + m_segments.capacity()*sizeof(segment);
+}
+
+template<class It, class KeyOf>
+inline void flat_search_learned::build(It i0, It i1, KeyOf key)
+{
+	m_keys.clear();
+	m_segments.clear();
+	m_nSize = static_cast<size_t>(i1 - i0);
+	m_bBuilt = true;
+	if (m_nSize == 0) return;
+
+	const double dEps = static_cast<double>(m_nEpsilon);
+	const double dMax = std::numeric_limits<double>::max();
+
+	// Shrinking cone: keep the range of slopes for which every key of the
+	// segment is predicted within epsilon, start a new segment when it is empty
+	double x0 = static_cast<double>(key(i0[0]));
+	size_t y0 = 0;
+	double dLo = 0.;
+	double dHi = dMax;
+	for (size_t i = 1; i <= m_nSize; i++)
+	{
+		bool bFits = false;
+		double x = 0.;
+		if (i < m_nSize)
+		{
+			// only the first occurrence of every key is modeled
+			if (!(key(i0[i - 1]) < key(i0[i]))) continue;
+			x = static_cast<double>(key(i0[i]));
+			double dx = x - x0;
+			double dy = static_cast<double>(i - y0);
+			if (dx <= 0.)
+				bFits = dy <= dEps;
+			else
+			{
+				double lo = std::max(dLo, (dy - dEps) / dx);
+				double hi = std::min(dHi, (dy + dEps) / dx);
+				if (lo <= hi)
+				{
+					dLo = lo;
+					dHi = hi;
+					bFits = true;
+				}
+			}
+		}
+		if (bFits) continue;
+
+		segment s;
+		s.slope = (dHi == dMax) ? 0. : (dLo + dHi) / 2;
+		s.pos = y0;
+		m_keys.push_back(x0);
+		m_segments.push_back(s);
+
+		x0 = x;
+		y0 = i;
+		dLo = 0.;
+		dHi = dMax;
+	}
+}
+
+inline size_t flat_search_learned::predict(double x) const
+{
+	std::vector<double>::const_iterator it = std::upper_bound(m_keys.begin(), m_keys.end(), x);
+	if (it == m_keys.begin()) return 0;
+	size_t s = static_cast<size_t>(it - m_keys.begin()) - 1;
+
+	// the prediction never leaves the positions covered by the segment
+	double dLast = static_cast<double>(s + 1 < m_segments.size() ? m_segments[s + 1].pos : m_nSize);
+	double p = static_cast<double>(m_segments[s].pos) + m_segments[s].slope * (x - m_keys[s]);
+	if (!(p > 0.)) return 0;
+	if (p > dLast) return static_cast<size_t>(dLast);
+	return static_cast<size_t>(p);
+}
+
+template<class It, class K, class KeyOf>
+inline It flat_search_learned::search(It i0, It i1, const K &k, KeyOf key, bool bUpper)
+{
+	size_t n = static_cast<size_t>(i1 - i0);
+	if (!m_bBuilt || m_nSize != n) build(i0, i1, key);
+	if (n == 0) return i1;
+
+	size_t p = predict(static_cast<double>(k));
+	size_t lo = p > m_nEpsilon ? p - m_nEpsilon : 0;
+	size_t hi = std::min(n, p + m_nEpsilon + 2);
+
+	// The model is exact only for stored keys, so the window is verified and
+	// the search falls back to the outer part of the range when it misses
+	It w0 = i0 + lo;
+	It w1 = i0 + hi;
+	if (lo > 0 && (bUpper ? k < key(w0[-1]) : !(key(w0[-1]) < k)))
+	{
+		w1 = w0 - 1;
+		w0 = i0;
+	}
+	else if (hi < n && (bUpper ? !(k < key(*w1)) : key(*w1) < k))
+	{
+		w0 = w1 + 1;
+		w1 = i1;
+	}
+	if (bUpper)
+		return std::upper_bound(w0, w1, k, flat_search_less_key<K, KeyOf>(key));
+	return std::lower_bound(w0, w1, k, flat_search_less_elem<K, KeyOf>(key));
+}
+
+template<class It, class K, class KeyOf>
+inline It flat_search_learned::lower_bound(It i0, It i1, const K &k, KeyOf key)
+{
+	return search(i0, i1, k, key, false);
+}
+
+template<class It, class K, class KeyOf>
+inline It flat_search_learned::upper_bound(It i0, It i1, const K &k, KeyOf key)
+{
+	return search(i0, i1, k, key, true);
+}
+
+template<class It, class K, class KeyOf>
+inline It flat_search_learned::find(It i0, It i1, const K &k, KeyOf key)
+{
+	It it = search(i0, i1, k, key, false);
+	if (it == i1 || k < key(*it))
+		return i1;
+	return it;
+}
+
+//------------------------------- flat_search_interpolation --------------------------------
+
+// Probes the position interpolated between the keys at the ends of the range.
+// A step that does not halve the range is a bad step, after nMaxBadSteps of
+// them (or once the range is small) the search continues as a binary search,
+// so skewed data costs at most a few extra probes. build() samples the keys and
+// when they are far from uniform every lookup is a plain binary search, which
+// keeps the top of the search tree in cache.
+// Keys must be convertible to double.
+class flat_search_interpolation
+{
+public:
+	flat_search_interpolation(size_t nMaxBadSteps = 2) : m_nMaxBadSteps(nMaxBadSteps), m_nSize(0), m_bBuilt(false), m_bSkewed(false) {};
+
+	void set_max_bad_steps(size_t nMaxBadSteps) { m_nMaxBadSteps = nMaxBadSteps; }
+	size_t max_bad_steps() const { return m_nMaxBadSteps; }
+	bool skewed() const { return m_bSkewed; }
+
+	template<class It, class KeyOf>
+	void build(It i0, It i1, KeyOf key);
+	void invalidate() { m_bBuilt = false; }
+
+	template<class It, class K, class KeyOf>
+	It lower_bound(It i0, It i1, const K &k, KeyOf key);
+	template<class It, class K, class KeyOf>
+	It upper_bound(It i0, It i1, const K &k, KeyOf key);
+	template<class It, class K, class KeyOf>
+	It find(It i0, It i1, const K &k, KeyOf key);
+
+	size_t memory_usage() const { return 0; }
+
+private:
+	template<class It, class K, class KeyOf>
+	It search(It i0, It i1, const K &k, KeyOf key, bool bUpper);
+
+	size_t m_nMaxBadSteps;
+	size_t m_nSize;
+	bool m_bBuilt;
+	bool m_bSkewed;
+};
+
+template<class It, class KeyOf>
+inline void flat_search_interpolation::build(It i0, It i1, KeyOf key)
+{
+	m_nSize = static_cast<size_t>(i1 - i0);
+	m_bBuilt = true;
+	m_bSkewed = false;
+	if (m_nSize < 64) return;
+
+	// the keys are skewed if a sampled position is more than n/16 away from
+	// the position interpolated between the first and the last key
+	const size_t nSamples = 64;
+	double x0 = static_cast<double>(key(i0[0]));
+	double xn = static_cast<double>(key(i0[m_nSize - 1]));
+	double dn = static_cast<double>(m_nSize - 1);
+	if (!(xn > x0)) return;
+	for (size_t i = 1; i < nSamples; i++)
+	{
+		size_t p = i * (m_nSize - 1) / nSamples;
+		double e = (static_cast<double>(key(i0[p])) - x0) / (xn - x0) * dn - static_cast<double>(p);
+		if (e < 0) e = -e;
+		if (e * 16 > dn)
+		{
+			m_bSkewed = true;
+			return;
+		}
+	}
+}
+
+template<class It, class K, class KeyOf>
+inline It flat_search_interpolation::search(It i0, It i1, const K &k, KeyOf key, bool bUpper)
+{
+	size_t n = static_cast<size_t>(i1 - i0);
+	if (!m_bBuilt || m_nSize != n) build(i0, i1, key);
+	if (m_bSkewed)
+	{
+		if (bUpper)
+			return std::upper_bound(i0, i1, k, flat_search_less_key<K, KeyOf>(key));
+		return std::lower_bound(i0, i1, k, flat_search_less_elem<K, KeyOf>(key));
+	}
+	if (n == 0) return i1;
+	if (bUpper ? k < key(i0[0]) : !(key(i0[0]) < k)) return i0;
+	if (bUpper ? !(k < key(i0[n - 1])) : key(i0[n - 1]) < k) return i1;
+
+	// the element at a precedes k, the one at b does not, the answer is in (a, b]
+	size_t a = 0;
+	size_t b = n - 1;
+	double xa = static_cast<double>(key(i0[a]));
+	double xb = static_cast<double>(key(i0[b]));
+	const double x = static_cast<double>(k);
+	size_t nBad = 0;
+	while (b - a > 16 && nBad < m_nMaxBadSteps)
+	{
+		double f = (xb > xa) ? (x - xa) / (xb - xa) : 0.5;
+		if (!(f > 0.)) f = 0.;
+		if (f > 1.) f = 1.;
+		size_t m = a + 1 + static_cast<size_t>(f * static_cast<double>(b - a - 2));
+
+		size_t nOld = b - a;
+		double xm = static_cast<double>(key(i0[m]));
+		if (bUpper ? !(k < key(i0[m])) : key(i0[m]) < k)
+		{
+			a = m;
+			xa = xm;
+		}
+		else
+		{
+			b = m;
+			xb = xm;
+		}
+		if ((b - a) * 2 > nOld) nBad++;
+	}
+	if (bUpper)
+		return std::upper_bound(i0 + a + 1, i0 + b, k, flat_search_less_key<K, KeyOf>(key));
+	return std::lower_bound(i0 + a + 1, i0 + b, k, flat_search_less_elem<K, KeyOf>(key));
+}
+
+template<class It, class K, class KeyOf>
+inline It flat_search_interpolation::lower_bound(It i0, It i1, const K &k, KeyOf key)
+{
+	return search(i0, i1, k, key, false);
+}
+
+template<class It, class K, class KeyOf>
+inline It flat_search_interpolation::upper_bound(It i0, It i1, const K &k, KeyOf key)
+{
+	return search(i0, i1, k, key, true);
+}
+
+template<class It, class K, class KeyOf>
+inline It flat_search_interpolation::find(It i0, It i1, const K &k, KeyOf key)
+{
+	It it = search(i0, i1, k, key, false);
+	if (it == i1 || k < key(*it))
+		return i1;
+	return it;
+}
+
+//---------------------------------- flat_search_hash --------------------------------------
+
+// Default hash of flat_search_hash: integers are mixed by the 64 bit finalizer
+// of MurmurHash3, strings are hashed by FNV-1a.
+struct flat_hash
+{
+	size_t operator() (unsigned long long v) const
+	{
+		v ^= v >> 33;
+		v *= 0xff51afd7ed558ccdULL;
+		v ^= v >> 33;
+		v *= 0xc4ceb9fe1a85ec53ULL;
+		v ^= v >> 33;
+		return static_cast<size_t>(v);
+	}
+	size_t operator() (long long v) const { return (*this)(static_cast<unsigned long long>(v)); }
+	size_t operator() (unsigned long v) const { return (*this)(static_cast<unsigned long long>(v)); }
+	size_t operator() (long v) const { return (*this)(static_cast<unsigned long long>(v)); }
+	size_t operator() (unsigned int v) const { return (*this)(static_cast<unsigned long long>(v)); }
+	size_t operator() (int v) const { return (*this)(static_cast<unsigned long long>(v)); }
+	size_t operator() (unsigned short v) const { return (*this)(static_cast<unsigned long long>(v)); }
+	size_t operator() (short v) const { return (*this)(static_cast<unsigned long long>(v)); }
+	size_t operator() (unsigned char v) const { return (*this)(static_cast<unsigned long long>(v)); }
+	size_t operator() (signed char v) const { return (*this)(static_cast<unsigned long long>(v)); }
+	size_t operator() (char v) const { return (*this)(static_cast<unsigned long long>(v)); }
+	size_t operator() (const std::string &s) const
+	{
+		unsigned long long h = 14695981039346656037ULL;
+		for (size_t i = 0; i < s.size(); i++)
+		{
+			h ^= static_cast<unsigned char>(s[i]);
+			h *= 1099511628211ULL;
+		}
+		return (*this)(h);
+	}
+};
+
+// Hash table of positions of the first element of every distinct key, used by
+// find() only, so ordered lookups keep the container's order. The table has a
+// power of two size with at most nMaxLoad / 100 of it occupied, so its memory
+// is about sizeof(size_t) * 100 / nMaxLoad bytes per distinct key.
+// Keys need == and a hash function object taking a key.
+template<class Hash = flat_hash>
+class flat_search_hash
+{
+public:
+	flat_search_hash(size_t nMaxLoad = 50, const Hash &hash = Hash()) : m_hash(hash), m_nMaxLoad(clamp_load(nMaxLoad)), m_nSize(0), m_bBuilt(false) {};
+
+	void set_max_load(size_t nMaxLoad);
+	size_t max_load() const { return m_nMaxLoad; }
+
+	template<class It, class KeyOf>
+	void build(It i0, It i1, KeyOf key);
+	void invalidate();
+
+	template<class It, class K, class KeyOf>
+	It lower_bound(It i0, It i1, const K &k, KeyOf key)
+	{
+		return std::lower_bound(i0, i1, k, flat_search_less_elem<K, KeyOf>(key));
+	}
+
+	template<class It, class K, class KeyOf>
+	It upper_bound(It i0, It i1, const K &k, KeyOf key)
+	{
+		return std::upper_bound(i0, i1, k, flat_search_less_key<K, KeyOf>(key));
+	}
+
+	template<class It, class K, class KeyOf>
+	It find(It i0, It i1, const K &k, KeyOf key);
+
+	size_t memory_usage() const { return m_table.capacity()*sizeof(size_t); }
+
+private:
+	static size_t clamp_load(size_t nMaxLoad) { return nMaxLoad < 10 ? 10 : (nMaxLoad > 90 ? 90 : nMaxLoad); }
+
+	Hash m_hash;
+	std::vector<size_t> m_table;	// position + 1, 0 is an empty cell
+	size_t m_nMaxLoad;				// percent
+	size_t m_nSize;
+	bool m_bBuilt;
+};
+
+template<class Hash>
+inline void flat_search_hash<Hash>::set_max_load(size_t nMaxLoad)
+{
+	m_nMaxLoad = clamp_load(nMaxLoad);
+	invalidate();
+}
+
+template<class Hash>
+inline void flat_search_hash<Hash>::invalidate()
+{
+	std::vector<size_t>().swap(m_table);
+	m_bBuilt = false;
+}
+
+template<class Hash>
+template<class It, class KeyOf>
+inline void flat_search_hash<Hash>::build(It i0, It i1, KeyOf key)
+{
+	m_nSize = static_cast<size_t>(i1 - i0);
+	m_bBuilt = true;
+
+	size_t nCells = 16;
+	while (nCells * m_nMaxLoad < m_nSize * 100)
+		nCells *= 2;
+	std::vector<size_t>(nCells, 0).swap(m_table);
+
+	size_t nMask = nCells - 1;
+	for (size_t i = 0; i < m_nSize; i++)
+	{
+		if (i > 0 && !(key(i0[i - 1]) < key(i0[i])))
+			continue;
+		size_t h = m_hash(key(i0[i])) & nMask;
+		while (m_table[h] != 0)
+			h = (h + 1) & nMask;
+		m_table[h] = i + 1;
+	}
+}
+
+template<class Hash>
+template<class It, class K, class KeyOf>
+inline It flat_search_hash<Hash>::find(It i0, It i1, const K &k, KeyOf key)
+{
+	if (!m_bBuilt || m_nSize != static_cast<size_t>(i1 - i0)) build(i0, i1, key);
+
+	size_t nMask = m_table.size() - 1;
+	for (size_t h = m_hash(k) & nMask; m_table[h] != 0; h = (h + 1) & nMask)
+	{
+		It it = i0 + (m_table[h] - 1);
+		if (key(*it) == k)
+			return it;
+	}
+	return i1;
+}
+
+//---------------------------------- flat_search_bloom -------------------------------------
+
+// Blocked Bloom filter in front of another policy. All bits of a key are in one
+// 64 byte block, so a miss costs one cache line instead of a full search.
+// find() asks the filter first, bounds go to the inner policy. The filter is
+// sized for the false positive rate given in the constructor. Erased keys stay
+// in the filter, they only raise the false positive rate until the next sort().
+// Keys need a hash function object returning 64 bits.
+template<class Inner = flat_search_binary, class Hash = flat_hash>
+class flat_search_bloom
+{
+public:
+	flat_search_bloom(double fFalsePositive = 0.01, const Inner &inner = Inner(), const Hash &hash = Hash())
+		: m_inner(inner), m_hash(hash), m_fFalsePositive(fFalsePositive), m_nHashes(0), m_bBuilt(false) {};
+
+	void set_false_positive_rate(double fFalsePositive) { m_fFalsePositive = fFalsePositive; m_bBuilt = false; }
+	double false_positive_rate() const { return m_fFalsePositive; }
+	Inner &inner() { return m_inner; }
+
+	template<class It, class KeyOf>
+	void build(It i0, It i1, KeyOf key);
+	void invalidate() { m_inner.invalidate(); }
+
+	template<class It, class K, class KeyOf>
+	It lower_bound(It i0, It i1, const K &k, KeyOf key) { return m_inner.lower_bound(i0, i1, k, key); }
+	template<class It, class K, class KeyOf>
+	It upper_bound(It i0, It i1, const K &k, KeyOf key) { return m_inner.upper_bound(i0, i1, k, key); }
+	template<class It, class K, class KeyOf>
+	It find(It i0, It i1, const K &k, KeyOf key)
+	{
+		if (!m_bBuilt) build(i0, i1, key);
+		if (!may_contain(k)) return i1;
+		return m_inner.find(i0, i1, k, key);
+	}
+
+	// false only for keys which are not in the container
+	template<class K>
+	bool may_contain(const K &k) const;
+
+	size_t memory_usage() const { return m_bits.capacity()*sizeof(unsigned long long) + m_inner.memory_usage(); }
+
+private:
+	enum { BLOCK_WORDS = 8, BLOCK_BITS = BLOCK_WORDS * 64 };
+
+	Inner m_inner;
+	Hash m_hash;
+	std::vector<unsigned long long> m_bits;
+	double m_fFalsePositive;
+	size_t m_nHashes;
+	bool m_bBuilt;
+};
+
+template<class Inner, class Hash>
+template<class It, class KeyOf>
+inline void flat_search_bloom<Inner, Hash>::build(It i0, It i1, KeyOf key)
+{
+	m_inner.build(i0, i1, key);
+
+	// bits per key and hash count of a classic Bloom filter, plus a fifth for blocking
+	double f = m_fFalsePositive;
+	if (!(f > 1e-9)) f = 1e-9;
+	if (f > 0.5) f = 0.5;
+	double fBitsPerKey = -std::log(f) / (std::log(2.) * std::log(2.)) * 1.2;
+	m_nHashes = static_cast<size_t>(fBitsPerKey / 1.2 * std::log(2.) + 0.5);
+	if (m_nHashes < 1) m_nHashes = 1;
+	if (m_nHashes > 16) m_nHashes = 16;
+
+	size_t n = static_cast<size_t>(i1 - i0);
+	size_t nBlocks = static_cast<size_t>(static_cast<double>(n) * fBitsPerKey / static_cast<double>(BLOCK_BITS)) + 1;
+	std::vector<unsigned long long>(nBlocks * BLOCK_WORDS, 0).swap(m_bits);
+
+	for (It it = i0; it != i1; ++it)
+	{
+		unsigned long long h = m_hash(key(*it));
+		unsigned long long *pBlock = &m_bits[0] + static_cast<size_t>(((h >> 32) * nBlocks) >> 32) * BLOCK_WORDS;
+		unsigned h1 = static_cast<unsigned>(h);
+		unsigned h2 = static_cast<unsigned>(h >> 32) | 1;
+		for (size_t i = 0; i < m_nHashes; i++, h1 += h2)
+			pBlock[(h1 % BLOCK_BITS) / 64] |= 1ULL << (h1 % 64);
+	}
+	m_bBuilt = true;
+}
+
+template<class Inner, class Hash>
+template<class K>
+inline bool flat_search_bloom<Inner, Hash>::may_contain(const K &k) const
+{
+	if (!m_bBuilt) return true;
+	size_t nBlocks = m_bits.size() / BLOCK_WORDS;
+	unsigned long long h = m_hash(k);
+	const unsigned long long *pBlock = &m_bits[0] + static_cast<size_t>(((h >> 32) * nBlocks) >> 32) * BLOCK_WORDS;
+	unsigned h1 = static_cast<unsigned>(h);
+	unsigned h2 = static_cast<unsigned>(h >> 32) | 1;
+	for (size_t i = 0; i < m_nHashes; i++, h1 += h2)
+		if (!(pBlock[(h1 % BLOCK_BITS) / 64] & (1ULL << (h1 % 64))))
+			return false;
+	return true;
+}
+
+#endif // _FLAT_SEARCH_H_INCLUDED_2026_10_19
@@ -1,6 +1,31 @@
 #include "flat_set.h"
 #include "flat_map.h"
+#include "flat_packed_set.h"
+#include "flat_roaring_set.h"
+#include "small_flat_map.h"
+#include "small_flat_set.h"
+#include "flat_string_map.h"
+#include "flat_blocked_map.h"
+#include "flat_aggregate_map.h"
+#include "flat_grouped_multimap.h"
+#include "flat_rle_multiset.h"
+#include "flat_static_map.h"
+#include "flat_huge_allocator.h"
+#include "flat_durable_map.h"
+#include "flat_trace.h"
+#if __cplusplus >= 201103L
+#include "flat_map_builder.h"
+#include "flat_numa.h"
+#include "flat_memory.h"
+#include "flat_async.h"
+#include "flat_parallel.h"
+#include "flat_versioned_map.h"
+#include <thread>
+#endif
 #include <stdio.h>
+#include <string>
+#include <functional>
+#include <stdexcept>
 
 /*
  * The MIT License (MIT)
@@ -183,8 +208,1486 @@ int flat_test()
 	TEST(set2.empty());
 	TEST(set22.size()==8);
 
-	//flat_multiset<int> set23(std::move(set22));
-	//TEST(set23.size() == 8);
+#ifdef ENABLE_MOVE_SEMANTICS
+	// moved-from containers are empty and sorted
+	flat_multiset<int> set23(std::move(set22));
+	TEST(set23.size() == 8 && set22.empty());
+	set22.insert(5);
+	TEST(set22.count(5) == 1);
+	flat_map<int, int> map4(std::move(map1));
+	TEST(map1.empty() && map1.find(1) == map1.end());
+	map1.insert(1, 1);
+	TEST(map1.size() == 1 && map4.size() > 0);
+	flat_set<int> set4(std::move(set1));
+	TEST(set1.empty() && set1.begin() == set1.end() && set4.size() > 0);
+#endif
+
+	// erasing an absent key from containers with pending inserts
+	flat_map<int, int> map3;
+	flat_set<int> set3;
+	map3.insert(2, 2);
+	map3.insert(1, 1);
+	set3.insert(2);
+	set3.insert(1);
+	map3.erase(3);
+	set3.erase(3);
+	TEST(map3.size() == 2 && set3.size() == 2);
+
+	return 0;
+}
+
+int flat_search_test()
+{
+	flat_set<unsigned> set0;
+	flat_set<unsigned, flat_search_learned> set1;
+	flat_multiset<unsigned, flat_search_learned> set2;
+	for (unsigned i = 0; i < 20000; i++)
+	{
+		unsigned v = (i * i) % 1000003 + (i % 7 == 0 ? 5000000 : 0);
+		set0.insert(v);
+		set1.insert(v);
+		set2.insert(v);
+		set2.insert(v);
+	}
+	set1.search().set_epsilon(8);
+	TEST(set1.size() == set0.size());
+	TEST(set1.search().segments() > 1);
+	TEST(set1.search().memory_usage() > 0);
+
+	bool bSame = true;
+	for (unsigned k = 0; k < 5100000; k += 997)
+	{
+		if (set1.lower_bound(k) - set1.begin() != set0.lower_bound(k) - set0.begin()) bSame = false;
+		if (set1.upper_bound(k) - set1.begin() != set0.upper_bound(k) - set0.begin()) bSame = false;
+		if (set1.count(k) != set0.count(k)) bSame = false;
+		if (set2.count(k) != 2 * set0.count(k)) bSame = false;
+	}
+	TEST(bSame);
+
+	flat_map<int, double, flat_search_learned> map1;
+	for (int i = 0; i < 1000; i++)
+		map1.insert(i * 3, i);
+	map1.insert(300, -1.);
+	TEST(map1.size() == 1000);
+	TEST(map1.find(300)->second == -1.);
+	TEST(map1.find(301) == map1.end());
+	map1.erase(map1.find(300));
+	TEST(map1.find(300) == map1.end());
+	TEST(map1.find(303)->second == 101.);
+	TEST(map1.lower_bound(-5) == map1.begin());
+	TEST(map1.upper_bound(5000) == map1.end());
+
+	flat_set<unsigned, flat_search_interpolation> set3;
+	flat_multiset<unsigned, flat_search_interpolation> set4;
+	for (flat_set<unsigned>::iterator it = set0.begin(); it != set0.end(); ++it)
+	{
+		set3.insert(*it);
+		set4.insert(*it);
+		set4.insert(*it);
+	}
+	bSame = true;
+	for (unsigned k = 0; k < 5100000; k += 997)
+	{
+		if (set3.lower_bound(k) - set3.begin() != set0.lower_bound(k) - set0.begin()) bSame = false;
+		if (set3.upper_bound(k) - set3.begin() != set0.upper_bound(k) - set0.begin()) bSame = false;
+		if (set3.count(k) != set0.count(k)) bSame = false;
+		if (set4.count(k) != 2 * set0.count(k)) bSame = false;
+	}
+	TEST(bSame);
+
+	flat_set<unsigned, flat_search_interpolation> set5;
+	flat_set<unsigned, flat_search_interpolation> set6;
+	for (unsigned i = 0; i < 2000; i++)
+	{
+		set5.insert(i * 5 + i % 3);
+		set6.insert(i * i * i);
+	}
+	TEST(set5.count(5 * 77 + 77 % 3) == 1);
+	TEST(set5.count(5 * 77 + 3) == 0);
+	TEST(*set5.lower_bound(5 * 77 + 3) == 5 * 78);
+	TEST(!set5.search().skewed());
+	TEST(set6.count(27000) == 1);
+	TEST(set6.search().skewed());
+
+	// numbers of another type find only keys equal to them
+	{
+		flat_set<int> set7;
+		flat_set<unsigned char> set8;
+		flat_set<unsigned> set9;
+		flat_set<float> set10;
+		for (int i = 0; i < 10; i++)
+		{
+			set7.insert(i * 5);
+			set8.insert(static_cast<unsigned char>(i * 22));
+			set9.insert(static_cast<unsigned>(i) - 5u);
+			set10.insert(i * 0.5f);
+		}
+		TEST(set7.find(5.0) != set7.end() && set7.find(5.5) == set7.end() && set7.find(4294967296LL) == set7.end());
+		TEST(set7.find(1e30) == set7.end() && set7.find(-1e30) == set7.end() && set7.find(45ULL) != set7.end());
+		TEST(set8.find(44) != set8.end() && set8.find(300) == set8.end() && set8.find(-212) == set8.end());
+		TEST(set9.find(3) != set9.end() && set9.find(-1) == set9.end() && set9.count(4294967295LL) == 1);
+		TEST(set10.find(1.5) != set10.end() && set10.find(1.25) == set10.end() && set10.find(1e300) == set10.end() && set10.find(2) != set10.end());
+		flat_map<unsigned, int, flat_search_hash<> > map2;
+		for (unsigned i = 0; i < 100; i++)
+			map2.insert(i * 3, static_cast<int>(i));
+		map2.insert(4294967295u, -1);
+		TEST(map2.find(30)->second == 10 && map2.find(31) == map2.end() && map2.find(-1) == map2.end());
+		TEST(map2.find(4294967295LL)->second == -1 && map2.find(30.5) == map2.end());
+	}
+
+	flat_map<int, int, flat_search_hash<> > map2;
+	flat_multimap<int, int, flat_search_hash<> > map3;
+	for (int i = 0; i < 5000; i++)
+	{
+		map2.insert(i * 2, i);
+		map3.insert(i % 100, i);
+	}
+	TEST(map2.find(20)->second == 10);
+	TEST(map2.find(5001) == map2.end() && map2.count(-1) == 0);
+	TEST(map2.lower_bound(5001)->first == 5002 && map2.upper_bound(5002)->first == 5004);
+	TEST(map3.find(42) == map3.lower_bound(42) && map3.count(42) == 50);
+	size_t nMem = map2.search().memory_usage();
+	map2.erase(map2.find(70));
+	TEST(map2.find(70) == map2.end() && map2.find(72)->second == 36);
+	map2.insert(70, -10);
+	TEST(map2.find(70)->second == -10);
+	map2.search().set_max_load(90);
+	TEST(map2.find(72)->second == 36);
+	TEST(map2.search().memory_usage() < nMem);
+
+	flat_map<std::string, int, flat_search_hash<> > map4;
+	map4.insert("one", 1);
+	map4.insert("two", 2);
+	map4.insert("three", 3);
+	TEST(map4.find("two")->second == 2 && map4.find("four") == map4.end());
+
+	flat_set<unsigned, flat_search_bloom<> > set7;
+	flat_map<unsigned, int, flat_search_bloom<flat_search_hash<> > > map5;
+	for (unsigned i = 0; i < 20000; i++)
+	{
+		set7.insert(i * 2);
+		map5.insert(i * 2, i);
+	}
+	size_t nPositive = 0;
+	bSame = true;
+	for (unsigned i = 0; i < 40000; i++)
+	{
+		if (set7.count(i) != 1 - i % 2) bSame = false;
+		if (map5.count(i) != 1 - i % 2) bSame = false;
+		if (i % 2 == 1 && set7.search().may_contain(i)) nPositive++;
+	}
+	TEST(bSame);
+	TEST(nPositive < 20000 * 3 / 100);
+	TEST(set7.search().memory_usage() < 20000 * 2);
+	set7.erase(set7.find(100u));
+	TEST(set7.count(100u) == 0 && set7.count(102u) == 1);
+	set7.search().set_false_positive_rate(0.001);
+	TEST(set7.count(102u) == 1 && set7.search().memory_usage() > 20000 * 2);
+	set7.insert(101);
+	TEST(set7.count(101u) == 1 && map5.find(1000u)->second == 500);
+
+	return 0;
+}
+
+int flat_packed_test()
+{
+	flat_packed_set<unsigned long long> set1;
+	flat_set<unsigned long long> set0;
+	for (unsigned long long i = 0; i < 100000; i++)
+	{
+		unsigned long long v = 1000000000000ULL + i * 3 + (i * 7) % 5;
+		set1.insert(v);
+		set0.insert(v);
+		if (i % 10 == 0) set1.insert(v);
+	}
+	TEST(set1.size() == set0.size());
+	TEST(set1.memory_usage() * 4 < set0.size() * sizeof(unsigned long long));
+
+	bool bSame = true;
+	flat_packed_set<unsigned long long>::iterator it1 = set1.begin();
+	for (flat_set<unsigned long long>::iterator it0 = set0.begin(); it0 != set0.end(); ++it0, ++it1)
+		if (it1 == set1.end() || *it0 != *it1) bSame = false;
+	TEST(bSame && it1 == set1.end());
+
+	for (unsigned long long k = 999999999990ULL; k < 1000000000000ULL + 300010; k += 17)
+	{
+		if (set1.count(k) != set0.count(k)) bSame = false;
+		flat_packed_set<unsigned long long>::iterator itl = set1.lower_bound(k);
+		flat_set<unsigned long long>::iterator it0 = set0.lower_bound(k);
+		if ((itl == set1.end()) != (it0 == set0.end()) || (it0 != set0.end() && *itl != *it0)) bSame = false;
+	}
+	TEST(bSame);
+
+	set1.erase(1000000000000ULL);
+	TEST(set1.count(1000000000000ULL) == 0);
+	TEST(*set1.begin() == 1000000000000ULL + 5);
+	TEST(set1.size() == set0.size() - 1);
+
+	flat_packed_multiset<int> set2;
+	set2.insert(-5);
+	for (int i = 0; i < 300; i++)
+		set2.insert(7);
+	set2.insert(100);
+	set2.insert(-5);
+	TEST(set2.size() == 303);
+	TEST(set2.count(7) == 300);
+	TEST(set2.count(-5) == 2);
+	TEST(*set2.upper_bound(7) == 100);
+	set2.erase(7);
+	TEST(set2.size() == 3);
+	TEST(set2.find(7) == set2.end());
+
+	return 0;
+}
+
+int flat_roaring_test()
+{
+	flat_roaring_set set1;
+	flat_set<unsigned> set0;
+	for (unsigned i = 0; i < 200000; i++)
+	{
+		unsigned v = (i < 100000) ? i * 3 : 0x70000000u + (i * 2654435761u) % 5000000u;
+		set1.insert(v);
+		set0.insert(v);
+	}
+	for (unsigned i = 0; i < 70000; i++)
+		set1.insert(0x10000u * 7 + i); // dense chunks turn into runs in sort()
+	for (unsigned i = 0; i < 70000; i++)
+		set0.insert(0x10000u * 7 + i);
+	TEST(set1.size() == set0.size());
+
+	size_t nMem = set1.memory_usage();
+	set1.sort();
+	TEST(set1.memory_usage() < nMem);
+
+	bool bSame = true;
+	flat_roaring_set::iterator it1 = set1.begin();
+	for (flat_set<unsigned>::iterator it0 = set0.begin(); it0 != set0.end(); ++it0, ++it1)
+		if (it1 == set1.end() || *it0 != *it1) bSame = false;
+	TEST(bSame && it1 == set1.end());
+	for (unsigned k = 0; k < 400000; k += 7)
+		if (set1.count(k) != set0.count(k) || *set1.lower_bound(k) != *set0.lower_bound(k)) bSame = false;
+	TEST(bSame);
+
+	set1.erase(0x10000u * 7 + 5);
+	set1.erase(300);
+	TEST(set1.count(0x10000u * 7 + 5) == 0);
+	TEST(set1.count(0x10000u * 7 + 6) == 1);
+	TEST(*set1.upper_bound(297) == 303);
+	TEST(set1.size() == set0.size() - 2);
+
+	flat_roaring_set set2;
+	for (unsigned i = 0; i < 1000; i++)
+		set2.insert(i * 2);
+	flat_roaring_set set3;
+	for (unsigned i = 0; i < 1000; i++)
+		set3.insert(i * 3);
+	flat_roaring_set set4(set2);
+	set4.intersect(set3);
+	TEST(set4.size() == 334);
+	TEST(set4.count(6) == 1 && set4.count(4) == 0);
+	set4 = set2;
+	set4.unite(set3);
+	TEST(set4.size() == 1000 + 1000 - 334);
+	set4.subtract(set3);
+	TEST(set4.size() == 1000 - 334);
+	TEST(set4.count(4) == 1 && set4.count(6) == 0);
+	set4.intersect(flat_roaring_set());
+	TEST(set4.empty() && set4.begin() == set4.end());
+
+	return 0;
+}
+
+// no default constructor, counts the live objects
+struct flat_test_counted
+{
+	explicit flat_test_counted(int n) : n(n) { nLive++; }
+	flat_test_counted(const flat_test_counted &rhs) : n(rhs.n) { nLive++; }
+	~flat_test_counted() { nLive--; }
+	flat_test_counted &operator=(const flat_test_counted &rhs) { n = rhs.n; return *this; }
+	bool operator< (const flat_test_counted &rhs) const { return n < rhs.n; }
+	bool operator== (const flat_test_counted &rhs) const { return n == rhs.n; }
+	int n;
+	static int nLive;
+};
+int flat_test_counted::nLive = 0;
+
+int flat_small_test()
+{
+	small_flat_map<int, std::string, 4> map1;
+	map1.insert(3, "c");
+	map1.insert(1, "a");
+	map1.insert(2, "b");
+	map1.insert(1, "A"); // replaces the value in place
+	TEST(map1.is_inline());
+	TEST(map1.size() == 3);
+	TEST(map1.find(1)->second == "A");
+	TEST(map1.begin()->first == 1 && (map1.end() - 1)->first == 3);
+	TEST(map1.count(4) == 0);
+
+	for (int i = 10; i > 0; i--)
+		map1.insert(i, "x");
+	TEST(!map1.is_inline());
+	TEST(map1.size() == 10);
+	TEST(map1.find(1)->second == "x");
+	TEST(map1.lower_bound(0)->first == 1 && map1.upper_bound(10) == map1.end());
+	map1.erase(5);
+	map1.erase(50);
+	TEST(map1.size() == 9 && map1.count(5) == 0);
+
+	small_flat_map<int, std::string, 4> map2;
+	map2.insert(7, "g");
+	map2.swap(map1);
+	TEST(map1.is_inline() && map1.size() == 1 && map1.begin()->second == "g");
+	TEST(map2.size() == 9);
+	map2.clear();
+	TEST(map2.is_inline() && map2.empty());
+
+	small_flat_set<int, 8> set1;
+	for (int i = 0; i < 8; i++)
+		set1.insert((i * 5) % 8);
+	set1.insert(3);
+	TEST(set1.is_inline() && set1.size() == 8);
+	bool bSorted = true;
+	for (small_flat_set<int, 8>::iterator it = set1.begin(); it != set1.end(); ++it)
+		if (*it != it - set1.begin()) bSorted = false;
+	TEST(bSorted);
+	set1.erase(set1.find(0));
+	set1.insert(-1);
+	set1.insert(100);
+	TEST(!set1.is_inline() && set1.size() == 9);
+	TEST(*set1.begin() == -1 && *set1.upper_bound(7) == 100);
+	set1.erase(-1);
+	set1.erase(100);
+	TEST(set1.size() == 7 && set1.equal_range(4).second - set1.equal_range(4).first == 1);
+
+	// an empty heap: reserved before the first insert, or emptied after a spill
+	small_flat_map<int, int, 4> map3;
+	map3.reserve(100);
+	TEST(!map3.is_inline() && map3.find(3) == map3.end() && map3.begin() == map3.end());
+	map3.insert(3, 30);
+	TEST(map3.find(3)->second == 30);
+	set1.erase(set1.begin(), set1.end());
+	TEST(!set1.is_inline() && set1.size() == 0 && set1.find(4) == set1.end() && set1.count(4) == 0);
+	set1.insert(4);
+	TEST(set1.size() == 1 && *set1.begin() == 4);
+
+	// elements are constructed only when inserted and destroyed when removed
+	{
+		small_flat_map<flat_test_counted, flat_test_counted, 4> map4;
+		TEST(flat_test_counted::nLive == 0);
+		for (int i = 3; i > 0; i--)
+			map4.insert(flat_test_counted(i), flat_test_counted(i * 10));
+		TEST(map4.is_inline() && flat_test_counted::nLive == 6 && map4.find(flat_test_counted(1))->second.n == 10);
+		small_flat_map<flat_test_counted, flat_test_counted, 4> map5(map4);
+		map5.insert(flat_test_counted(7), flat_test_counted(70));
+		map5.insert(flat_test_counted(0), flat_test_counted(0));
+		map5.insert(flat_test_counted(8), flat_test_counted(80));
+		TEST(!map5.is_inline() && map5.size() == 6 && flat_test_counted::nLive == 18);
+		map4.swap(map5);
+		TEST(map4.size() == 6 && map5.size() == 3 && map5.is_inline() && map5.begin()->first.n == 1);
+		small_flat_set<flat_test_counted, 4> set5;
+		set5.insert(flat_test_counted(2));
+		set5.insert(flat_test_counted(1));
+		small_flat_set<flat_test_counted, 4> set6;
+		set6.insert(flat_test_counted(5));
+		set6.swap(set5);
+		TEST(set6.size() == 2 && set5.size() == 1 && set5.begin()->n == 5 && set6.begin()->n == 1);
+		set5 = set6;
+		set6.erase(flat_test_counted(1));
+		TEST(set5.size() == 2 && set6.size() == 1 && set6.begin()->n == 2);
+		map5.erase(flat_test_counted(2));
+		map5.clear();
+		TEST(map5.size() == 0 && flat_test_counted::nLive == 12 + 3);
+	}
+	TEST(flat_test_counted::nLive == 0);
+
+	return 0;
+}
+
+int flat_string_test()
+{
+	flat_string_map<int> map1;
+	flat_map<std::string, int> map0;
+	const char *hosts[] = { "http://example.com/", "http://example.org/", "a", "" };
+	for (int i = 0; i < 3000; i++)
+	{
+		char buf[64];
+		sprintf(buf, "%s%d", hosts[i % 4], i / 4);
+		map1.insert(buf, i);
+		map0.insert(buf, i);
+	}
+	map1.insert(std::string("ab\0", 3), 1);
+	map1.insert("ab", 2, 2);
+	map0.insert(std::string("ab\0", 3), 1);
+	map0.insert("ab", 2);
+	TEST(map1.size() == map0.size());
+
+	bool bSame = true;
+	flat_string_map<int>::iterator it1 = map1.begin();
+	for (flat_map<std::string, int>::iterator it0 = map0.begin(); it0 != map0.end(); ++it0, ++it1)
+		if (it1 == map1.end() || it1.key() != it0->first || it1.value() != it0->second) bSame = false;
+	TEST(bSame && it1 == map1.end());
+	TEST(map1.find("ab", 2).value() == 2 && map1.find(std::string("ab\0", 3)).value() == 1);
+	TEST(map1.count("http://example.com/", 19) == 0 && map1.count(std::string("a15")) == 1);
+	TEST(map1.lower_bound(std::string("http://example.com/")).key() == "http://example.com/0");
+	TEST(map1.upper_bound(std::string("a999")).key() == "ab");
+
+	size_t nMem = map1.memory_usage();
+	for (int i = 0; i < 1000; i++)
+		map1.erase(std::string("http://example.org/") + std::string(1, static_cast<char>('0' + i % 10)));
+	map1.insert(std::string("a15"), -1);
+	TEST(map1.find(std::string("a15")).value() == -1);
+	TEST(map1.find(std::string("http://example.org/3")) == map1.end());
+	TEST(map1.size() == map0.size() - 10);
+	TEST(map1.memory_usage() < nMem);
+	TEST(map1.memory_usage() >= map1.size() * (sizeof(unsigned long long) + 2 * sizeof(size_t) + sizeof(int)));
+
+	// keys taken from the arena itself stay valid while the arena grows
+	flat_string_map<int> map2;
+	map2.insert(std::string("key of an element"), 1);
+	for (int i = 0; i < 20; i++)
+	{
+		flat_string_map<int>::iterator it2 = map2.find(std::string("key of an element"));
+		map2.insert(it2.key_data(), it2.key_size() - i % 4, i);
+	}
+	TEST(map2.size() == 4 && map2.find(std::string("key of an element")).value() == 16);
+	TEST(map2.find(std::string("key of an elem")).value() == 19);
+#if __cplusplus >= 201703L
+	TEST(map1.find(std::string_view("a15")).key_view() == "a15");
+#endif
+
+	return 0;
+}
+
+int flat_blocked_test()
+{
+	flat_blocked_map<int, int, 16> map1;
+	flat_map<int, int> map0;
+	unsigned r = 1;
+	for (int i = 0; i < 20000; i++)
+	{
+		r = r * 1103515245 + 12345;
+		int k = static_cast<int>((r >> 8) % 3000);
+		if (i % 3 == 2)
+		{
+			map1.erase(k);
+			flat_map<int, int>::iterator it = map0.find(k);
+			if (it != map0.end()) map0.erase(it);
+		}
+		else
+		{
+			map1.insert(k, i);
+			map0.insert(k, i);
+		}
+	}
+	TEST(map1.size() == map0.size());
+	TEST(map1.chunks() > map1.size() / 16);
+
+	bool bSame = true;
+	flat_blocked_map<int, int, 16>::iterator it1 = map1.begin();
+	for (flat_map<int, int>::iterator it0 = map0.begin(); it0 != map0.end(); ++it0, ++it1)
+		if (it1 == map1.end() || *it0 != *it1) bSame = false;
+	TEST(bSame && it1 == map1.end());
+	for (int k = -1; k <= 3000; k++)
+	{
+		if (map1.count(k) != map0.count(k)) bSame = false;
+		if (map1.lower_bound(k) != map1.end() && map1.lower_bound(k)->first != map0.lower_bound(k)->first) bSame = false;
+		if (map1.upper_bound(k) == map1.end() ? map0.upper_bound(k) != map0.end() : map1.upper_bound(k)->first != map0.upper_bound(k)->first) bSame = false;
+	}
+	TEST(bSame);
+
+	// erasing every other element merges chunks
+	size_t nChunks = map1.chunks();
+	for (flat_blocked_map<int, int, 16>::iterator it = map1.begin(); it != map1.end(); )
+	{
+		it = map1.erase(it);
+		if (it != map1.end()) ++it;
+	}
+	TEST(map1.size() == map0.size() / 2);
+	TEST(map1.chunks() < nChunks);
+	it1 = map1.end();
+	--it1;
+	TEST(it1->first == (map0.end() - (map0.size() % 2 ? 2 : 1))->first);
+	map1.erase(map1.begin(), map1.end());
+	TEST(map1.empty() && map1.chunks() == 0 && map1.begin() == map1.end());
+
+	return 0;
+}
+
+#if __cplusplus >= 201103L
+struct flat_test_no_default
+{
+	explicit flat_test_no_default(int n) : n(n) {}
+	int n;
+};
+
+int flat_builder_test()
+{
+	const size_t nProducers = 8;
+	flat_map_builder<int, int> builder(nProducers);
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < nProducers; t++)
+		threads.push_back(std::thread([&builder, t]()
+		{
+			for (int i = 0; i < 10000; i++)
+				builder.insert(t, (i * 7919 + static_cast<int>(t) * 13) % 20000, static_cast<int>(t) * 100000 + i);
+		}));
+	for (size_t t = 0; t < nProducers; t++)
+		threads[t].join();
+
+	// the same elements inserted one by one in producer order
+	flat_map<int, int> map0, map1;
+	flat_multimap<int, int> map2;
+	for (size_t t = 0; t < nProducers; t++)
+		for (size_t i = 0; i < builder.buffer(t).size(); i++)
+		{
+			map0.insert(builder.buffer(t)[i]);
+			map1.insert(builder.buffer(t)[i]);
+			map2.insert(builder.buffer(t)[i]);
+		}
+	map1.sort(true);
+	flat_map_builder<int, int> builder1(builder), builder2(builder);
+
+	flat_map<int, int> map3, map4;
+	flat_multimap<int, int> map5;
+	builder.build(map3, false, 4);
+	builder1.build(map4, true, 3);
+	builder2.build(map5);
+	TEST(builder.buffer(0).empty());
+	TEST(map3.size() == map0.size() && std::equal(map3.begin(), map3.end(), map0.begin()));
+	TEST(map4.size() == map1.size() && std::equal(map4.begin(), map4.end(), map1.begin()));
+	TEST(map5.size() == nProducers * 10000);
+	bool bSame = true;
+	for (flat_multimap<int, int>::iterator it = map5.begin(); it != map5.end(); ++it)
+		if (map2.count(it->first) != map5.count(it->first) || (it != map5.begin() && it->first < (it - 1)->first)) bSame = false;
+	TEST(bSame);
+
+	flat_map_builder<int, int> builder3(3);
+	builder3.build(map3);
+	TEST(map3.empty());
+
+	// values without a default constructor
+	flat_map_builder<int, flat_test_no_default> builder4(2);
+	for (int i = 0; i < 1000; i++)
+		builder4.insert(i % 2, i % 300, flat_test_no_default(i));
+	flat_map<int, flat_test_no_default> map6;
+	builder4.build(map6, false, 2);
+	TEST(map6.size() == 300 && map6.find(7)->second.n == 907 && builder4.buffer(1).empty());
+
+	return 0;
+}
+#endif
+
+struct flat_concat
+{
+	std::string identity() const { return std::string(); }
+	std::string operator() (const std::string& a, const std::string& b) const { return a + b; }
+};
+
+int flat_aggregate_test()
+{
+	flat_aggregate_map<int, double> map1;
+	flat_aggregate_map<int, double, flat_min<double> > map2;
+	flat_aggregate_map<int, int, flat_max<int> > map3;
+	for (int i = 0; i < 1000; i++)
+	{
+		map1.insert(i * 10, i);
+		map2.insert(i * 10, (i * 37) % 101);
+		map3.insert(i * 10, -((i * 37) % 101));
+	}
+	map1.insert(500, 0.5); // replaces 50
+	TEST(map1.aggregate(0, 9990) == 999. * 1000 / 2 - 50 + 0.5);
+	TEST(map1.aggregate(15, 45) == 2 + 3 + 4);
+	TEST(map1.aggregate(45, 15) == 0 && map1.aggregate(11, 19) == 0);
+	TEST(map1.count(15, 45) == 3 && map1.count(-100, 100000) == 1000);
+	TEST(map1.memory_usage() >= 2000 * sizeof(double));
+
+	bool bSame = true;
+	for (int a = 0; a < 10000; a += 373)
+		for (int b = a; b < 10000; b += 1511)
+		{
+			double vMin = 1e300;
+			int vMax = -1000000;
+			for (int i = (a + 9) / 10; i * 10 <= b; i++)
+			{
+				vMin = std::min(vMin, static_cast<double>((i * 37) % 101));
+				vMax = std::max(vMax, -((i * 37) % 101));
+			}
+			if (map2.aggregate(a, b) != (vMin == 1e300 ? std::numeric_limits<double>::infinity() : vMin)) bSame = false;
+			if (map3.aggregate(a, b) != (vMax == -1000000 ? std::numeric_limits<int>::min() : vMax)) bSame = false;
+		}
+	TEST(bSame);
+
+	map1.set_value(map1.find(20), 100.);
+	TEST(map1.aggregate(15, 25) == 100.);
+	map1.erase(20);
+	map1.erase(map1.find(30));
+	TEST(map1.aggregate(15, 45) == 4.);
+	map1.insert(25, 1.);
+	TEST(map1.aggregate(15, 45) == 5.);
+
+	flat_aggregate_map<int, int> map5;
+	for (int i = 0; i < 10; i++)
+		map5.insert(i, 1);
+	TEST(map5.aggregate(0, 9) == 10);
+	std::vector<std::pair<int, int> > ar5;
+	for (int i = 0; i < 10; i++)
+		ar5.push_back(std::make_pair(i, 5));
+	map5.adopt_sorted(ar5);
+	TEST(map5.aggregate(0, 9) == 50 && map5.first_k(3).second->first == 3 && map5.nth_key(9) == 9);
+
+	flat_aggregate_map<int, std::string, flat_concat> map4;
+	map4.insert(3, "c");
+	map4.insert(1, "a");
+	map4.insert(2, "b");
+	map4.insert(4, "d");
+	map4.insert(5, "e");
+	TEST(map4.aggregate(1, 5) == "abcde" && map4.aggregate(2, 4) == "bcd");
+
+	return 0;
+}
+
+int flat_grouped_test()
+{
+	flat_grouped_multimap<int, int> map1;
+	flat_multimap<int, int> map0;
+	for (int i = 0; i < 5000; i++)
+	{
+		map1.insert(i % 97, i);
+		map0.insert(i % 97, i);
+	}
+	TEST(map1.size() == 5000 && map1.groups() == 97);
+	for (int i = 5000; i < 6000; i++)
+	{
+		map1.insert((i * 31) % 200, i);
+		map0.insert((i * 31) % 200, i);
+	}
+	TEST(map1.size() == 6000 && map1.groups() == 200);
+
+	bool bSame = true;
+	for (int k = -1; k <= 200; k++)
+	{
+		if (map1.count(k) != map0.count(k)) bSame = false;
+		flat_grouped_multimap<int, int>::value_range r = map1.equal_range(k);
+		for (flat_grouped_multimap<int, int>::value_iterator it = r.first; it != r.second; ++it)
+			if (it != r.first && !(*(it - 1) < *it)) bSame = false; // insertion order
+	}
+	TEST(bSame);
+	TEST(*map1.equal_range(5).first == 5 && *(map1.equal_range(5).second - 1) >= 5000);
+
+	flat_grouped_multimap<int, int>::iterator it = map1.lower_bound(150);
+	TEST(it.key() == 150 && it.size() == map0.count(150));
+	TEST(map1.upper_bound(199) == map1.end() && map1.find(200) == map1.end());
+	it = map1.erase(it);
+	TEST(it.key() == 151 && map1.count(150) == 0);
+	map1.erase(3);
+	TEST(map1.size() == 6000 - map0.count(150) - map0.count(3) && map1.groups() == 198);
+	TEST(map1.begin().key() == 0 && (map1.begin() + 3).key() == 4);
+	TEST(map1.memory_usage() < 6000 * sizeof(std::pair<int, int>));
+
+	return 0;
+}
+
+int flat_rle_test()
+{
+	flat_rle_multiset<int> set1;
+	flat_multiset<int> set0;
+	for (int i = 0; i < 100000; i++)
+	{
+		int v = (i / 7) % 50 + ((i % 1000 == 0) ? 1000 + i : 0);
+		set1.insert(v);
+		set0.insert(v);
+	}
+	TEST(set1.size() == 100000);
+	TEST(set1.distinct() == 150);
+	TEST(set1.memory_usage() < 1024 * sizeof(std::pair<int, size_t>));
+
+	bool bSame = true;
+	flat_rle_multiset<int>::iterator it1 = set1.begin();
+	for (flat_multiset<int>::iterator it0 = set0.begin(); it0 != set0.end(); ++it0, ++it1)
+		if (it1 == set1.end() || *it0 != *it1) bSame = false;
+	TEST(bSame && it1 == set1.end());
+	for (int v = -1; v < 101000; v += 13)
+		if (set1.count(v) != set0.count(v)) bSame = false;
+	TEST(bSame);
+
+	TEST(set1.erase(7) == set0.count(7));
+	TEST(set1.count(7) == 0 && set1.find(7) == set1.end());
+	TEST(*set1.lower_bound(7) == 8 && *set1.upper_bound(6) == 8);
+	TEST(set1.erase(8, 3) == 3 && set1.count(8) == set0.count(8) - 3);
+	TEST(set1.size() == 100000 - set0.count(7) - 3);
+	TEST(std::distance(set1.equal_range(8).first, set1.equal_range(8).second) == static_cast<ptrdiff_t>(set0.count(8) - 3));
+	set1.insert(7, 5);
+	set1.insert(-5);
+	TEST(set1.count(7) == 5 && *set1.begin() == -5);
+	TEST(set1.distinct() == 151);
+	set1.erase(-5);
+	set1.erase(0);
+	TEST(*set1.begin() == 1 && set1.begin().run_left() == set0.count(1));
+
+	return 0;
+}
+
+#if __cplusplus >= 201402L
+int flat_static_test()
+{
+	static constexpr auto map1 = make_flat_static_map<int, const char*>({ { 3, "three" }, { 1, "one" }, { 2, "two" }, { 1, "uno" }, { 5, "five" } });
+	static_assert(map1.size() == 4, "duplicates are removed at compile time");
+	static_assert(map1.find(1)->second[0] == 'u', "the last value wins");
+	static_assert(map1.count(4) == 0 && map1.find(4) == map1.end(), "");
+	static_assert(map1.lower_bound(4)->first == 5 && map1.upper_bound(5) == map1.end(), "");
+	static_assert(map1.begin()->first == 1 && (map1.end() - 1)->first == 5, "");
+
+	static constexpr auto set1 = make_flat_static_set<unsigned>({ 7u, 3u, 9u, 3u, 1u });
+	static_assert(set1.size() == 4 && set1.count(3) == 1 && set1.count(4) == 0, "");
+	static_assert(*set1.lower_bound(4) == 7 && set1.upper_bound(9) == set1.end(), "");
+
+	// run time lookups of the same tables
+	int k = 2;
+	TEST(map1.find(k) != map1.end() && map1.find(k)->second[1] == 'w');
+	TEST(map1.find(k + 2) == map1.end());
+	unsigned nSum = 0;
+	for (flat_static_set<unsigned, 5>::const_iterator it = set1.begin(); it != set1.end(); ++it)
+		nSum = nSum * 10 + *it;
+	TEST(nSum == 1379);
+
+	return 0;
+}
+#endif
+
+int flat_huge_test()
+{
+	typedef flat_set<unsigned, flat_search_binary, flat_huge_allocator<unsigned> > huge_set;
+	typedef flat_map<unsigned, unsigned, flat_search_binary, flat_huge_allocator<std::pair<unsigned, unsigned> > > huge_map;
+
+	// 1M keys inserted in a scrambled order, the buffers are mapped 2MB aligned
+	huge_set set1;
+	huge_map map1;
+	set1.reserve(1 << 20);
+	map1.reserve(1 << 20);
+	for (unsigned i = 0; i < (1u << 20); i++)
+	{
+		unsigned k = (i * 2654435761u) & ((1u << 20) - 1);
+		set1.insert(k * 2);
+		map1.insert(k * 2, i);
+		map1.insert(k * 2, i + 1);
+	}
+	TEST(set1.size() == (1u << 20) && map1.size() == (1u << 20));
+	TEST((reinterpret_cast<size_t>(&*set1.begin()) & (flat_huge_allocator<unsigned>::huge_page_size - 1)) == 0);
+	bool bOk = true;
+	for (unsigned k = 0; k < (1u << 21); k += 1023)
+	{
+		if (set1.count(k) != 1 - k % 2) bOk = false;
+		if ((set1.find(static_cast<size_t>(k)) != set1.end()) != (k % 2 == 0)) bOk = false;
+	}
+	TEST(bOk);
+	huge_map::iterator it = map1.find(((12345u * 2654435761u) & ((1u << 20) - 1)) * 2);
+	TEST(it != map1.end() && it->second == 12346);
+	TEST(map1.find(static_cast<size_t>(7)) == map1.end() && map1.find(static_cast<size_t>(8))->first == 8);
+	huge_set set2;
+	set2.swap(set1);
+	TEST(set1.size() == 0 && set2.size() == (1u << 20));
+
+#if __cplusplus >= 201103L
+	flat_map_builder<unsigned, unsigned> builder(2);
+	builder.insert(0, 5u, 1u);
+	builder.insert(1, 5u, 2u);
+	builder.insert(1, 3u, 3u);
+	huge_map map2;
+	builder.build(map2);
+	TEST(map2.size() == 2 && map2.find(5u)->second == 2 && map2.begin()->first == 3);
+#endif
+
+#ifdef FLAT_TEST_HUGE
+	// more than 2^31 elements: the set needs 2GB, the map 4GB plus 4GB of stable sort buffer.
+	// The set case has been run on its own (-O2, about 90s on 6GB). The map case and the
+	// 8.5GB find case have not been run anywhere, they need more memory than was at hand.
+	const size_t nHuge = (static_cast<size_t>(1) << 31) + 1000;
+	{
+		flat_set<unsigned char, flat_search_binary, flat_huge_allocator<unsigned char> > set3;
+		set3.reserve(nHuge);
+		for (size_t i = 0; i < nHuge; i++)
+			set3.insert(static_cast<unsigned char>(i % 251));
+		TEST(set3.capacity() >= nHuge);
+		set3.sort();
+		TEST(set3.size() == 251 && set3.find(250) != set3.end());
+	}
+	{
+		flat_map<unsigned char, unsigned char, flat_search_binary, flat_huge_allocator<std::pair<unsigned char, unsigned char> > > map3;
+		map3.reserve(nHuge);
+		for (size_t i = 0; i < nHuge; i++)
+			map3.insert(static_cast<unsigned char>(i % 251), static_cast<unsigned char>(i >> 31));
+		map3.sort();
+		TEST(map3.size() == 251 && map3.find(17)->second == 1);
+	}
+	{
+		// needs about 8.5GB: keys beyond the 2^31 index range of an int
+		flat_set<unsigned, flat_search_binary, flat_huge_allocator<unsigned> > set4;
+		set4.reserve(nHuge);
+		for (size_t i = 0; i < nHuge; i++)
+			set4.insert(static_cast<unsigned>(i));
+		TEST(set4.find(nHuge - 1) != set4.end());
+		TEST(set4.find(nHuge) == set4.end());
+	}
+#endif
+
+	return 0;
+}
+
+#if __cplusplus >= 201103L
+int flat_numa_test()
+{
+	flat_numa_topology topology;
+	TEST(topology.nodes() >= 1 && !topology.emulated());
+	TEST(topology.current_node() < topology.nodes());
+
+	flat_map<int, int> map0;
+	for (int i = 0; i < 10000; i++)
+		map0.insert((i * 7919) % 10000 * 3, i);
+
+	flat_numa_map<int, int> map1(flat_numa_topology(3));
+	TEST(map1.empty() && map1.find(3) == nullptr);
+	map1.freeze(map0);
+	TEST(map1.replicas() == 3 && map1.size() == 10000);
+	TEST(map1.topology().emulated() && map1.topology().cpus(2).size() >= 1);
+	bool bOk = true;
+	for (size_t n = 0; n < map1.replicas(); n++)
+	{
+		if (!std::equal(map0.begin(), map0.end(), map1.replica(n).begin())) bOk = false;
+		if (n > 0 && &*map1.replica(n).begin() == &*map1.replica(n - 1).begin()) bOk = false;
+	}
+	TEST(bOk);
+
+	// lookups from threads running on each of the nodes
+	std::vector<std::thread> threads;
+	std::vector<int> found(map1.replicas(), 0);
+	for (size_t n = 0; n < map1.replicas(); n++)
+		threads.push_back(std::thread([&map1, &found, n]()
+		{
+			if (!map1.topology().bind_thread(n))
+				return;
+			for (int k = 0; k < 30000; k++)
+				found[n] += static_cast<int>(map1.count(k));
+		}));
+	for (size_t n = 0; n < threads.size(); n++)
+		threads[n].join();
+	TEST(found[0] == 10000 && found[1] == 10000 && found[2] == 10000);
+	TEST(map1.find(9)->second == map0.find(9)->second && map1.find(10) == nullptr);
+	TEST(map1.lower_bound(10)->first == 12 && map1.lower_bound(30000) == nullptr);
+	TEST(&map1.local() == &map1.replica(map1.topology().current_node()));
+	map1.clear();
+	TEST(map1.size() == 0 && map1.replicas() == 0);
+
+	return 0;
+}
+
+int flat_memory_test()
+{
+	// a burst of duplicates leaves slack which sort() gives back
+	flat_map<int, int> map1;
+	map1.set_shrink_threshold(50);
+	for (int i = 0; i < 100000; i++)
+		map1.insert(i % 1000, i);
+	TEST(map1.capacity() >= 100000);
+	TEST(map1.size() == 1000 && map1.capacity() == 1000);
+	TEST(map1.memory_usage() == 1000 * sizeof(std::pair<int, int>));
+	for (int i = 0; i < 900; i++)
+		map1.erase(map1.begin());
+	TEST(map1.size() == 100 && map1.capacity() <= 150 && map1.begin()->first == 900);
+	flat_map<int, int>::iterator it = map1.erase(map1.find(950), map1.find(990));
+	TEST(it->first == 990 && map1.size() == 60);
+
+	// without a threshold the capacity stays
+	flat_set<int> set1;
+	for (int i = 0; i < 10000; i++)
+		set1.insert(i % 10);
+	TEST(set1.size() == 10 && set1.capacity() >= 10000);
+	set1.shrink_to_fit();
+	TEST(set1.capacity() == 10 && set1.count(9) == 1);
+	flat_multiset<int> set2;
+	set2.set_shrink_threshold(100);
+	for (int i = 0; i < 1000; i++)
+		set2.insert(i % 2);
+	set2.erase(1);
+	TEST(set2.size() == 500 && set2.capacity() < 1000);
+
+	flat_map<int, int> map2(map1);
+	map2.insert(1, 1);
+	TEST(map2.size() == 61 && map2.begin()->first == 1);
+
+	// registry
+	flat_memory_registry &registry = flat_memory_registry::instance();
+	size_t nContainers = registry.containers();
+	{
+		flat_memory_registration<flat_map<int, int> > reg1(map2, "map2");
+		flat_memory_registration<flat_set<int> > reg2(set1, "set1");
+		flat_string_map<int> map3;
+		map3.insert("key", 1);
+		flat_memory_registration<flat_string_map<int> > reg3(map3, "map3");
+		TEST(registry.containers() == nContainers + 3);
+		std::vector<flat_memory_stats> stats = registry.stats();
+		TEST(stats.size() == nContainers + 3 && stats[0].nBytes >= stats[1].nBytes);
+		TEST(registry.total() >= map2.memory_usage() + set1.memory_usage() + map3.memory_usage());
+		bool bFound = false;
+		for (size_t i = 0; i < stats.size(); i++)
+			if (stats[i].name == "set1" && stats[i].nBytes == 10 * sizeof(int)) bFound = true;
+		TEST(bFound);
+		FILE *f = tmpfile();
+		registry.dump(f);
+		TEST(ftell(f) > 0);
+		fclose(f);
+	}
+	TEST(registry.containers() == nContainers);
+
+	return 0;
+}
+
+// copies throw while bThrow is set
+struct flat_test_throwing
+{
+	flat_test_throwing(int n = 0) : n(n) {}
+	flat_test_throwing(const flat_test_throwing &rhs) : n(rhs.n) { if (bThrow) throw std::runtime_error("copy"); }
+	flat_test_throwing &operator=(const flat_test_throwing &rhs) { n = rhs.n; return *this; }
+	int n;
+	static bool bThrow;
+};
+bool flat_test_throwing::bThrow = false;
+
+int flat_async_test()
+{
+	flat_async_map<int, int> map1;
+	for (int i = 0; i < 100000; i++)
+		map1.insert(i % 20000, i);
+	TEST(map1.staged() == 100000 && map1.count(5) == 0);
+	map1.sort_async();
+	TEST(map1.staged() == 0);
+
+	// readers on other threads during the sort
+	std::vector<std::thread> threads;
+	std::vector<int> found(4, 0);
+	for (size_t t = 0; t < found.size(); t++)
+		threads.push_back(std::thread([&map1, &found, t]()
+		{
+			for (int k = 0; k < 1000; k++)
+				found[t] += static_cast<int>(map1.count(k * 20));
+		}));
+	int v = 0;
+	TEST(map1.find(7, v) && v == 80007);
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+	TEST(found[0] == 1000 && found[3] == 1000);
+	TEST(map1.ready() && map1.snapshot()->size() == 20000);
+
+	// sorts run by a user executor, lookups scan the running sort
+	std::vector<std::function<void()> > tasks;
+	flat_async_map<int, int> map2(flat_async_map<int, int>::LOOKUP_SCAN);
+	map2.insert(1, 10);
+	map2.insert(2, 20);
+	map2.sort();
+	TEST(map2.ready() && map2.count(2) == 1);
+	map2.set_executor([&tasks](std::function<void()> task) { tasks.push_back(task); });
+	map2.insert(2, 21);
+	map2.insert(3, 30);
+	map2.insert(2, 22);
+	map2.sort_async();
+	TEST(tasks.size() == 1 && !map2.ready());
+	TEST(map2.find(2, v) && v == 22 && map2.find(1, v) && v == 10 && map2.count(4) == 0);
+	TEST(map2.snapshot()->size() == 2);
+	tasks[0]();
+	TEST(map2.ready() && map2.snapshot()->size() == 3);
+	TEST(map2.find(2, v) && v == 22 && map2.find(3, v) && v == 30);
+	map2.clear();
+	TEST(map2.count(1) == 0 && map2.snapshot()->size() == 0);
+
+	// a sort that throws publishes nothing and stages its elements again
+	flat_async_map<int, flat_test_throwing> map3(flat_async_map<int, flat_test_throwing>::LOOKUP_SCAN);
+	map3.set_executor([&tasks](std::function<void()> task) { tasks.push_back(task); });
+	map3.insert(1, flat_test_throwing(10));
+	map3.sort_async();
+	tasks[1]();
+	map3.insert(2, flat_test_throwing(20));
+	map3.insert(3, flat_test_throwing(30));
+	map3.sort_async();
+	flat_test_throwing::bThrow = true;
+	tasks[2]();
+	flat_test_throwing::bThrow = false;
+	TEST(map3.ready() && map3.count(2) == 0 && map3.snapshot()->size() == 1);
+	map3.insert(2, flat_test_throwing(21));
+	bool bThrown = false;
+	try
+	{
+		map3.sort();
+	}
+	catch (const std::runtime_error &)
+	{
+		bThrown = true;
+	}
+	TEST(bThrown && map3.staged() == 3);
+	map3.sort_async();
+	tasks[3]();
+	map3.wait();
+	flat_test_throwing w;
+	TEST(map3.snapshot()->size() == 3 && map3.find(2, w) && w.n == 21 && map3.find(3, w) && w.n == 30);
+	map3.set_lookup_mode(flat_async_map<int, flat_test_throwing>::LOOKUP_WAIT);
+	TEST(map3.ready() && map3.count(1) == 1);
+
+	return 0;
+}
+
+int flat_parallel_test()
+{
+	// split() never cuts a group of equal keys
+	flat_multimap<int, int> map1;
+	for (int i = 0; i < 10000; i++)
+		map1.insert(i % 7 == 0 ? 50 : i % 1000, i);
+	std::vector<flat_multimap<int, int>::iterator_pair> ranges = map1.split(8);
+	TEST(ranges.size() >= 2 && ranges.size() <= 8);
+	TEST(ranges.front().first == map1.begin() && ranges.back().second == map1.end());
+	bool bOk = true;
+	for (size_t i = 1; i < ranges.size(); i++)
+		if (ranges[i].first != ranges[i - 1].second || (ranges[i].first - 1)->first == ranges[i].first->first) bOk = false;
+	TEST(bOk);
+	flat_set<int> set1;
+	for (int i = 0; i < 10; i++)
+		set1.insert(i);
+	TEST(set1.split(4).size() == 4 && set1.split(4)[3].second - set1.split(4)[3].first == 3);
+	TEST(set1.split(20).size() == 10 && set1.split(0).size() == 1);
+	flat_multiset<int> set2;
+	for (int i = 0; i < 100; i++)
+		set2.insert(5);
+	TEST(set2.split(4).size() == 1);
+
+	flat_thread_pool pool(3);
+	TEST(pool.threads() == 3);
+	flat_map<int, long long> map2;
+	for (int i = 0; i < 100000; i++)
+		map2.insert(i, i);
+	flat_parallel_for_each(map2, [](std::pair<int, long long> &p) { p.second *= 2; }, pool);
+	TEST(map2.find(777)->second == 1554);
+	long long nSum = flat_parallel_reduce(map2, 0LL, [](long long acc, const std::pair<int, long long> &p) { return acc + p.second; },
+		[](long long lhs, long long rhs) { return lhs + rhs; }, pool);
+	TEST(nSum == 99999LL * 100000);
+
+	// groups reach one task, ranges are combined in key order
+	std::vector<int> groups = flat_parallel_reduce(map1, std::vector<int>(),
+		[](std::vector<int> acc, const std::pair<int, int> &p) { if (acc.empty() || acc.back() != p.first) acc.push_back(p.first); return acc; },
+		[](std::vector<int> lhs, const std::vector<int> &rhs) { lhs.insert(lhs.end(), rhs.begin(), rhs.end()); return lhs; }, pool, 13);
+	TEST(groups.size() == 1000);
+	bOk = true;
+	for (size_t i = 1; i < groups.size(); i++)
+		if (groups[i - 1] >= groups[i]) bOk = false;
+	TEST(bOk);
+
+	// an exception of a task reaches the caller, the default pool works as well
+	bool bThrown = false;
+	try
+	{
+		flat_parallel_for_each(set2, [](int v) { if (v == 5) throw v; });
+	}
+	catch (int)
+	{
+		bThrown = true;
+	}
+	TEST(bThrown);
+
+	return 0;
+}
+
+int flat_versioned_test()
+{
+	typedef flat_versioned_map<int, int, 16> versioned_map;
+	versioned_map map1;
+	flat_map<int, int> map0;
+	std::vector<versioned_map> snapshots;
+	std::vector<flat_map<int, int> > expected;
+	std::vector<unsigned long long> versions;
+	unsigned r = 1;
+	for (int i = 0; i < 20000; i++)
+	{
+		r = r * 1103515245 + 12345;
+		int k = static_cast<int>((r >> 8) % 3000);
+		if (i % 3 == 2)
+		{
+			map1.erase(k);
+			flat_map<int, int>::iterator it = map0.find(k);
+			if (it != map0.end()) map0.erase(it);
+		}
+		else
+		{
+			map1.insert(k, i);
+			map0.insert(k, i);
+		}
+		if (i % 2500 == 0)
+		{
+			snapshots.push_back(map1.snapshot());
+			expected.push_back(map0);
+			versions.push_back(map1.version());
+		}
+	}
+	TEST(map1.size() == map0.size() && map1.version() > versions.back() && versions[1] > versions[0]);
+
+	// every snapshot still has the elements it was taken with
+	bool bSame = true;
+	for (size_t n = 0; n < snapshots.size(); n++)
+	{
+		if (snapshots[n].size() != expected[n].size() || snapshots[n].version() != versions[n]) bSame = false;
+		versioned_map::iterator it1 = snapshots[n].begin();
+		for (flat_map<int, int>::iterator it0 = expected[n].begin(); it0 != expected[n].end(); ++it0, ++it1)
+			if (it1 == snapshots[n].end() || *it0 != *it1) bSame = false;
+	}
+	TEST(bSame);
+	versioned_map::iterator it1 = map1.begin();
+	for (flat_map<int, int>::iterator it0 = map0.begin(); it0 != map0.end(); ++it0, ++it1)
+		if (it1 == map1.end() || *it0 != *it1) bSame = false;
+	TEST(bSame && it1 == map1.end());
+	for (int k = -1; k <= 3000; k++)
+	{
+		if (map1.count(k) != map0.count(k)) bSame = false;
+		if (map1.lower_bound(k) != map1.end() && map1.lower_bound(k)->first != map0.lower_bound(k)->first) bSame = false;
+	}
+	TEST(bSame);
+
+	// a snapshot shares all chunks, a change clones one
+	snapshots.clear();
+	TEST(map1.shared_chunks() == 0);
+	size_t nBytes = map1.memory_usage();
+	versioned_map snap = map1.snapshot();
+	TEST(map1.shared_chunks() == map1.chunks() && map1.memory_usage() < nBytes * 3 / 4);
+	int k = map1.begin()->first;
+	map1.insert(k, -1);
+	TEST(map1.shared_chunks() == map1.chunks() - 1);
+	TEST(map1.find(k)->second == -1 && snap.find(k)->second == map0.find(k)->second);
+	map1.erase(map1.begin(), map1.end());
+	TEST(map1.empty() && map1.chunks() == 0 && snap.size() == map0.size());
+
+	std::vector<std::pair<int, int> > ar;
+	for (int i = 0; i < 100; i++)
+		ar.push_back(std::make_pair(i * 2, i));
+	map1.assign_sorted(ar.begin(), ar.end());
+	TEST(map1.size() == 100 && map1.chunks() == 9 && map1.find(198)->second == 99 && map1.count(3) == 0);
+	map1.insert(3, 3);
+	TEST(map1.size() == 101 && (++map1.find(2))->first == 3);
+
+	return 0;
+}
+#endif
+
+int flat_durable_test()
+{
+	const char *szPath = "flat_selftest_durable";
+	remove("flat_selftest_durable.ckpt");
+	remove("flat_selftest_durable.wal");
+	flat_map<int, int> ref;
+	{
+		flat_durable_map<int, int> map1;
+		TEST(map1.open(szPath) && map1.empty());
+		map1.set_group_commit(16);
+		for (int i = 0; i < 1000; i++)
+		{
+			map1.insert(i * 7 % 1000, i);
+			ref.insert(i * 7 % 1000, i);
+		}
+		for (int i = 0; i < 1000; i += 3)
+		{
+			map1.erase(i);
+			ref.erase(i);
+		}
+		map1.erase(5000);
+		TEST(map1.size() == ref.size());
+	}
+
+	// recovery from the log only
+	flat_durable_map<int, int> map2;
+	TEST(map2.open(szPath));
+	TEST(map2.size() == ref.size() && std::equal(ref.begin(), ref.end(), map2.begin()));
+	TEST(map2.checkpoint() && map2.log_bytes() == 0);
+	map2.insert(1, -1);
+	map2.insert(3000, 3);
+	map2.erase(2);
+	TEST(map2.commit());
+	map2.close();
+	ref.insert(1, -1);
+	ref.insert(3000, 3);
+	ref.erase(2);
+
+	// a torn record at the end of the log is dropped
+	FILE *f = fopen("flat_selftest_durable.wal", "ab");
+	fwrite("I\1\2", 1, 3, f);
+	fclose(f);
+	flat_durable_map<int, int> map3;
+	TEST(map3.open(szPath));
+	TEST(map3.size() == ref.size() && std::equal(ref.begin(), ref.end(), map3.begin()));
+	TEST(map3.find(1)->second == -1 && map3.count(2) == 0 && map3.count(0) == 0);
+	map3.set_checkpoint_bytes(1024);
+	map3.set_group_commit(1);
+	map3.clear();
+	for (int i = 0; i < 500; i++)
+		map3.insert(i, i * 2);
+	TEST(map3.log_bytes() < 1024);
+	map3.close();
+
+	flat_durable_map<int, int> map4;
+	TEST(map4.open(szPath));
+	TEST(map4.size() == 500 && map4.find(499)->second == 998 && map4.begin()->first == 0);
+	map4.close();
+	remove("flat_selftest_durable.ckpt");
+	remove("flat_selftest_durable.wal");
+
+	return 0;
+}
+
+int flat_lazy_test()
+{
+	flat_map<int, int> map0, map1;
+	unsigned nRand = 1;
+	for (int i = 0; i < 100000; i++)
+	{
+		nRand = nRand * 1103515245u + 12345u;
+		int k = static_cast<int>((nRand >> 8) % 5000);
+		map0.insert(k, i);
+		map1.insert(k, i);
+	}
+	map0.sort();
+
+	// the same keys and the last values as after a full sort
+	flat_map<int, int>::iterator_pair top = map1.first_k(10);
+	TEST(top.second - top.first == 10);
+	TEST(std::equal(top.first, top.second, map0.begin()));
+	TEST(map1.sort_first(10) < 1000);
+	TEST(map1.nth_key(100) == (map0.begin() + 100)->first);
+	bool bSame = true;
+	flat_map<int, int>::iterator it0 = map0.begin();
+	for (flat_map<int, int>::lazy_iterator it = map1.lazy_begin(); it != map1.lazy_end(); ++it, ++it0)
+		if (it0 == map0.end() || it->first != it0->first || it->second != it0->second) bSame = false;
+	TEST(bSame && it0 == map0.end());
+	TEST(map1.size() == map0.size() && map1.sort_first(1) == map0.size());
+
+	// changes after a partial sort
+	flat_map<int, int> map2, map3;
+	for (int i = 0; i < 10000; i++)
+	{
+		map2.insert((i * 37) % 3000, i);
+		map3.insert((i * 37) % 3000, i);
+	}
+	TEST(map2.first_k(50).first->first == 0);
+	map2.insert(-1, 1);
+	map2.insert(5, 55);
+	map3.insert(-1, 1);
+	map3.insert(5, 55);
+	TEST(map2.nth_key(0) == -1 && map2.first_k(7).second[-1].second == 55);
+	map2.erase(map2.first_k(1).first);
+	map3.erase(-1);
+	map2.erase(7);
+	map3.erase(7);
+	TEST(map2.size() == map3.size() && std::equal(map2.begin(), map2.end(), map3.begin()));
+
+	// a map of one key
+	flat_map<int, int> map4;
+	for (int i = 0; i < 1000; i++)
+		map4.insert(3, i);
+	TEST(map4.first_k(5).second - map4.first_k(5).first == 1 && map4.first_k(1).first->second == 999);
+	TEST(map4.lazy_begin() != map4.lazy_end() && ++map4.lazy_begin() == map4.lazy_end());
+	flat_map<int, int> map5;
+	TEST(map5.lazy_begin() == map5.lazy_end() && map5.first_k(3).first == map5.first_k(3).second);
+
+	return 0;
+}
+
+struct flat_test_big_value
+{
+	int n;
+	std::string s;
+	char pad[200];
+};
+
+int flat_indirect_test()
+{
+	flat_map<int, flat_test_big_value> map1, map2;
+	flat_map<int, int> map0;
+	flat_multimap<int, flat_test_big_value> map3;
+	flat_multimap<int, int> map4;
+	for (int i = 0; i < 20000; i++)
+	{
+		int k = (i * 7919) % 5003;
+		flat_test_big_value v;
+		v.n = i;
+		v.s = std::string(1 + i % 40, 'a');
+		map0.insert(k, i);
+		map1.insert(k, v);
+		map2.insert(k, v);
+		map3.insert(k, v);
+		map4.insert(k, i);
+	}
+	map2.sort(true);
+	TEST(sizeof(std::pair<int, flat_test_big_value>) > FLAT_INDIRECT_SORT_BYTES);
+	TEST(map1.size() == map0.size() && map2.size() == map0.size() && map3.size() == map4.size());
+
+	bool bOk = true;
+	flat_map<int, int>::iterator it0 = map0.begin();
+	flat_map<int, flat_test_big_value>::iterator it2 = map2.begin();
+	for (flat_map<int, flat_test_big_value>::iterator it1 = map1.begin(); it1 != map1.end(); ++it1, ++it0, ++it2)
+	{
+		// the last insert wins, sort(true) keeps the first one
+		if (it1->first != it0->first || it1->second.n != it0->second) bOk = false;
+		if (it1->second.s.size() != static_cast<size_t>(1 + it0->second % 40)) bOk = false;
+		if (it2->first != it0->first || it2->second.n >= 5003) bOk = false;
+	}
+	TEST(bOk);
+	flat_multimap<int, int>::iterator it4 = map4.begin();
+	for (flat_multimap<int, flat_test_big_value>::iterator it3 = map3.begin(); it3 != map3.end(); ++it3, ++it4)
+		if (it3->first != it4->first || it3->second.n != it4->second) bOk = false;
+	TEST(bOk);
+	TEST(map1.find(17) != map1.end() && map3.count(17) == 4);
+
+	return 0;
+}
+
+struct flat_test_less_n
+{
+	bool operator() (const flat_test_big_value &lhs, const flat_test_big_value &rhs) const { return lhs.n < rhs.n; }
+};
+
+int flat_value_order_test()
+{
+	flat_multimap_by_value<int, int> map1;
+	for (int i = 0; i < 1000; i++)
+		map1.insert(i % 10 == 0 ? 7 : i, (i * 37) % 1000);
+	map1.insert(7, 370);
+	TEST(map1.count(7) == 102 && map1.count(7, 370) == 2 && map1.count(7, 371) == 0);
+
+	bool bOk = true;
+	flat_multimap_by_value<int, int>::iterator_pair pit = map1.equal_range(7);
+	for (flat_multimap_by_value<int, int>::iterator it = pit.first; it + 1 < pit.second; ++it)
+		if ((it + 1)->second < it->second) bOk = false;
+	TEST(bOk);
+	TEST(map1.find(7, 370) != map1.end() && map1.find(7, 370)->first == 7 && (map1.find(7, 370) - 1)->second < 370);
+	TEST(map1.find(7, 371) == map1.end() && map1.find(8, 370) == map1.end() && map1.find(8, 296)->second == 296);
+	TEST(map1.lower_bound(7, 371)->second == 380 && map1.upper_bound(7, 370)->second == 380);
+	TEST(map1.lower_bound(7, 1000) == pit.second && map1.upper_bound(7, -1) == pit.first);
+	pit = map1.value_range(7, 300, 400);
+	TEST(pit.second - pit.first == 11 && pit.first->second == 300 && (pit.second - 1)->second == 390);
+	TEST(map1.value_range(7, 400, 300).first == map1.value_range(7, 400, 300).second);
+
+	// erasing one pair keeps the other values of the key
+	map1.erase(7, 370);
+	TEST(map1.count(7) == 101 && map1.count(7, 370) == 1 && map1.size() == 1000);
+	TEST(map1.erase(7, 371) == map1.end() && map1.size() == 1000);
+	map1.insert(7, 5);
+	TEST(map1.begin()->first == 1 && map1.lower_bound(7, 0)->second == 0 && (map1.lower_bound(7, 0) + 1)->second == 5);
+
+	flat_multimap<int, int, flat_search_binary, std::allocator<std::pair<int, int> >, std::greater<int> > map2;
+	map2.insert(1, 5);
+	map2.insert(1, 9);
+	map2.insert(1, 7);
+	TEST(map2.begin()->second == 9 && map2.lower_bound(1, 8)->second == 7);
+	flat_multimap_by_value<int, int, std::greater<int> > map6((std::greater<int>()));
+	map6.insert(1, 5);
+	map6.insert(1, 9);
+	TEST(map6.begin()->second == 9 && map6.count(1, 5) == 1);
+
+	// values of equal keys stay in the order of their inserts by default
+	flat_multimap<int, int> map3;
+	map3.insert(1, 5);
+	map3.insert(1, 9);
+	map3.insert(1, 5);
+	TEST(map3.find(1, 9) == map3.begin() + 1 && map3.count(1, 5) == 2 && map3.find(2, 5) == map3.end());
+	map3.erase(1, 5);
+	TEST(map3.size() == 2 && map3.begin()->second == 9);
+
+	// large pairs are sorted by key first, then the values of every key
+	flat_multimap<int, flat_test_big_value, flat_search_binary, std::allocator<std::pair<int, flat_test_big_value> >, flat_test_less_n> map4;
+	for (int i = 0; i < 1000; i++)
+	{
+		flat_test_big_value v;
+		v.n = (i * 37) % 1000;
+		map4.insert(i % 3, v);
+	}
+	flat_test_big_value v;
+	v.n = 37;
+	TEST(map4.find(1, v) != map4.end() && map4.find(2, v) == map4.end());
+	bOk = true;
+	for (flat_multimap<int, flat_test_big_value, flat_search_binary, std::allocator<std::pair<int, flat_test_big_value> >, flat_test_less_n>::iterator it = map4.begin(); it + 1 < map4.end(); ++it)
+		if (it->first == (it + 1)->first && (it + 1)->second.n < it->second.n) bOk = false;
+	TEST(bOk);
+
+#if __cplusplus >= 201103L
+	flat_map_builder<int, int> builder(2);
+	builder.insert(0, 1, 30);
+	builder.insert(1, 1, 10);
+	builder.insert(1, 1, 20);
+	flat_multimap_by_value<int, int> map5;
+	builder.build(map5);
+	TEST(map5.size() == 3 && map5.begin()->second == 10 && map5.find(1, 30) == map5.begin() + 2);
+#endif
+
+	return 0;
+}
+
+int flat_trace_test()
+{
+	flat_traced_map<int, int> map1;
+	map1.insert(5, 50);
+	TEST(map1.trace().records() == 0);
+	TEST(map1.trace_open("flat_selftest.trace"));
+	map1.insert(3, 30);
+	map1.insert(std::make_pair(-1, 10));
+	TEST(map1.find(3)->second == 30 && map1.count(4) == 0);
+	TEST(map1.lower_bound(4)->first == 5);
+	map1.erase(3);
+	size_t n = 0;
+	for (flat_traced_map<int, int>::iterator it = map1.begin(); it != map1.end(); ++it)
+		n++;
+	TEST(n == 2 && map1.trace().records() == 7);
+	map1.trace_close();
+	map1.insert(7, 70);
+
+	flat_trace_reader reader;
+	TEST(reader.open("flat_selftest.trace"));
+	TEST(!reader.is_set() && !reader.hashed_keys() && reader.header().nKeySize == sizeof(int));
+	const char ops[] = { 'I', 'I', 'F', 'F', 'L', 'E', 'S' };
+	const int keys[] = { 3, -1, 3, 4, 4, 3, 0 };
+	bool bOk = true;
+	char nOp;
+	uint64_t nKey;
+	for (size_t i = 0; i < 7; i++)
+		if (!reader.next(nOp, nKey) || nOp != ops[i] || nKey != (nOp == 'S' ? 0 : flat_trace_signed(keys[i]))) bOk = false;
+	TEST(bOk && !reader.next(nOp, nKey));
+	reader.close();
+
+	// signed keys keep their order
+	uint64_t nKey0, nKey1, nKey2;
+	flat_trace_key(-2, nKey0);
+	flat_trace_key(static_cast<signed char>(-1), nKey1);
+	flat_trace_key(3L, nKey2);
+	TEST(nKey0 < nKey1 && nKey1 < nKey2);
+
+	// copies have no trace, the range erase is recorded key by key
+	TEST(map1.trace_open("flat_selftest.trace"));
+	flat_traced_map<int, int> map2(map1);
+	map2 = map1;
+	TEST(map2.size() == 3 && !map2.trace().is_open());
+	map2.insert(8, 80);
+	map1.erase(map1.find(5), map1.find(7) + 1);
+	TEST(map1.size() == 1 && map1.trace().records() == 4 && map2.trace().records() == 0);
+	map1.trace_close();
+
+	flat_traced_set<std::string> set1;
+	TEST(set1.trace_open("flat_selftest.trace"));
+	set1.insert("b");
+	set1.insert("a");
+	TEST(set1.count("a") == 1 && *set1.begin() == "a");
+	set1.clear();
+	set1.trace_close();
+	TEST(reader.open("flat_selftest.trace"));
+	TEST(reader.is_set() && reader.hashed_keys() && reader.header().nValSize == 0);
+	uint64_t nHashA = 0;
+	TEST(reader.next(nOp, nKey) && reader.next(nOp, nHashA) && reader.next(nOp, nKey));
+	TEST(nOp == 'F' && nKey == nHashA && nKey == flat_hash()(std::string("a")));
+	TEST(reader.next(nOp, nKey) && nOp == 'S' && reader.next(nOp, nKey) && nOp == 'C' && !reader.next(nOp, nKey));
+	reader.close();
+	remove("flat_selftest.trace");
+	TEST(!reader.open("flat_selftest.trace"));
 
 	return 0;
 }
@@ -192,6 +1695,32 @@ int flat_test()
 int main (int argc, char **argv)
 {
 	int fi = flat_test();
+	if (fi == 0) fi = flat_search_test();
+	if (fi == 0) fi = flat_packed_test();
+	if (fi == 0) fi = flat_roaring_test();
+	if (fi == 0) fi = flat_small_test();
+	if (fi == 0) fi = flat_string_test();
+	if (fi == 0) fi = flat_blocked_test();
+	if (fi == 0) fi = flat_aggregate_test();
+	if (fi == 0) fi = flat_grouped_test();
+	if (fi == 0) fi = flat_rle_test();
+	if (fi == 0) fi = flat_huge_test();
+	if (fi == 0) fi = flat_durable_test();
+	if (fi == 0) fi = flat_lazy_test();
+	if (fi == 0) fi = flat_indirect_test();
+	if (fi == 0) fi = flat_value_order_test();
+	if (fi == 0) fi = flat_trace_test();
+#if __cplusplus >= 201402L
+	if (fi == 0) fi = flat_static_test();
+#endif
+#if __cplusplus >= 201103L
+	if (fi == 0) fi = flat_builder_test();
+	if (fi == 0) fi = flat_numa_test();
+	if (fi == 0) fi = flat_memory_test();
+	if (fi == 0) fi = flat_async_test();
+	if (fi == 0) fi = flat_parallel_test();
+	if (fi == 0) fi = flat_versioned_test();
+#endif
 	if (fi != 0)
 	{
 		printf("ftal_test() failed at test #%d\n", fi);
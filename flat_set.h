@@ -2,7 +2,10 @@
 #define _FLAT_SET_H_INCLUDED_2015_01_19
 
 #include <vector>
+#include <memory>
 #include <algorithm>
+#include <limits>
+#include "flat_search.h"
 
 /*
  * Minimalistic set C++ template based on vector
@@ -10,6 +13,8 @@
  * Flat map features
  * - Stores keys and values inside a vector, not in a binary tree
  * - Works faster for a work flow in which many adds follows many lookups
+ * - Lookup strategy is selected by a search policy (see flat_search.h)
+ * - Storage allocator is a template parameter (see flat_huge_allocator.h)
  *
  * The MIT License (MIT)
  *
@@ -81,17 +86,17 @@
 #endif // (_MSC_VER < 1400)
 #endif // _MSC_VER
 
-template<typename T>
+template<typename T, typename search_type = flat_search_binary, typename allocator_type = std::allocator<T> >
 class flat_set
 {
 public:
-	typedef typename std::vector<T>::iterator iterator;
+	typedef typename std::vector<T, allocator_type>::iterator iterator;
 	typedef std::pair<iterator, iterator> iterator_pair;
 
-	flat_set() : m_bSorted(true) {};
+	flat_set() : m_bSorted(true), m_nShrinkPercent(0) {};
 #ifdef ENABLE_MOVE_SEMANTICS
 	flat_set(const flat_set& rhs) = default;
-	flat_set(flat_set&& rhs) NOEXCEPT { swap(rhs); };
+	flat_set(flat_set&& rhs) NOEXCEPT : m_bSorted(true), m_nShrinkPercent(0) { swap(rhs); };
 	flat_set &operator=(const flat_set &rhs) = default;
 #endif
 
@@ -119,25 +124,45 @@ public:
 
 	iterator begin();
 	iterator end();
+	// at most nParts ranges covering the elements in order, for work on several threads
+	std::vector<iterator_pair> split(size_t nParts);
+
+	search_type &search() { return m_search; }
+
+	size_t capacity() const { return ar.capacity(); }
+	// bytes of the element buffer and of the search structures
+	size_t memory_usage() const { return ar.capacity()*sizeof(T) + m_search.memory_usage(); }
+	// sort() and erase() shrink the buffer when more than nPercent of size() is unused, 0 never shrinks
+	void set_shrink_threshold(unsigned nPercent) { m_nShrinkPercent = nPercent; }
+	void shrink_to_fit();
 
 	void sort(bool bPriorityFirstUnique = false);
 
 private:
-	std::vector<T> ar;
+	std::vector<T, allocator_type> ar;
+	search_type m_search;
 	bool m_bSorted;
+	unsigned m_nShrinkPercent;
+
+	void shrink_if_wasted();
+#ifdef ENABLE_TEMPLATE_OVERLOADS
+	// a number of another type uses the search policy when T holds it exactly, see flat_numeric_key
+	template <typename U> iterator find_other(const U &k, flat_bool<true>) { T t; return flat_numeric_key(k, t) ? find(t) : ar.end(); }
+	template <typename U> iterator find_other(const U &k, flat_bool<false>);
+#endif
 };
 
-template<typename T>
+template<typename T, typename search_type = flat_search_binary, typename allocator_type = std::allocator<T> >
 class flat_multiset
 {
 public:
-	typedef typename std::vector<T>::iterator iterator;
+	typedef typename std::vector<T, allocator_type>::iterator iterator;
 	typedef std::pair<iterator, iterator> iterator_pair;
 
-	flat_multiset() : m_bSorted(true) {};
+	flat_multiset() : m_bSorted(true), m_nShrinkPercent(0) {};
 #ifdef ENABLE_MOVE_SEMANTICS
 	flat_multiset(const flat_multiset& rhs) = default;
-	flat_multiset(flat_multiset&& rhs) NOEXCEPT{ swap(rhs); };
+	flat_multiset(flat_multiset&& rhs) NOEXCEPT : m_bSorted(true), m_nShrinkPercent(0) { swap(rhs); };
 	flat_multiset &operator=(const flat_multiset &rhs) = default;
 #endif
 
@@ -158,178 +183,226 @@ public:
 
 	iterator begin();
 	iterator end();
+	// at most nParts ranges covering the elements in order, equal keys never straddle two ranges
+	std::vector<iterator_pair> split(size_t nParts);
+
+	search_type &search() { return m_search; }
+
+	size_t capacity() const { return ar.capacity(); }
+	// bytes of the element buffer and of the search structures
+	size_t memory_usage() const { return ar.capacity()*sizeof(T) + m_search.memory_usage(); }
+	// sort() and erase() shrink the buffer when more than nPercent of size() is unused, 0 never shrinks
+	void set_shrink_threshold(unsigned nPercent) { m_nShrinkPercent = nPercent; }
+	void shrink_to_fit();
 
 	void sort();
 
 private:
-	std::vector<T> ar;
+	std::vector<T, allocator_type> ar;
+	search_type m_search;
 	bool m_bSorted;
+	unsigned m_nShrinkPercent;
+
+	void shrink_if_wasted();
 };
 
 
 //------------------------------------- flat_set -----------------------------------------
 
-template<typename T>
-inline void flat_set<T>::clear()
+template<typename T, typename search_type, typename allocator_type>
+inline void flat_set<T, search_type, allocator_type>::clear()
 {
 	ar.clear();
+	m_search.invalidate();
 	m_bSorted = true;
 }
 
-template<typename T>
-inline void flat_set<T>::reserve(size_t size)
+template<typename T, typename search_type, typename allocator_type>
+inline void flat_set<T, search_type, allocator_type>::reserve(size_t size)
 {
 	ar.reserve(size);
 }
 
-template<typename T>
-inline void flat_set<T>::insert(const T &v)
+template<typename T, typename search_type, typename allocator_type>
+inline void flat_set<T, search_type, allocator_type>::insert(const T &v)
 {
 	ar.push_back(v);
 	m_bSorted = false;
 }
 
-template<typename T>
-inline typename flat_set<T>::iterator flat_set<T>::find(const T &v)
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_set<T, search_type, allocator_type>::iterator flat_set<T, search_type, allocator_type>::find(const T &v)
 {
 	if (!m_bSorted) sort();
-	iterator_pair pit = std::equal_range(ar.begin(), ar.end(), v);
-	if (pit.first == pit.second)
-		return ar.end();
-	return pit.first;
+	return m_search.find(ar.begin(), ar.end(), v, flat_key_self());
 }
 
 #ifdef ENABLE_TEMPLATE_OVERLOADS
-template<typename T>
+template<typename T, typename search_type, typename allocator_type>
 template<typename U>
-inline typename flat_set<T>::iterator flat_set<T>::find(const U &v)
+inline typename flat_set<T, search_type, allocator_type>::iterator flat_set<T, search_type, allocator_type>::find(const U &v)
+{
+	return find_other(v, flat_bool<flat_is_number<T>::value && flat_is_number<U>::value>());
+}
+
+template<typename T, typename search_type, typename allocator_type>
+template<typename U>
+inline typename flat_set<T, search_type, allocator_type>::iterator flat_set<T, search_type, allocator_type>::find_other(const U &v, flat_bool<false>)
 {
 	if (ar.size() == 0) return ar.end();
 	if (!m_bSorted) sort();
 
-	int lk = 0;
-	int rk = ar.size() - 1;
-	while (true)
+	size_t lk = 0;
+	size_t rk = ar.size();
+	while (lk < rk)
 	{
-		int i = (lk + rk) / 2;
+		size_t i = lk + (rk - lk) / 2;
 		if (ar[i] < v)
 			lk = i + 1;
 		else
 			if (ar[i] == v)
 				return ar.begin() + i;
 			else
-				rk = i - 1;
-		if (lk>rk) return ar.end();
+				rk = i;
 	}
+	return ar.end();
 }
 #endif
 
-template<typename T>
-inline typename flat_set<T>::iterator flat_set<T>::lower_bound(const T &v)
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_set<T, search_type, allocator_type>::iterator flat_set<T, search_type, allocator_type>::lower_bound(const T &v)
 {
 	if (!m_bSorted) sort();
-	iterator it = std::lower_bound(ar.begin(), ar.end(), v);
-	return it;
+	return m_search.lower_bound(ar.begin(), ar.end(), v, flat_key_self());
 }
 
-template<typename T>
-inline typename flat_set<T>::iterator flat_set<T>::upper_bound(const T &v)
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_set<T, search_type, allocator_type>::iterator flat_set<T, search_type, allocator_type>::upper_bound(const T &v)
 {
 	if (!m_bSorted) sort();
-	iterator it = std::upper_bound(ar.begin(), ar.end(), v);
-	return it;
+	return m_search.upper_bound(ar.begin(), ar.end(), v, flat_key_self());
 }
 
-template<typename T>
-inline typename flat_set<T>::iterator_pair flat_set<T>::equal_range(const T &v)
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_set<T, search_type, allocator_type>::iterator_pair flat_set<T, search_type, allocator_type>::equal_range(const T &v)
 {
 	if (!m_bSorted) sort();
-	iterator_pair pit = std::equal_range(ar.begin(), ar.end(), v);
-	return pit;
+	iterator it = m_search.lower_bound(ar.begin(), ar.end(), v, flat_key_self());
+	if (it == ar.end() || v < *it)
+		return iterator_pair(it, it);
+	return iterator_pair(it, it + 1);
 }
 
-template<typename T>
-inline size_t flat_set<T>::count(const T &v)
+template<typename T, typename search_type, typename allocator_type>
+inline size_t flat_set<T, search_type, allocator_type>::count(const T &v)
 {
 	if (!m_bSorted) sort();
-	bool b = std::binary_search(ar.begin(), ar.end(), v);
-	//bool b = std::binary_search(&(*ar.begin()), &(*ar.begin())+ar.size(), v); // binary_search() on C arrays is faster then on vector
-	if (!b) return 0;
+	iterator it = m_search.find(ar.begin(), ar.end(), v, flat_key_self());
+	if (it == ar.end()) return 0;
 	return 1;
 }
 
 #ifdef ENABLE_TEMPLATE_OVERLOADS
-template <typename T>
+template <typename T, typename search_type, typename allocator_type>
 template <typename U>
-inline size_t flat_set<T>::count(const U &v)
+inline size_t flat_set<T, search_type, allocator_type>::count(const U &v)
 {
-	iterator pit = flat_set<T>::find(v);
+	iterator pit = flat_set<T, search_type, allocator_type>::find(v);
 	if (pit == ar.end())
 		return 0;
 	else return 1;
 }
 #endif
 
-template<typename T>
-inline size_t flat_set<T>::size()
+template<typename T, typename search_type, typename allocator_type>
+inline size_t flat_set<T, search_type, allocator_type>::size()
 {
 	if (!m_bSorted) sort();
 	return ar.size();
 }
 
-template<typename T>
-inline bool flat_set<T>::empty()
+template<typename T, typename search_type, typename allocator_type>
+inline bool flat_set<T, search_type, allocator_type>::empty()
 {
 	return ar.size()==0;
 }
 
-template<typename T>
-inline typename flat_set<T>::iterator flat_set<T>::erase(const T &v)
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_set<T, search_type, allocator_type>::iterator flat_set<T, search_type, allocator_type>::erase(const T &v)
 {
-	iterator it = ar.erase(std::remove(ar.begin(), ar.end(), v));
-	return it;
+	size_t nPos = ar.erase(std::remove(ar.begin(), ar.end(), v), ar.end()) - ar.begin();
+	m_search.invalidate();
+	shrink_if_wasted();
+	return ar.begin() + nPos;
 }
 
-template<typename T>
-inline typename flat_set<T>::iterator flat_set<T>::erase(iterator i0)
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_set<T, search_type, allocator_type>::iterator flat_set<T, search_type, allocator_type>::erase(iterator i0)
 {
-	iterator it = ar.erase(i0);
-	return it;
+	size_t nPos = ar.erase(i0) - ar.begin();
+	m_search.invalidate();
+	shrink_if_wasted();
+	return ar.begin() + nPos;
 }
 
-template<typename T>
-inline typename flat_set<T>::iterator flat_set<T>::erase(iterator i0, iterator i1)
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_set<T, search_type, allocator_type>::iterator flat_set<T, search_type, allocator_type>::erase(iterator i0, iterator i1)
 {
-	iterator it = ar.erase(i0, i1);
-	return it;
+	size_t nPos = ar.erase(i0, i1) - ar.begin();
+	m_search.invalidate();
+	shrink_if_wasted();
+	return ar.begin() + nPos;
 }
 
-template<typename T>
-inline void flat_set<T>::swap(flat_set<T>& other) NOEXCEPT
+template<typename T, typename search_type, typename allocator_type>
+inline void flat_set<T, search_type, allocator_type>::swap(flat_set<T, search_type, allocator_type>& other) NOEXCEPT
 {
 	std::swap(m_bSorted, other.m_bSorted);
+	std::swap(m_nShrinkPercent, other.m_nShrinkPercent);
 	std::swap(ar, other.ar);
+	std::swap(m_search, other.m_search);
+}
+
+template<typename T, typename search_type, typename allocator_type>
+inline void flat_set<T, search_type, allocator_type>::shrink_to_fit()
+{
+	std::vector<T, allocator_type>(ar.begin(), ar.end(), ar.get_allocator()).swap(ar);
+}
+
+template<typename T, typename search_type, typename allocator_type>
+inline void flat_set<T, search_type, allocator_type>::shrink_if_wasted()
+{
+	if (m_nShrinkPercent != 0 && ar.capacity() > 16 && (ar.capacity() - ar.size()) * 100 > ar.size() * m_nShrinkPercent)
+		shrink_to_fit();
 }
 
-template<typename T>
-inline typename flat_set<T>::iterator flat_set<T>::begin()
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_set<T, search_type, allocator_type>::iterator flat_set<T, search_type, allocator_type>::begin()
 {
 	if (!m_bSorted) sort();
 	return ar.begin();
 }
 
-template<typename T>
-inline typename flat_set<T>::iterator flat_set<T>::end()
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_set<T, search_type, allocator_type>::iterator flat_set<T, search_type, allocator_type>::end()
 {
 	if (!m_bSorted) sort();
 	return ar.end();
 }
 
-template<typename T>
-void inline flat_set<T>::sort(bool bPriorityFirstUnique /*= false*/)
+template<typename T, typename search_type, typename allocator_type>
+inline std::vector<typename flat_set<T, search_type, allocator_type>::iterator_pair> flat_set<T, search_type, allocator_type>::split(size_t nParts)
+{
+	if (!m_bSorted) sort();
+	return flat_split_ranges(ar.begin(), ar.end(), nParts, false, flat_key_self());
+}
+
+template<typename T, typename search_type, typename allocator_type>
+void inline flat_set<T, search_type, allocator_type>::sort(bool bPriorityFirstUnique /*= false*/)
 {
 	if (ar.size() < 2)
 	{
+		m_search.build(ar.begin(), ar.end(), flat_key_self());
 		m_bSorted = true;
 		return;
 	}
@@ -340,10 +413,10 @@ void inline flat_set<T>::sort(bool bPriorityFirstUnique /*= false*/)
 	// reversing first and last unique values
 	if (!bPriorityFirstUnique)
 	{
-		int nLast = static_cast<int>(ar.size()) - 1;
-		int nFirstUnique = nLast;
-		int nLastUnique = nLast;
-		for (int i = nLast - 1; i >= 0; i--)
+		size_t nLast = ar.size() - 1;
+		size_t nFirstUnique = nLast;
+		size_t nLastUnique = nLast;
+		for (size_t i = nLast; i-- > 0; )
 		{
 			if (ar[i] == ar[nLastUnique])
 			{
@@ -357,139 +430,166 @@ void inline flat_set<T>::sort(bool bPriorityFirstUnique /*= false*/)
 		}
 	}
 	ar.erase(std::unique(i0, i1), i1);
+	shrink_if_wasted();
 
+	m_search.build(ar.begin(), ar.end(), flat_key_self());
 	m_bSorted = true;
 }
 
 //------------------------------------- flat_multiset -----------------------------------------
 
-template<typename T>
-inline void flat_multiset<T>::clear()
+template<typename T, typename search_type, typename allocator_type>
+inline void flat_multiset<T, search_type, allocator_type>::clear()
 {
 	ar.clear();
+	m_search.invalidate();
 	m_bSorted = true;
 }
 
-template<typename T>
-inline void flat_multiset<T>::reserve(size_t size)
+template<typename T, typename search_type, typename allocator_type>
+inline void flat_multiset<T, search_type, allocator_type>::reserve(size_t size)
 {
 	ar.reserve(size);
 }
 
-template<typename T>
-inline void flat_multiset<T>::insert(const T &v)
+template<typename T, typename search_type, typename allocator_type>
+inline void flat_multiset<T, search_type, allocator_type>::insert(const T &v)
 {
 	ar.push_back(v);
 	m_bSorted = false;
 }
 
-template<typename T>
-inline typename flat_multiset<T>::iterator flat_multiset<T>::find(const T &v)
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_multiset<T, search_type, allocator_type>::iterator flat_multiset<T, search_type, allocator_type>::find(const T &v)
 {
 	if (!m_bSorted) sort();
-	iterator_pair pit = std::equal_range(ar.begin(), ar.end(), v);
-	if (pit.first == pit.second)
-		return ar.end();
-	return pit.first;
+	return m_search.find(ar.begin(), ar.end(), v, flat_key_self());
 }
 
-template<typename T>
-inline typename flat_multiset<T>::iterator flat_multiset<T>::lower_bound(const T &v)
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_multiset<T, search_type, allocator_type>::iterator flat_multiset<T, search_type, allocator_type>::lower_bound(const T &v)
 {
 	if (!m_bSorted) sort();
-	iterator it = std::lower_bound(ar.begin(), ar.end(), v);
-	return it;
+	return m_search.lower_bound(ar.begin(), ar.end(), v, flat_key_self());
 }
 
-template<typename T>
-inline typename flat_multiset<T>::iterator flat_multiset<T>::upper_bound(const T &v)
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_multiset<T, search_type, allocator_type>::iterator flat_multiset<T, search_type, allocator_type>::upper_bound(const T &v)
 {
 	if (!m_bSorted) sort();
-	iterator it = std::upper_bound(ar.begin(), ar.end(), v);
-	return it;
+	return m_search.upper_bound(ar.begin(), ar.end(), v, flat_key_self());
 }
 
-template<typename T>
-inline typename flat_multiset<T>::iterator_pair flat_multiset<T>::equal_range(const T &v)
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_multiset<T, search_type, allocator_type>::iterator_pair flat_multiset<T, search_type, allocator_type>::equal_range(const T &v)
 {
 	if (!m_bSorted) sort();
-	iterator_pair pit = std::equal_range(ar.begin(), ar.end(), v);
-	return pit;
+	iterator it = m_search.lower_bound(ar.begin(), ar.end(), v, flat_key_self());
+	return iterator_pair(it, m_search.upper_bound(ar.begin(), ar.end(), v, flat_key_self()));
 }
 
-template<typename T>
-inline size_t flat_multiset<T>::count(const T &v)
+template<typename T, typename search_type, typename allocator_type>
+inline size_t flat_multiset<T, search_type, allocator_type>::count(const T &v)
 {
-	if (!m_bSorted) sort();
-	iterator_pair pit = std::equal_range(ar.begin(), ar.end(), v);
+	iterator_pair pit = equal_range(v);
 	return std::distance(pit.first, pit.second);
 }
 
-template<typename T>
-inline size_t flat_multiset<T>::size()
+template<typename T, typename search_type, typename allocator_type>
+inline size_t flat_multiset<T, search_type, allocator_type>::size()
 {
 	return ar.size();
 }
 
-template<typename T>
-inline bool flat_multiset<T>::empty()
+template<typename T, typename search_type, typename allocator_type>
+inline bool flat_multiset<T, search_type, allocator_type>::empty()
 {
 	return ar.size()==0;
 }
 
-template<typename T>
-inline typename flat_multiset<T>::iterator flat_multiset<T>::erase(const T &v)
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_multiset<T, search_type, allocator_type>::iterator flat_multiset<T, search_type, allocator_type>::erase(const T &v)
 {
-	iterator it = ar.erase(std::remove(ar.begin(), ar.end(), v), ar.end());
-	return it;
+	size_t nPos = ar.erase(std::remove(ar.begin(), ar.end(), v), ar.end()) - ar.begin();
+	m_search.invalidate();
+	shrink_if_wasted();
+	return ar.begin() + nPos;
 }
 
-template<typename T>
-inline typename flat_multiset<T>::iterator flat_multiset<T>::erase(iterator i0)
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_multiset<T, search_type, allocator_type>::iterator flat_multiset<T, search_type, allocator_type>::erase(iterator i0)
 {
-	iterator it = ar.erase(i0);
-	return it;
+	size_t nPos = ar.erase(i0) - ar.begin();
+	m_search.invalidate();
+	shrink_if_wasted();
+	return ar.begin() + nPos;
 }
 
-template<typename T>
-inline typename flat_multiset<T>::iterator flat_multiset<T>::erase(iterator i0, iterator i1)
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_multiset<T, search_type, allocator_type>::iterator flat_multiset<T, search_type, allocator_type>::erase(iterator i0, iterator i1)
 {
-	iterator it = ar.erase(i0, i1);
-	return it;
+	size_t nPos = ar.erase(i0, i1) - ar.begin();
+	m_search.invalidate();
+	shrink_if_wasted();
+	return ar.begin() + nPos;
 }
 
-template<typename T>
-inline void flat_multiset<T>::swap(flat_multiset<T>& other) NOEXCEPT
+template<typename T, typename search_type, typename allocator_type>
+inline void flat_multiset<T, search_type, allocator_type>::swap(flat_multiset<T, search_type, allocator_type>& other) NOEXCEPT
 {
 	std::swap(m_bSorted, other.m_bSorted);
+	std::swap(m_nShrinkPercent, other.m_nShrinkPercent);
 	std::swap(ar, other.ar);
+	std::swap(m_search, other.m_search);
 }
 
-template<typename T>
-inline typename flat_multiset<T>::iterator flat_multiset<T>::begin()
+template<typename T, typename search_type, typename allocator_type>
+inline void flat_multiset<T, search_type, allocator_type>::shrink_to_fit()
+{
+	std::vector<T, allocator_type>(ar.begin(), ar.end(), ar.get_allocator()).swap(ar);
+}
+
+template<typename T, typename search_type, typename allocator_type>
+inline void flat_multiset<T, search_type, allocator_type>::shrink_if_wasted()
+{
+	if (m_nShrinkPercent != 0 && ar.capacity() > 16 && (ar.capacity() - ar.size()) * 100 > ar.size() * m_nShrinkPercent)
+		shrink_to_fit();
+}
+
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_multiset<T, search_type, allocator_type>::iterator flat_multiset<T, search_type, allocator_type>::begin()
 {
 	if (!m_bSorted) sort();
 	return ar.begin();
 }
 
-template<typename T>
-inline typename flat_multiset<T>::iterator flat_multiset<T>::end()
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_multiset<T, search_type, allocator_type>::iterator flat_multiset<T, search_type, allocator_type>::end()
 {
 	if (!m_bSorted) sort();
 	return ar.end();
 }
 
-template<typename T>
-void inline flat_multiset<T>::sort()
+template<typename T, typename search_type, typename allocator_type>
+inline std::vector<typename flat_multiset<T, search_type, allocator_type>::iterator_pair> flat_multiset<T, search_type, allocator_type>::split(size_t nParts)
+{
+	if (!m_bSorted) sort();
+	return flat_split_ranges(ar.begin(), ar.end(), nParts, true, flat_key_self());
+}
+
+template<typename T, typename search_type, typename allocator_type>
+void inline flat_multiset<T, search_type, allocator_type>::sort()
 {
 	if (ar.size() < 2)
 	{
+		m_search.build(ar.begin(), ar.end(), flat_key_self());
 		m_bSorted = true;
 		return;
 	}
 	iterator i0 = ar.begin();
 	iterator i1 = ar.end();
 	std::sort(i0, i1);
+	m_search.build(ar.begin(), ar.end(), flat_key_self());
 	m_bSorted = true;
 }
 
@@ -0,0 +1,217 @@
+#ifndef _FLAT_SMALL_VECTOR_H_INCLUDED_2026_10_19
+#define _FLAT_SMALL_VECTOR_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <algorithm>
+#include <new>
+
+/*
+ * Vector with inline storage for small flat containers
+ *
+ * Flat small vector features
+ * - The first N elements are stored inside the object, no heap allocation
+ * - Beyond N elements all of them move to a std::vector
+ * - clear() returns to the inline storage and releases the heap buffer
+ * - Inline elements are constructed in place, T needs no default constructor
+ * - The inline storage is aligned for the fundamental types, not for over-aligned T
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+template<typename T, size_t N>
+class flat_small_vector
+{
+public:
+	typedef T* iterator;
+
+	flat_small_vector() : m_nSize(0), m_bHeap(false) {};
+	flat_small_vector(const flat_small_vector& other);
+	flat_small_vector& operator=(const flat_small_vector& other);
+	~flat_small_vector() { destroy_inline(0); }
+
+	iterator begin() { return m_bHeap ? heap_data() : inl(); }
+	iterator end() { return begin() + size(); }
+	size_t size() const { return m_bHeap ? m_heap.size() : m_nSize; }
+	size_t capacity() const { return m_bHeap ? m_heap.capacity() : N; }
+	bool is_inline() const { return !m_bHeap; }
+	T& operator[] (size_t i) { return begin()[i]; }
+
+	void reserve(size_t size);
+	void push_back(const T& v);
+	iterator insert(iterator pos, const T& v);
+	iterator erase(iterator i0, iterator i1);
+	iterator erase(iterator i0) { return erase(i0, i0 + 1); }
+	void clear();
+	void swap(flat_small_vector& other);
+
+private:
+	void spill(size_t nCapacity);
+	// destroys the inline elements from nSize on
+	void destroy_inline(size_t nSize);
+	// the heap stays in use when it is emptied or reserved while empty, &m_heap[0] is then undefined
+	T* heap_data() { return m_heap.empty() ? 0 : &m_heap[0]; }
+	T* inl() { return reinterpret_cast<T*>(m_inl.buf); }
+	const T* inl() const { return reinterpret_cast<const T*>(m_inl.buf); }
+
+	// raw storage of N elements, [0, m_nSize) are constructed
+	union inline_storage
+	{
+		char buf[sizeof(T) * N];
+		long double ld;
+		long long ll;
+		void *p;
+	};
+
+	inline_storage m_inl;
+	std::vector<T> m_heap;
+	size_t m_nSize;			// number of inline elements
+	bool m_bHeap;
+};
+
+template<typename T, size_t N>
+inline flat_small_vector<T, N>::flat_small_vector(const flat_small_vector<T, N>& other) : m_heap(other.m_heap), m_nSize(0), m_bHeap(other.m_bHeap)
+{
+	for (; m_nSize < other.m_nSize; m_nSize++)
+		new (inl() + m_nSize) T(other.inl()[m_nSize]);
+}
+
+template<typename T, size_t N>
+inline flat_small_vector<T, N>& flat_small_vector<T, N>::operator=(const flat_small_vector<T, N>& other)
+{
+	if (this != &other)
+	{
+		flat_small_vector<T, N> copy(other);
+		swap(copy);
+	}
+	return *this;
+}
+
+template<typename T, size_t N>
+inline void flat_small_vector<T, N>::destroy_inline(size_t nSize)
+{
+	for (size_t i = nSize; i < m_nSize; i++)
+		inl()[i].~T();
+	m_nSize = nSize;
+}
+
+template<typename T, size_t N>
+inline void flat_small_vector<T, N>::spill(size_t nCapacity)
+{
+	m_heap.reserve(std::max(nCapacity, 2 * N));
+	m_heap.assign(inl(), inl() + m_nSize);
+	destroy_inline(0);
+	m_bHeap = true;
+}
+
+template<typename T, size_t N>
+inline void flat_small_vector<T, N>::reserve(size_t size)
+{
+	if (m_bHeap)
+		m_heap.reserve(size);
+	else if (size > N)
+		spill(size);
+}
+
+template<typename T, size_t N>
+inline void flat_small_vector<T, N>::push_back(const T& v)
+{
+	if (!m_bHeap)
+	{
+		if (m_nSize < N)
+		{
+			new (inl() + m_nSize) T(v);
+			m_nSize++;
+			return;
+		}
+		spill(N + 1);
+	}
+	m_heap.push_back(v);
+}
+
+template<typename T, size_t N>
+inline typename flat_small_vector<T, N>::iterator flat_small_vector<T, N>::insert(iterator pos, const T& v)
+{
+	size_t i = pos - begin();
+	if (!m_bHeap)
+	{
+		if (m_nSize < N)
+		{
+			if (i == m_nSize)
+				new (inl() + i) T(v);
+			else
+			{
+				// v may be one of the elements being moved
+				T copy(v);
+				new (inl() + m_nSize) T(inl()[m_nSize - 1]);
+				std::copy_backward(inl() + i, inl() + m_nSize - 1, inl() + m_nSize);
+				inl()[i] = copy;
+			}
+			m_nSize++;
+			return inl() + i;
+		}
+		spill(N + 1);
+	}
+	m_heap.insert(m_heap.begin() + i, v);
+	return heap_data() + i;
+}
+
+template<typename T, size_t N>
+inline typename flat_small_vector<T, N>::iterator flat_small_vector<T, N>::erase(iterator i0, iterator i1)
+{
+	size_t i = i0 - begin();
+	if (m_bHeap)
+	{
+		m_heap.erase(m_heap.begin() + i, m_heap.begin() + (i1 - begin()));
+		return begin() + i;
+	}
+	iterator it = std::copy(i1, inl() + m_nSize, i0);
+	destroy_inline(it - inl());
+	return inl() + i;
+}
+
+template<typename T, size_t N>
+inline void flat_small_vector<T, N>::clear()
+{
+	destroy_inline(0);
+	std::vector<T>().swap(m_heap);
+	m_bHeap = false;
+}
+
+template<typename T, size_t N>
+inline void flat_small_vector<T, N>::swap(flat_small_vector<T, N>& other)
+{
+	// the elements past the shorter inline part are copied over and destroyed
+	size_t nCommon = std::min(m_nSize, other.m_nSize);
+	std::swap_ranges(inl(), inl() + nCommon, other.inl());
+	flat_small_vector<T, N> &longer = m_nSize > other.m_nSize ? *this : other;
+	flat_small_vector<T, N> &shorter = m_nSize > other.m_nSize ? other : *this;
+	for (; shorter.m_nSize < longer.m_nSize; shorter.m_nSize++)
+		new (shorter.inl() + shorter.m_nSize) T(longer.inl()[shorter.m_nSize]);
+	longer.destroy_inline(nCommon);
+	m_heap.swap(other.m_heap);
+	std::swap(m_bHeap, other.m_bHeap);
+}
+
+#endif // _FLAT_SMALL_VECTOR_H_INCLUDED_2026_10_19
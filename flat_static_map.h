@@ -0,0 +1,233 @@
+#ifndef _FLAT_STATIC_MAP_H_INCLUDED_2026_10_19
+#define _FLAT_STATIC_MAP_H_INCLUDED_2026_10_19
+
+#include <cstddef>
+
+/*
+ * Compile time flat map and set C++ templates for constant lookup tables (C++14)
+ *
+ * Flat static map features
+ * - Built by a constexpr constructor from an array of elements, sorted and deduplicated at compile time
+ * - A duplicate key keeps the last value, as flat_map::sort() does
+ * - constexpr find(), lower_bound(), upper_bound() and count(), lookups of constant keys fold to constants
+ * - A constexpr table is stored in read only data and costs nothing at startup
+ * - Keys and values must be literal types, the capacity N is the number of initializers
+ *
+ * constexpr auto table = make_flat_static_map<int, const char*>({ { 2, "two" }, { 1, "one" } });
+ * static_assert(table.find(2)->second[0] == 't', "");
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+#if __cplusplus >= 201402L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+
+template<typename key_type, typename val_type>
+struct flat_static_pair
+{
+	key_type first;
+	val_type second;
+};
+
+template<typename key_type, typename val_type, size_t N>
+class flat_static_map
+{
+public:
+	typedef flat_static_pair<key_type, val_type> pair_type;
+	typedef const pair_type* const_iterator;
+
+	constexpr flat_static_map(const pair_type (&init)[N]);
+
+	constexpr const_iterator begin() const { return m_ar; }
+	constexpr const_iterator end() const { return m_ar + m_nSize; }
+	constexpr size_t size() const { return m_nSize; }
+	constexpr bool empty() const { return m_nSize == 0; }
+
+	constexpr const_iterator lower_bound(const key_type &k) const;
+	constexpr const_iterator upper_bound(const key_type &k) const;
+	constexpr const_iterator find(const key_type &k) const;
+	constexpr size_t count(const key_type &k) const { return find(k) == end() ? 0 : 1; }
+
+private:
+	pair_type m_ar[N];
+	size_t m_nSize;
+};
+
+template<typename key_type, typename val_type, size_t N>
+constexpr flat_static_map<key_type, val_type, N>::flat_static_map(const pair_type (&init)[N]) : m_ar(), m_nSize(0)
+{
+	// stable insertion sort, equal keys keep the order of the initializers
+	for (size_t i = 0; i < N; i++)
+	{
+		size_t j = i;
+		for (; j > 0 && init[i].first < m_ar[j - 1].first; j--)
+			m_ar[j] = m_ar[j - 1];
+		m_ar[j] = init[i];
+	}
+
+	// keeping the last value of each key
+	for (size_t i = 0; i < N; i++)
+	{
+		if (m_nSize > 0 && !(m_ar[m_nSize - 1].first < m_ar[i].first))
+			m_ar[m_nSize - 1] = m_ar[i];
+		else
+			m_ar[m_nSize++] = m_ar[i];
+	}
+}
+
+template<typename key_type, typename val_type, size_t N>
+constexpr typename flat_static_map<key_type, val_type, N>::const_iterator flat_static_map<key_type, val_type, N>::lower_bound(const key_type &k) const
+{
+	size_t lk = 0;
+	size_t rk = m_nSize;
+	while (lk < rk)
+	{
+		size_t i = lk + (rk - lk) / 2;
+		if (m_ar[i].first < k)
+			lk = i + 1;
+		else
+			rk = i;
+	}
+	return m_ar + lk;
+}
+
+template<typename key_type, typename val_type, size_t N>
+constexpr typename flat_static_map<key_type, val_type, N>::const_iterator flat_static_map<key_type, val_type, N>::upper_bound(const key_type &k) const
+{
+	size_t lk = 0;
+	size_t rk = m_nSize;
+	while (lk < rk)
+	{
+		size_t i = lk + (rk - lk) / 2;
+		if (k < m_ar[i].first)
+			rk = i;
+		else
+			lk = i + 1;
+	}
+	return m_ar + lk;
+}
+
+template<typename key_type, typename val_type, size_t N>
+constexpr typename flat_static_map<key_type, val_type, N>::const_iterator flat_static_map<key_type, val_type, N>::find(const key_type &k) const
+{
+	const_iterator it = lower_bound(k);
+	if (it == end() || k < it->first)
+		return end();
+	return it;
+}
+
+template<typename key_type, typename val_type, size_t N>
+constexpr flat_static_map<key_type, val_type, N> make_flat_static_map(const flat_static_pair<key_type, val_type> (&init)[N])
+{
+	return flat_static_map<key_type, val_type, N>(init);
+}
+
+template<typename T, size_t N>
+class flat_static_set
+{
+public:
+	typedef const T* const_iterator;
+
+	constexpr flat_static_set(const T (&init)[N]);
+
+	constexpr const_iterator begin() const { return m_ar; }
+	constexpr const_iterator end() const { return m_ar + m_nSize; }
+	constexpr size_t size() const { return m_nSize; }
+	constexpr bool empty() const { return m_nSize == 0; }
+
+	constexpr const_iterator lower_bound(const T &v) const;
+	constexpr const_iterator upper_bound(const T &v) const;
+	constexpr const_iterator find(const T &v) const;
+	constexpr size_t count(const T &v) const { return find(v) == end() ? 0 : 1; }
+
+private:
+	T m_ar[N];
+	size_t m_nSize;
+};
+
+template<typename T, size_t N>
+constexpr flat_static_set<T, N>::flat_static_set(const T (&init)[N]) : m_ar(), m_nSize(0)
+{
+	for (size_t i = 0; i < N; i++)
+	{
+		size_t j = i;
+		for (; j > 0 && init[i] < m_ar[j - 1]; j--)
+			m_ar[j] = m_ar[j - 1];
+		m_ar[j] = init[i];
+	}
+	for (size_t i = 0; i < N; i++)
+		if (m_nSize == 0 || m_ar[m_nSize - 1] < m_ar[i])
+			m_ar[m_nSize++] = m_ar[i];
+}
+
+template<typename T, size_t N>
+constexpr typename flat_static_set<T, N>::const_iterator flat_static_set<T, N>::lower_bound(const T &v) const
+{
+	size_t lk = 0;
+	size_t rk = m_nSize;
+	while (lk < rk)
+	{
+		size_t i = lk + (rk - lk) / 2;
+		if (m_ar[i] < v)
+			lk = i + 1;
+		else
+			rk = i;
+	}
+	return m_ar + lk;
+}
+
+template<typename T, size_t N>
+constexpr typename flat_static_set<T, N>::const_iterator flat_static_set<T, N>::upper_bound(const T &v) const
+{
+	size_t lk = 0;
+	size_t rk = m_nSize;
+	while (lk < rk)
+	{
+		size_t i = lk + (rk - lk) / 2;
+		if (v < m_ar[i])
+			rk = i;
+		else
+			lk = i + 1;
+	}
+	return m_ar + lk;
+}
+
+template<typename T, size_t N>
+constexpr typename flat_static_set<T, N>::const_iterator flat_static_set<T, N>::find(const T &v) const
+{
+	const_iterator it = lower_bound(v);
+	if (it == end() || v < *it)
+		return end();
+	return it;
+}
+
+template<typename T, size_t N>
+constexpr flat_static_set<T, N> make_flat_static_set(const T (&init)[N])
+{
+	return flat_static_set<T, N>(init);
+}
+
+#endif // __cplusplus >= 201402L
+
+#endif // _FLAT_STATIC_MAP_H_INCLUDED_2026_10_19
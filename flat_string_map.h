@@ -0,0 +1,368 @@
+#ifndef _FLAT_STRING_MAP_H_INCLUDED_2026_10_19
+#define _FLAT_STRING_MAP_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <string.h>
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <string_view>
+#define ENABLE_STRING_VIEW
+#endif
+
+/*
+ * Minimalistic map C++ template with string keys
+ *
+ * Flat string map features
+ * - Key bytes of all elements are stored in one arena, not in std::string objects
+ * - Every element is a fixed size slot: first 8 key bytes as an integer, offset and length of the key
+ * - Most comparisons are resolved on the integer prefix without touching the arena
+ * - Lookups take a pointer and a length, a C string, std::string or std::string_view (C++17)
+ * - sort() lays out the arena again in key order and drops bytes of erased keys
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+template<typename val_type>
+class flat_string_map
+{
+	struct slot
+	{
+		unsigned long long nPrefix;	// first 8 bytes, big endian, zero padded
+		size_t nOffset;
+		size_t nLength;
+		val_type value;
+	};
+
+public:
+	// Bidirectional iterator, key() and value() instead of first and second
+	class iterator
+	{
+	public:
+		iterator() : m_p(0), m_pArena(0) {};
+
+		const char *key_data() const { return m_pArena + m_p->nOffset; }
+		size_t key_size() const { return m_p->nLength; }
+		std::string key() const { return std::string(key_data(), key_size()); }
+#ifdef ENABLE_STRING_VIEW
+		std::string_view key_view() const { return std::string_view(key_data(), key_size()); }
+#endif
+		val_type& value() const { return m_p->value; }
+
+		iterator& operator++ () { ++m_p; return *this; }
+		iterator& operator-- () { --m_p; return *this; }
+		iterator operator++ (int) { iterator it(*this); ++m_p; return it; }
+		iterator operator-- (int) { iterator it(*this); --m_p; return it; }
+		bool operator== (const iterator& rhs) const { return m_p == rhs.m_p; }
+		bool operator!= (const iterator& rhs) const { return m_p != rhs.m_p; }
+
+	private:
+		friend class flat_string_map;
+		iterator(slot *p, const char *pArena) : m_p(p), m_pArena(pArena) {};
+
+		slot *m_p;
+		const char *m_pArena;
+	};
+	typedef std::pair<iterator, iterator> iterator_pair;
+
+	flat_string_map() : m_nGarbage(0), m_bSorted(true) {};
+
+	void clear();
+	void reserve(size_t size, size_t nKeyBytes = 0);
+	void insert(const char *k, size_t n, const val_type &v);
+	void insert(const char *k, const val_type &v) { insert(k, strlen(k), v); }
+	void insert(const std::string &k, const val_type &v) { insert(k.data(), k.size(), v); }
+	iterator find(const char *k, size_t n);
+	iterator find(const char *k) { return find(k, strlen(k)); }
+	iterator find(const std::string &k) { return find(k.data(), k.size()); }
+	iterator lower_bound(const char *k, size_t n);
+	iterator lower_bound(const char *k) { return lower_bound(k, strlen(k)); }
+	iterator lower_bound(const std::string &k) { return lower_bound(k.data(), k.size()); }
+	iterator upper_bound(const char *k, size_t n);
+	iterator upper_bound(const char *k) { return upper_bound(k, strlen(k)); }
+	iterator upper_bound(const std::string &k) { return upper_bound(k.data(), k.size()); }
+	size_t count(const char *k, size_t n) { return find(k, n) == end() ? 0 : 1; }
+	size_t count(const char *k) { return count(k, strlen(k)); }
+	size_t count(const std::string &k) { return count(k.data(), k.size()); }
+#ifdef ENABLE_STRING_VIEW
+	void insert(std::string_view k, const val_type &v) { insert(k.data(), k.size(), v); }
+	iterator find(std::string_view k) { return find(k.data(), k.size()); }
+	iterator lower_bound(std::string_view k) { return lower_bound(k.data(), k.size()); }
+	iterator upper_bound(std::string_view k) { return upper_bound(k.data(), k.size()); }
+	size_t count(std::string_view k) { return count(k.data(), k.size()); }
+#endif
+	bool empty();
+	size_t size();
+	iterator erase(const char *k, size_t n);
+	iterator erase(const char *k) { return erase(k, strlen(k)); }
+	iterator erase(const std::string &k) { return erase(k.data(), k.size()); }
+	iterator erase(iterator i0);
+	void swap(flat_string_map& other);
+
+	iterator begin();
+	iterator end();
+
+	// slots with their prefixes, offsets, lengths and values, and the arena with
+	// the bytes of erased and replaced keys until the next sort()
+	size_t memory_usage() const;
+
+	void sort();
+
+private:
+	static unsigned long long prefix(const char *k, size_t n);
+
+	// a key being looked up, prefix is computed once
+	struct probe
+	{
+		probe(const char *k, size_t n) : pData(k), nLength(n), nPrefix(prefix(k, n)) {};
+
+		const char *pData;
+		size_t nLength;
+		unsigned long long nPrefix;
+	};
+
+	static int compare(unsigned long long p0, const char *k0, size_t n0, unsigned long long p1, const char *k1, size_t n1);
+
+	struct slot_less
+	{
+		slot_less(const char *pArena) : m_pArena(pArena) {};
+
+		bool operator() (const slot& lhs, const slot& rhs) const
+		{
+			return compare(lhs.nPrefix, m_pArena + lhs.nOffset, lhs.nLength, rhs.nPrefix, m_pArena + rhs.nOffset, rhs.nLength) < 0;
+		}
+		bool operator() (const slot& lhs, const probe& rhs) const
+		{
+			return compare(lhs.nPrefix, m_pArena + lhs.nOffset, lhs.nLength, rhs.nPrefix, rhs.pData, rhs.nLength) < 0;
+		}
+		bool operator() (const probe& lhs, const slot& rhs) const
+		{
+			return compare(lhs.nPrefix, lhs.pData, lhs.nLength, rhs.nPrefix, m_pArena + rhs.nOffset, rhs.nLength) < 0;
+		}
+		const char *m_pArena;
+	};
+
+	iterator make_iterator(typename std::vector<slot>::iterator it) { return iterator(ar.empty() ? 0 : &ar[0] + (it - ar.begin()), arena()); }
+	const char *arena() const { return m_arena.empty() ? 0 : &m_arena[0]; }
+
+	std::vector<slot> ar;
+	std::vector<char> m_arena;
+	size_t m_nGarbage;			// arena bytes of erased and replaced keys
+	bool m_bSorted;
+};
+
+//------------------------------------- flat_string_map -----------------------------------------
+
+template<typename val_type>
+inline unsigned long long flat_string_map<val_type>::prefix(const char *k, size_t n)
+{
+	unsigned long long p = 0;
+	size_t m = n < 8 ? n : 8;
+	for (size_t i = 0; i < m; i++)
+		p |= static_cast<unsigned long long>(static_cast<unsigned char>(k[i])) << (56 - 8 * i);
+	return p;
+}
+
+template<typename val_type>
+inline int flat_string_map<val_type>::compare(unsigned long long p0, const char *k0, size_t n0, unsigned long long p1, const char *k1, size_t n1)
+{
+	if (p0 != p1)
+		return p0 < p1 ? -1 : 1;
+
+	// equal prefixes, bytes after the first 8 decide, then the length
+	size_t n = n0 < n1 ? n0 : n1;
+	if (n > 8)
+	{
+		int r = memcmp(k0 + 8, k1 + 8, n - 8);
+		if (r != 0) return r;
+	}
+	if (n0 == n1) return 0;
+	return n0 < n1 ? -1 : 1;
+}
+
+template<typename val_type>
+inline void flat_string_map<val_type>::clear()
+{
+	ar.clear();
+	m_arena.clear();
+	m_nGarbage = 0;
+	m_bSorted = true;
+}
+
+template<typename val_type>
+inline void flat_string_map<val_type>::reserve(size_t size, size_t nKeyBytes /*= 0*/)
+{
+	ar.reserve(size);
+	m_arena.reserve(nKeyBytes);
+}
+
+template<typename val_type>
+inline void flat_string_map<val_type>::insert(const char *k, size_t n, const val_type &v)
+{
+	slot s;
+	s.nPrefix = prefix(k, n);
+	s.nOffset = m_arena.size();
+	s.nLength = n;
+	s.value = v;
+	// a key inside the arena, e.g. key_data() of an element, moves when the arena grows
+	const char *pArena = arena();
+	std::less<const char*> less;
+	if (n != 0 && pArena != 0 && !less(k, pArena) && less(k, pArena + m_arena.size()))
+	{
+		size_t nFrom = k - pArena;
+		m_arena.resize(s.nOffset + n);
+		memcpy(&m_arena[s.nOffset], &m_arena[nFrom], n);
+	}
+	else
+		m_arena.insert(m_arena.end(), k, k + n);
+	ar.push_back(s);
+	m_bSorted = false;
+}
+
+template<typename val_type>
+inline typename flat_string_map<val_type>::iterator flat_string_map<val_type>::lower_bound(const char *k, size_t n)
+{
+	if (!m_bSorted) sort();
+	return make_iterator(std::lower_bound(ar.begin(), ar.end(), probe(k, n), slot_less(arena())));
+}
+
+template<typename val_type>
+inline typename flat_string_map<val_type>::iterator flat_string_map<val_type>::upper_bound(const char *k, size_t n)
+{
+	if (!m_bSorted) sort();
+	return make_iterator(std::upper_bound(ar.begin(), ar.end(), probe(k, n), slot_less(arena())));
+}
+
+template<typename val_type>
+inline typename flat_string_map<val_type>::iterator flat_string_map<val_type>::find(const char *k, size_t n)
+{
+	if (!m_bSorted) sort();
+	probe p(k, n);
+	slot_less less(arena());
+	typename std::vector<slot>::iterator it = std::lower_bound(ar.begin(), ar.end(), p, less);
+	if (it == ar.end() || less(p, *it))
+		return end();
+	return make_iterator(it);
+}
+
+template<typename val_type>
+inline size_t flat_string_map<val_type>::size()
+{
+	if (!m_bSorted) sort();
+	return ar.size();
+}
+
+template<typename val_type>
+inline bool flat_string_map<val_type>::empty()
+{
+	return ar.size()==0;
+}
+
+template<typename val_type>
+inline typename flat_string_map<val_type>::iterator flat_string_map<val_type>::erase(const char *k, size_t n)
+{
+	iterator it = find(k, n);
+	if (it == end()) return it;
+	return erase(it);
+}
+
+template<typename val_type>
+inline typename flat_string_map<val_type>::iterator flat_string_map<val_type>::erase(iterator i0)
+{
+	m_nGarbage += i0.m_p->nLength;
+	return make_iterator(ar.erase(ar.begin() + (i0.m_p - &ar[0])));
+}
+
+template<typename val_type>
+inline void flat_string_map<val_type>::swap(flat_string_map<val_type>& other)
+{
+	std::swap(m_bSorted, other.m_bSorted);
+	std::swap(m_nGarbage, other.m_nGarbage);
+	ar.swap(other.ar);
+	m_arena.swap(other.m_arena);
+}
+
+template<typename val_type>
+inline typename flat_string_map<val_type>::iterator flat_string_map<val_type>::begin()
+{
+	if (!m_bSorted) sort();
+	return make_iterator(ar.begin());
+}
+
+template<typename val_type>
+inline typename flat_string_map<val_type>::iterator flat_string_map<val_type>::end()
+{
+	if (!m_bSorted) sort();
+	return make_iterator(ar.end());
+}
+
+template<typename val_type>
+inline size_t flat_string_map<val_type>::memory_usage() const
+{
+	return ar.capacity()*sizeof(slot) + m_arena.capacity()*sizeof(char);
+}
+
+template<typename val_type>
+void inline flat_string_map<val_type>::sort()
+{
+	m_bSorted = true;
+	typename std::vector<slot>::iterator i0 = ar.begin();
+	typename std::vector<slot>::iterator i1 = ar.end();
+	std::stable_sort(i0, i1, slot_less(arena()));
+
+	// keeping the last added value of each key
+	slot_less less(arena());
+	typename std::vector<slot>::iterator out = i0;
+	for (typename std::vector<slot>::iterator it = i0; it != i1; )
+	{
+		typename std::vector<slot>::iterator last = it;
+		while (++it != i1 && !less(*last, *it))
+		{
+			m_nGarbage += last->nLength;
+			last = it;
+		}
+		if (out != last) *out = *last;
+		++out;
+	}
+	ar.erase(out, i1);
+
+	// copying keys into a new arena in key order
+	std::vector<char> keys;
+	keys.reserve(m_arena.size() - m_nGarbage);
+	for (typename std::vector<slot>::iterator it = ar.begin(); it != ar.end(); ++it)
+	{
+		const char *k = arena() + it->nOffset;
+		it->nOffset = keys.size();
+		keys.insert(keys.end(), k, k + it->nLength);
+	}
+	m_arena.swap(keys);
+	m_nGarbage = 0;
+}
+
+#undef ENABLE_STRING_VIEW
+
+#endif // _FLAT_STRING_MAP_H_INCLUDED_2026_10_19
@@ -0,0 +1,363 @@
+#ifndef _FLAT_TRACE_H_INCLUDED_2026_10_19
+#define _FLAT_TRACE_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits>
+#include "flat_map.h"
+#include "flat_set.h"
+
+/*
+ * Recording of container operations for offline replay (see flat_replay.cpp)
+ *
+ * Flat trace features
+ * - flat_traced_map and flat_traced_set are a flat_map and a flat_set which
+ *   record insert, find, count, lower_bound, erase, clear and begin() while a
+ *   trace is open, nothing is recorded otherwise
+ * - A record is an operation byte and a 64 bit key: integer keys keep their
+ *   order, signed ones with the sign bit flipped so that negative keys come first,
+ *   other keys are stored as their flat_hash, so a trace of them keeps the
+ *   pattern of equal keys but not their order
+ * - Copies of a traced container have the elements but no trace
+ * - begin() is recorded as a scan of the whole container, values are not recorded
+ * - Records are buffered and written in blocks, an incomplete last record is ignored
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+enum
+{
+	FLAT_TRACE_INSERT = 'I',
+	FLAT_TRACE_FIND = 'F',
+	FLAT_TRACE_LOWER_BOUND = 'L',
+	FLAT_TRACE_ERASE = 'E',
+	FLAT_TRACE_SCAN = 'S',
+	FLAT_TRACE_CLEAR = 'C'
+};
+
+// Keys of a trace, integers keep their order as uint64_t, anything else is hashed
+inline uint64_t flat_trace_signed(long long k) { return static_cast<uint64_t>(k) ^ (static_cast<uint64_t>(1) << 63); }
+inline bool flat_trace_key(unsigned long long k, uint64_t &v) { v = k; return false; }
+inline bool flat_trace_key(long long k, uint64_t &v) { v = flat_trace_signed(k); return false; }
+inline bool flat_trace_key(unsigned long k, uint64_t &v) { v = k; return false; }
+inline bool flat_trace_key(long k, uint64_t &v) { v = flat_trace_signed(k); return false; }
+inline bool flat_trace_key(unsigned int k, uint64_t &v) { v = k; return false; }
+inline bool flat_trace_key(int k, uint64_t &v) { v = flat_trace_signed(k); return false; }
+inline bool flat_trace_key(unsigned short k, uint64_t &v) { v = k; return false; }
+inline bool flat_trace_key(short k, uint64_t &v) { v = flat_trace_signed(k); return false; }
+inline bool flat_trace_key(unsigned char k, uint64_t &v) { v = k; return false; }
+inline bool flat_trace_key(signed char k, uint64_t &v) { v = flat_trace_signed(k); return false; }
+inline bool flat_trace_key(char k, uint64_t &v) { v = std::numeric_limits<char>::is_signed ? flat_trace_signed(k) : static_cast<unsigned char>(k); return false; }
+template<class K>
+inline bool flat_trace_key(const K &k, uint64_t &v) { v = flat_hash()(k); return true; }
+
+struct flat_trace_header
+{
+	uint32_t nMagic;
+	uint32_t nVersion;
+	uint32_t nFlags;
+	uint32_t nKeySize;		// sizeof of the traced key and value types
+	uint32_t nValSize;		// 0 for a set
+
+	enum { MAGIC = 0x43525446, VERSION = 2 };
+	enum { FLAG_HASHED_KEYS = 1, FLAG_SET = 2 };
+};
+
+class flat_trace_writer
+{
+public:
+	flat_trace_writer() : m_pFile(0), m_nRecords(0) {};
+	~flat_trace_writer() { close(); }
+
+	bool open(const std::string &path, bool bHashedKeys, bool bSet, size_t nKeySize, size_t nValSize);
+	// writes the buffered records, the trace is readable up to here
+	bool flush();
+	void close();
+	bool is_open() const { return m_pFile != 0; }
+	size_t records() const { return m_nRecords; }
+
+	void record(char nOp, uint64_t nKey);
+
+private:
+	flat_trace_writer(const flat_trace_writer&);
+	flat_trace_writer &operator=(const flat_trace_writer&);
+
+	enum { RECORD_SIZE = 9, BUFFER_SIZE = 64 * 1024 };
+
+	FILE *m_pFile;
+	std::vector<char> m_buffer;
+	size_t m_nRecords;
+};
+
+class flat_trace_reader
+{
+public:
+	flat_trace_reader() : m_pFile(0) {};
+	~flat_trace_reader() { close(); }
+
+	// false if the file is missing or not a trace
+	bool open(const std::string &path);
+	void close();
+	const flat_trace_header &header() const { return m_header; }
+	bool hashed_keys() const { return (m_header.nFlags & flat_trace_header::FLAG_HASHED_KEYS) != 0; }
+	bool is_set() const { return (m_header.nFlags & flat_trace_header::FLAG_SET) != 0; }
+
+	// the next record, false at the end
+	bool next(char &nOp, uint64_t &nKey);
+
+private:
+	flat_trace_reader(const flat_trace_reader&);
+	flat_trace_reader &operator=(const flat_trace_reader&);
+
+	FILE *m_pFile;
+	flat_trace_header m_header;
+};
+
+template<typename key_type, typename val_type, typename search_type = flat_search_binary, typename allocator_type = std::allocator<std::pair<key_type, val_type> > >
+class flat_traced_map : public flat_map<key_type, val_type, search_type, allocator_type>
+{
+	typedef flat_map<key_type, val_type, search_type, allocator_type> base_type;
+
+public:
+	typedef typename base_type::pair_type pair_type;
+	typedef typename base_type::iterator iterator;
+
+	flat_traced_map() {};
+	flat_traced_map(const flat_traced_map &rhs) : base_type(rhs) {};
+	flat_traced_map &operator=(const flat_traced_map &rhs) { base_type::operator=(rhs); return *this; }
+
+	bool trace_open(const std::string &path);
+	void trace_close() { m_trace.close(); }
+	flat_trace_writer &trace() { return m_trace; }
+
+	void clear() { record(FLAT_TRACE_CLEAR, key_type()); base_type::clear(); }
+	void insert(const pair_type &p) { record(FLAT_TRACE_INSERT, p.first); base_type::insert(p); }
+	void insert(const key_type &k, const val_type &v) { record(FLAT_TRACE_INSERT, k); base_type::insert(k, v); }
+	iterator find(const key_type &k) { record(FLAT_TRACE_FIND, k); return base_type::find(k); }
+#ifdef ENABLE_TEMPLATE_OVERLOADS
+	template <typename U> iterator find(const U &k) { record(FLAT_TRACE_FIND, k); return base_type::find(k); }
+#endif
+	size_t count(const key_type &k) { record(FLAT_TRACE_FIND, k); return base_type::count(k); }
+	iterator lower_bound(const key_type &k) { record(FLAT_TRACE_LOWER_BOUND, k); return base_type::lower_bound(k); }
+	iterator erase(const key_type &k) { record(FLAT_TRACE_ERASE, k); return base_type::erase(k); }
+	iterator erase(iterator i0) { record(FLAT_TRACE_ERASE, i0->first); return base_type::erase(i0); }
+	iterator erase(iterator i0, iterator i1);
+	iterator begin() { record(FLAT_TRACE_SCAN, key_type()); return base_type::begin(); }
+
+private:
+	template<class K>
+	void record(char nOp, const K &k);
+
+	flat_trace_writer m_trace;
+};
+
+template<typename T, typename search_type = flat_search_binary, typename allocator_type = std::allocator<T> >
+class flat_traced_set : public flat_set<T, search_type, allocator_type>
+{
+	typedef flat_set<T, search_type, allocator_type> base_type;
+
+public:
+	typedef typename base_type::iterator iterator;
+
+	flat_traced_set() {};
+	flat_traced_set(const flat_traced_set &rhs) : base_type(rhs) {};
+	flat_traced_set &operator=(const flat_traced_set &rhs) { base_type::operator=(rhs); return *this; }
+
+	bool trace_open(const std::string &path);
+	void trace_close() { m_trace.close(); }
+	flat_trace_writer &trace() { return m_trace; }
+
+	void clear() { record(FLAT_TRACE_CLEAR, T()); base_type::clear(); }
+	void insert(const T &v) { record(FLAT_TRACE_INSERT, v); base_type::insert(v); }
+	iterator find(const T &v) { record(FLAT_TRACE_FIND, v); return base_type::find(v); }
+	size_t count(const T &v) { record(FLAT_TRACE_FIND, v); return base_type::count(v); }
+#ifdef ENABLE_TEMPLATE_OVERLOADS
+	template <typename U> iterator find(const U &v) { record(FLAT_TRACE_FIND, v); return base_type::find(v); }
+	template <typename U> size_t count(const U &v) { record(FLAT_TRACE_FIND, v); return base_type::count(v); }
+#endif
+	iterator lower_bound(const T &v) { record(FLAT_TRACE_LOWER_BOUND, v); return base_type::lower_bound(v); }
+	iterator erase(const T &v) { record(FLAT_TRACE_ERASE, v); return base_type::erase(v); }
+	iterator erase(iterator i0) { record(FLAT_TRACE_ERASE, *i0); return base_type::erase(i0); }
+	iterator erase(iterator i0, iterator i1);
+	iterator begin() { record(FLAT_TRACE_SCAN, T()); return base_type::begin(); }
+
+private:
+	template<class K>
+	void record(char nOp, const K &v);
+
+	flat_trace_writer m_trace;
+};
+
+//------------------------------------- flat_trace_writer -----------------------------------------
+
+inline bool flat_trace_writer::open(const std::string &path, bool bHashedKeys, bool bSet, size_t nKeySize, size_t nValSize)
+{
+	close();
+	m_pFile = fopen(path.c_str(), "wb");
+	if (!m_pFile)
+		return false;
+	flat_trace_header header;
+	header.nMagic = flat_trace_header::MAGIC;
+	header.nVersion = flat_trace_header::VERSION;
+	header.nFlags = (bHashedKeys ? flat_trace_header::FLAG_HASHED_KEYS : 0) | (bSet ? flat_trace_header::FLAG_SET : 0);
+	header.nKeySize = static_cast<uint32_t>(nKeySize);
+	header.nValSize = static_cast<uint32_t>(nValSize);
+	if (fwrite(&header, sizeof(header), 1, m_pFile) != 1)
+	{
+		fclose(m_pFile);
+		m_pFile = 0;
+		return false;
+	}
+	m_buffer.reserve(BUFFER_SIZE);
+	m_nRecords = 0;
+	return true;
+}
+
+inline void flat_trace_writer::record(char nOp, uint64_t nKey)
+{
+	if (!m_pFile)
+		return;
+	size_t nPos = m_buffer.size();
+	m_buffer.resize(nPos + RECORD_SIZE);
+	m_buffer[nPos] = nOp;
+	memcpy(&m_buffer[nPos + 1], &nKey, sizeof(nKey));
+	m_nRecords++;
+	if (m_buffer.size() + RECORD_SIZE > BUFFER_SIZE)
+		flush();
+}
+
+inline bool flat_trace_writer::flush()
+{
+	if (!m_pFile)
+		return false;
+	bool bOk = m_buffer.empty() || fwrite(&m_buffer[0], 1, m_buffer.size(), m_pFile) == m_buffer.size();
+	m_buffer.clear();
+	return fflush(m_pFile) == 0 && bOk;
+}
+
+inline void flat_trace_writer::close()
+{
+	if (!m_pFile)
+		return;
+	flush();
+	fclose(m_pFile);
+	m_pFile = 0;
+}
+
+//------------------------------------- flat_trace_reader -----------------------------------------
+
+inline bool flat_trace_reader::open(const std::string &path)
+{
+	close();
+	m_pFile = fopen(path.c_str(), "rb");
+	if (!m_pFile)
+		return false;
+	if (fread(&m_header, sizeof(m_header), 1, m_pFile) != 1 || m_header.nMagic != flat_trace_header::MAGIC || m_header.nVersion != flat_trace_header::VERSION)
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+inline void flat_trace_reader::close()
+{
+	if (m_pFile)
+		fclose(m_pFile);
+	m_pFile = 0;
+}
+
+inline bool flat_trace_reader::next(char &nOp, uint64_t &nKey)
+{
+	char record[9];
+	if (!m_pFile || fread(record, sizeof(record), 1, m_pFile) != 1)
+		return false;
+	nOp = record[0];
+	memcpy(&nKey, record + 1, sizeof(nKey));
+	return true;
+}
+
+//------------------------------------- flat_traced_map -----------------------------------------
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline bool flat_traced_map<key_type, val_type, search_type, allocator_type>::trace_open(const std::string &path)
+{
+	uint64_t v;
+	return m_trace.open(path, flat_trace_key(key_type(), v), false, sizeof(key_type), sizeof(val_type));
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+inline typename flat_traced_map<key_type, val_type, search_type, allocator_type>::iterator flat_traced_map<key_type, val_type, search_type, allocator_type>::erase(iterator i0, iterator i1)
+{
+	for (iterator it = i0; it != i1; ++it)
+		record(FLAT_TRACE_ERASE, it->first);
+	return base_type::erase(i0, i1);
+}
+
+template<typename key_type, typename val_type, typename search_type, typename allocator_type>
+template<class K>
+inline void flat_traced_map<key_type, val_type, search_type, allocator_type>::record(char nOp, const K &k)
+{
+	if (!m_trace.is_open())
+		return;
+	uint64_t v = 0;
+	if (nOp != FLAT_TRACE_SCAN && nOp != FLAT_TRACE_CLEAR)
+		flat_trace_key(k, v);
+	m_trace.record(nOp, v);
+}
+
+//------------------------------------- flat_traced_set -----------------------------------------
+
+template<typename T, typename search_type, typename allocator_type>
+inline bool flat_traced_set<T, search_type, allocator_type>::trace_open(const std::string &path)
+{
+	uint64_t v;
+	return m_trace.open(path, flat_trace_key(T(), v), true, sizeof(T), 0);
+}
+
+template<typename T, typename search_type, typename allocator_type>
+inline typename flat_traced_set<T, search_type, allocator_type>::iterator flat_traced_set<T, search_type, allocator_type>::erase(iterator i0, iterator i1)
+{
+	for (iterator it = i0; it != i1; ++it)
+		record(FLAT_TRACE_ERASE, *it);
+	return base_type::erase(i0, i1);
+}
+
+template<typename T, typename search_type, typename allocator_type>
+template<class K>
+inline void flat_traced_set<T, search_type, allocator_type>::record(char nOp, const K &v)
+{
+	if (!m_trace.is_open())
+		return;
+	uint64_t nKey = 0;
+	if (nOp != FLAT_TRACE_SCAN && nOp != FLAT_TRACE_CLEAR)
+		flat_trace_key(v, nKey);
+	m_trace.record(nOp, nKey);
+}
+
+#endif // _FLAT_TRACE_H_INCLUDED_2026_10_19
@@ -0,0 +1,428 @@
+#ifndef _FLAT_VERSIONED_MAP_H_INCLUDED_2026_10_19
+#define _FLAT_VERSIONED_MAP_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <iterator>
+#include "flat_search.h"
+
+/*
+ * Map with cheap snapshots, based on shared sorted chunks (C++11)
+ *
+ * Flat versioned map features
+ * - Elements are stored in sorted chunks of at most nChunkSize elements, with
+ *   the first key of every chunk in a fence array, as in flat_blocked_map
+ * - Chunks are reference counted: snapshot() copies the chunk pointers and the
+ *   fences only, a change clones the chunks it touches when they are shared
+ * - The cost of a snapshot depends on the number of chunks, the memory of the
+ *   snapshots on the number of chunks changed since they were taken
+ * - Iterators are read only, values are changed by insert(), the last one wins
+ * - The map is changed by one thread which also takes the snapshots, a snapshot
+ *   can then be read by any number of threads
+ * - version() counts the changes, a snapshot keeps the version it was taken at
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+template<typename key_type, typename val_type, size_t nChunkSize = 256>
+class flat_versioned_map
+{
+	static_assert(nChunkSize >= 2, "a full chunk is split in two halves");
+
+public:
+	typedef std::pair<key_type, val_type> pair_type;
+	typedef std::vector<pair_type> chunk_type;
+	typedef std::vector<std::shared_ptr<chunk_type> > chunks_type;
+
+	// Bidirectional read only iterator, a chunk index and a position inside the chunk
+	class iterator
+	{
+	public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef pair_type value_type;
+		typedef ptrdiff_t difference_type;
+		typedef const pair_type* pointer;
+		typedef const pair_type& reference;
+
+		iterator() : m_pChunks(nullptr), m_nChunk(0), m_nPos(0) {};
+
+		const pair_type& operator* () const { return (*(*m_pChunks)[m_nChunk])[m_nPos]; }
+		const pair_type* operator-> () const { return &(*(*m_pChunks)[m_nChunk])[m_nPos]; }
+		iterator& operator++ ();
+		iterator& operator-- ();
+		iterator operator++ (int) { iterator it(*this); ++(*this); return it; }
+		iterator operator-- (int) { iterator it(*this); --(*this); return it; }
+		bool operator== (const iterator& rhs) const { return m_nChunk == rhs.m_nChunk && m_nPos == rhs.m_nPos; }
+		bool operator!= (const iterator& rhs) const { return !(*this == rhs); }
+
+	private:
+		friend class flat_versioned_map;
+		iterator(const chunks_type *pChunks, size_t nChunk, size_t nPos) : m_pChunks(pChunks), m_nChunk(nChunk), m_nPos(nPos) {};
+
+		const chunks_type *m_pChunks;
+		size_t m_nChunk;
+		size_t m_nPos;
+	};
+	typedef std::pair<iterator, iterator> iterator_pair;
+
+	flat_versioned_map() : m_nSize(0), m_nVersion(0) {};
+
+	void clear();
+	void insert(const pair_type &p);
+	void insert(const key_type &k, const val_type &v);
+	// replaces the elements by [first, last), which must be sorted by key without duplicates
+	template<class It>
+	void assign_sorted(It first, It last);
+	iterator find(const key_type &k) const;
+	iterator lower_bound(const key_type &k) const;
+	iterator upper_bound(const key_type &k) const;
+	iterator_pair equal_range(const key_type &k) const;
+	size_t count(const key_type &k) const;
+	bool empty() const { return m_nSize == 0; }
+	size_t size() const { return m_nSize; }
+	iterator erase(const key_type &k);
+	iterator erase(iterator i0);
+	iterator erase(iterator i0, iterator i1);
+	void swap(flat_versioned_map& other);
+
+	iterator begin() const { return iterator(&m_chunks, 0, 0); }
+	iterator end() const { return iterator(&m_chunks, m_chunks.size(), 0); }
+
+	// a copy sharing all chunks with the map
+	flat_versioned_map snapshot() const { return *this; }
+	unsigned long long version() const { return m_nVersion; }
+
+	size_t chunks() const { return m_chunks.size(); }
+	// chunks used by a snapshot or another map as well
+	size_t shared_chunks() const;
+	// a shared chunk is counted by its share only
+	size_t memory_usage() const;
+
+private:
+	size_t find_chunk(const key_type &k) const;
+	iterator make_iterator(size_t nChunk, size_t nPos) const;
+	chunk_type &mutable_chunk(size_t nChunk);
+	void insert_chunk(size_t nChunk);
+	void remove_chunk(size_t nChunk);
+
+	chunks_type m_chunks;
+	std::vector<key_type> m_fences;		// first key of every chunk
+	size_t m_nSize;
+	unsigned long long m_nVersion;
+};
+
+//------------------------------------- iterator -----------------------------------------
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_versioned_map<key_type, val_type, nChunkSize>::iterator& flat_versioned_map<key_type, val_type, nChunkSize>::iterator::operator++ ()
+{
+	if (++m_nPos == (*m_pChunks)[m_nChunk]->size())
+	{
+		m_nChunk++;
+		m_nPos = 0;
+	}
+	return *this;
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_versioned_map<key_type, val_type, nChunkSize>::iterator& flat_versioned_map<key_type, val_type, nChunkSize>::iterator::operator-- ()
+{
+	if (m_nPos == 0)
+		m_nPos = (*m_pChunks)[--m_nChunk]->size();
+	m_nPos--;
+	return *this;
+}
+
+//------------------------------------- flat_versioned_map -----------------------------------------
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline void flat_versioned_map<key_type, val_type, nChunkSize>::clear()
+{
+	m_chunks.clear();
+	m_fences.clear();
+	m_nSize = 0;
+	m_nVersion++;
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline size_t flat_versioned_map<key_type, val_type, nChunkSize>::find_chunk(const key_type &k) const
+{
+	// the last chunk with a fence not greater than k, or the first chunk
+	size_t n = std::upper_bound(m_fences.begin(), m_fences.end(), k) - m_fences.begin();
+	return n ? n - 1 : 0;
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_versioned_map<key_type, val_type, nChunkSize>::iterator flat_versioned_map<key_type, val_type, nChunkSize>::make_iterator(size_t nChunk, size_t nPos) const
+{
+	if (nChunk < m_chunks.size() && nPos == m_chunks[nChunk]->size())
+	{
+		nChunk++;
+		nPos = 0;
+	}
+	return iterator(&m_chunks, nChunk, nPos);
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_versioned_map<key_type, val_type, nChunkSize>::chunk_type &flat_versioned_map<key_type, val_type, nChunkSize>::mutable_chunk(size_t nChunk)
+{
+	// only the writer thread holds pointers it could copy, so a count of 1 cannot grow meanwhile
+	if (m_chunks[nChunk].use_count() > 1)
+	{
+		std::shared_ptr<chunk_type> p = std::make_shared<chunk_type>();
+		p->reserve(nChunkSize);
+		p->assign(m_chunks[nChunk]->begin(), m_chunks[nChunk]->end());
+		m_chunks[nChunk].swap(p);
+	}
+	else
+	{
+		// use_count() is a relaxed load: the reads of the last snapshot that released
+		// the chunk must happen before the writes below
+		std::atomic_thread_fence(std::memory_order_acquire);
+	}
+	return *m_chunks[nChunk];
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline void flat_versioned_map<key_type, val_type, nChunkSize>::insert_chunk(size_t nChunk)
+{
+	std::shared_ptr<chunk_type> p = std::make_shared<chunk_type>();
+	p->reserve(nChunkSize);
+	m_chunks.insert(m_chunks.begin() + nChunk, p);
+	m_fences.insert(m_fences.begin() + nChunk, key_type());
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline void flat_versioned_map<key_type, val_type, nChunkSize>::remove_chunk(size_t nChunk)
+{
+	m_chunks.erase(m_chunks.begin() + nChunk);
+	m_fences.erase(m_fences.begin() + nChunk);
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline void flat_versioned_map<key_type, val_type, nChunkSize>::insert(const pair_type &p)
+{
+	m_nVersion++;
+	if (m_chunks.empty())
+	{
+		insert_chunk(0);
+		m_chunks[0]->push_back(p);
+		m_fences[0] = p.first;
+		m_nSize = 1;
+		return;
+	}
+
+	size_t c = find_chunk(p.first);
+	const chunk_type &chunk = *m_chunks[c];
+	size_t nPos = std::lower_bound(chunk.begin(), chunk.end(), p.first, flat_search_less_elem<key_type, flat_key_first>(flat_key_first())) - chunk.begin();
+	if (nPos != chunk.size() && !(p.first < chunk[nPos].first))
+	{
+		mutable_chunk(c)[nPos].second = p.second;
+		return;
+	}
+
+	if (chunk.size() == nChunkSize)
+	{
+		// splitting a full chunk in halves, the shared one is left to the snapshots
+		size_t nHalf = nChunkSize / 2;
+		insert_chunk(c + 1);
+		std::shared_ptr<chunk_type> pFull = m_chunks[c];
+		m_chunks[c + 1]->assign(pFull->begin() + nHalf, pFull->end());
+		if (pFull.use_count() > 2)
+		{
+			m_chunks[c] = std::make_shared<chunk_type>();
+			m_chunks[c]->reserve(nChunkSize);
+			m_chunks[c]->assign(pFull->begin(), pFull->begin() + nHalf);
+		}
+		else
+		{
+			std::atomic_thread_fence(std::memory_order_acquire);
+			m_chunks[c]->resize(nHalf);
+		}
+		m_fences[c + 1] = (*m_chunks[c + 1])[0].first;
+		if (nPos > nHalf)
+		{
+			c++;
+			nPos -= nHalf;
+		}
+	}
+	chunk_type &target = mutable_chunk(c);
+	target.insert(target.begin() + nPos, p);
+	if (nPos == 0) m_fences[c] = p.first;
+	m_nSize++;
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline void flat_versioned_map<key_type, val_type, nChunkSize>::insert(const key_type &k, const val_type &v)
+{
+	insert(std::make_pair(k, v));
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+template<class It>
+inline void flat_versioned_map<key_type, val_type, nChunkSize>::assign_sorted(It first, It last)
+{
+	// chunks are filled to 3/4 so the first inserts do not split them
+	size_t nFill = nChunkSize - nChunkSize / 4;
+	if (nFill == 0) nFill = 1;
+	clear();
+	while (first != last)
+	{
+		insert_chunk(m_chunks.size());
+		chunk_type &chunk = *m_chunks.back();
+		for (; first != last && chunk.size() < nFill; ++first)
+			chunk.push_back(*first);
+		m_fences.back() = chunk[0].first;
+		m_nSize += chunk.size();
+	}
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_versioned_map<key_type, val_type, nChunkSize>::iterator flat_versioned_map<key_type, val_type, nChunkSize>::lower_bound(const key_type &k) const
+{
+	if (m_chunks.empty()) return end();
+	size_t c = find_chunk(k);
+	const chunk_type &chunk = *m_chunks[c];
+	typename chunk_type::const_iterator it = std::lower_bound(chunk.begin(), chunk.end(), k, flat_search_less_elem<key_type, flat_key_first>(flat_key_first()));
+	return make_iterator(c, it - chunk.begin());
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_versioned_map<key_type, val_type, nChunkSize>::iterator flat_versioned_map<key_type, val_type, nChunkSize>::upper_bound(const key_type &k) const
+{
+	if (m_chunks.empty()) return end();
+	size_t c = find_chunk(k);
+	const chunk_type &chunk = *m_chunks[c];
+	typename chunk_type::const_iterator it = std::upper_bound(chunk.begin(), chunk.end(), k, flat_search_less_key<key_type, flat_key_first>(flat_key_first()));
+	return make_iterator(c, it - chunk.begin());
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_versioned_map<key_type, val_type, nChunkSize>::iterator flat_versioned_map<key_type, val_type, nChunkSize>::find(const key_type &k) const
+{
+	iterator it = lower_bound(k);
+	if (it == end() || k < it->first)
+		return end();
+	return it;
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_versioned_map<key_type, val_type, nChunkSize>::iterator_pair flat_versioned_map<key_type, val_type, nChunkSize>::equal_range(const key_type &k) const
+{
+	iterator it = find(k);
+	if (it == end())
+		return iterator_pair(lower_bound(k), lower_bound(k));
+	iterator it1 = it;
+	return iterator_pair(it, ++it1);
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline size_t flat_versioned_map<key_type, val_type, nChunkSize>::count(const key_type &k) const
+{
+	if (find(k) == end()) return 0;
+	return 1;
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_versioned_map<key_type, val_type, nChunkSize>::iterator flat_versioned_map<key_type, val_type, nChunkSize>::erase(const key_type &k)
+{
+	iterator it = find(k);
+	if (it == end()) return it;
+	return erase(it);
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_versioned_map<key_type, val_type, nChunkSize>::iterator flat_versioned_map<key_type, val_type, nChunkSize>::erase(iterator i0)
+{
+	size_t c = i0.m_nChunk;
+	size_t nPos = i0.m_nPos;
+	m_nVersion++;
+	m_nSize--;
+	if (m_chunks[c]->size() == 1)
+	{
+		remove_chunk(c);
+		return make_iterator(c, 0);
+	}
+	chunk_type &chunk = mutable_chunk(c);
+	chunk.erase(chunk.begin() + nPos);
+	if (nPos == 0) m_fences[c] = chunk[0].first;
+
+	// merging a small chunk with the smaller of its neighbours
+	if (chunk.size() < nChunkSize / 4 && m_chunks.size() > 1)
+	{
+		bool bPrev = c > 0 && (c + 1 == m_chunks.size() || m_chunks[c - 1]->size() < m_chunks[c + 1]->size());
+		size_t nLeft = bPrev ? c - 1 : c;
+		if (m_chunks[nLeft]->size() + m_chunks[nLeft + 1]->size() <= nChunkSize)
+		{
+			if (bPrev) nPos += m_chunks[nLeft]->size();
+			chunk_type &left = mutable_chunk(nLeft);
+			left.insert(left.end(), m_chunks[nLeft + 1]->begin(), m_chunks[nLeft + 1]->end());
+			remove_chunk(nLeft + 1);
+			c = nLeft;
+		}
+	}
+	return make_iterator(c, nPos);
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline typename flat_versioned_map<key_type, val_type, nChunkSize>::iterator flat_versioned_map<key_type, val_type, nChunkSize>::erase(iterator i0, iterator i1)
+{
+	size_t n = std::distance(i0, i1);
+	for (size_t i = 0; i < n; i++)
+		i0 = erase(i0);
+	return i0;
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline void flat_versioned_map<key_type, val_type, nChunkSize>::swap(flat_versioned_map<key_type, val_type, nChunkSize>& other)
+{
+	m_chunks.swap(other.m_chunks);
+	m_fences.swap(other.m_fences);
+	std::swap(m_nSize, other.m_nSize);
+	std::swap(m_nVersion, other.m_nVersion);
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline size_t flat_versioned_map<key_type, val_type, nChunkSize>::shared_chunks() const
+{
+	size_t n = 0;
+	for (size_t i = 0; i < m_chunks.size(); i++)
+		if (m_chunks[i].use_count() > 1)
+			n++;
+	return n;
+}
+
+template<typename key_type, typename val_type, size_t nChunkSize>
+inline size_t flat_versioned_map<key_type, val_type, nChunkSize>::memory_usage() const
+{
+	size_t n = m_chunks.capacity()*sizeof(std::shared_ptr<chunk_type>) + m_fences.capacity()*sizeof(key_type);
+	for (size_t i = 0; i < m_chunks.size(); i++)
+		n += m_chunks[i]->capacity()*sizeof(pair_type) / m_chunks[i].use_count();
+	return n;
+}
+
+#endif // _FLAT_VERSIONED_MAP_H_INCLUDED_2026_10_19
@@ -0,0 +1,257 @@
+#ifndef _SMALL_FLAT_MAP_H_INCLUDED_2026_10_19
+#define _SMALL_FLAT_MAP_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <algorithm>
+#include "flat_search.h"
+#include "flat_small_vector.h"
+
+/*
+ * Minimalistic map C++ template with inline storage for a few elements
+ *
+ * Small flat map features
+ * - Up to N elements are stored inside the object, no heap allocation
+ * - Below N elements insert() keeps the elements sorted, lookups never sort
+ * - A duplicate key replaces the value of the stored one, the last one wins
+ * - Beyond N elements works as flat_map: adds are appended and sorted on lookup
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+template<typename key_type, typename val_type, size_t N = 16>
+class small_flat_map
+{
+public:
+	typedef std::pair<key_type, val_type> pair_type;
+	typedef typename flat_small_vector<pair_type, N>::iterator iterator;
+	typedef std::pair<iterator, iterator> iterator_pair;
+
+	small_flat_map() : m_bSorted(true) {};
+
+	void clear();
+	void reserve(size_t size);
+	void insert(const pair_type &p);
+	void insert(const key_type &k, const val_type &v);
+	iterator find(const key_type &k);
+	iterator lower_bound(const key_type &k);
+	iterator upper_bound(const key_type &k);
+	iterator_pair equal_range(const key_type &k);
+	size_t count(const key_type &k);
+	bool empty();
+	size_t size();
+	iterator erase(const key_type &k);
+	iterator erase(iterator i0);
+	iterator erase(iterator i0, iterator i1);
+	void swap(small_flat_map& other);
+
+	iterator begin();
+	iterator end();
+
+	bool is_inline() const { return ar.is_inline(); }
+
+	void sort();
+
+private:
+	template<class T>
+	struct small_flat_map_less_key
+	{
+		bool operator() (const T& lhs, const T& rhs) const
+		{
+			return lhs.first < rhs.first;
+		}
+	};
+
+	iterator lower_bound_sorted(const key_type &k);
+
+	flat_small_vector<pair_type, N> ar;
+	bool m_bSorted;
+};
+
+//------------------------------------- small_flat_map -----------------------------------------
+
+template<typename key_type, typename val_type, size_t N>
+inline void small_flat_map<key_type, val_type, N>::clear()
+{
+	ar.clear();
+	m_bSorted = true;
+}
+
+template<typename key_type, typename val_type, size_t N>
+inline void small_flat_map<key_type, val_type, N>::reserve(size_t size)
+{
+	ar.reserve(size);
+}
+
+template<typename key_type, typename val_type, size_t N>
+inline void small_flat_map<key_type, val_type, N>::insert(const pair_type &p)
+{
+	if (m_bSorted)
+	{
+		// sorted insertion, elements are moved inside the inline buffer only
+		iterator it = lower_bound_sorted(p.first);
+		if (it != ar.end() && !(p.first < it->first))
+		{
+			it->second = p.second;
+			return;
+		}
+		if (ar.size() < N)
+		{
+			ar.insert(it, p);
+			return;
+		}
+	}
+	ar.push_back(p);
+	m_bSorted = false;
+}
+
+template<typename key_type, typename val_type, size_t N>
+inline void small_flat_map<key_type, val_type, N>::insert(const key_type &k, const val_type &v)
+{
+	insert(std::make_pair(k, v));
+}
+
+template<typename key_type, typename val_type, size_t N>
+inline typename small_flat_map<key_type, val_type, N>::iterator small_flat_map<key_type, val_type, N>::lower_bound_sorted(const key_type &k)
+{
+	return std::lower_bound(ar.begin(), ar.end(), k, flat_search_less_elem<key_type, flat_key_first>(flat_key_first()));
+}
+
+template<typename key_type, typename val_type, size_t N>
+inline typename small_flat_map<key_type, val_type, N>::iterator small_flat_map<key_type, val_type, N>::find(const key_type &k)
+{
+	if (!m_bSorted) sort();
+	iterator it = lower_bound_sorted(k);
+	if (it != ar.end() && k < it->first)
+		return ar.end();
+	return it;
+}
+
+template<typename key_type, typename val_type, size_t N>
+inline typename small_flat_map<key_type, val_type, N>::iterator small_flat_map<key_type, val_type, N>::lower_bound(const key_type &k)
+{
+	if (!m_bSorted) sort();
+	return lower_bound_sorted(k);
+}
+
+template<typename key_type, typename val_type, size_t N>
+inline typename small_flat_map<key_type, val_type, N>::iterator small_flat_map<key_type, val_type, N>::upper_bound(const key_type &k)
+{
+	if (!m_bSorted) sort();
+	return std::upper_bound(ar.begin(), ar.end(), k, flat_search_less_key<key_type, flat_key_first>(flat_key_first()));
+}
+
+template<typename key_type, typename val_type, size_t N>
+inline typename small_flat_map<key_type, val_type, N>::iterator_pair small_flat_map<key_type, val_type, N>::equal_range(const key_type &k)
+{
+	iterator it = find(k);
+	if (it == ar.end())
+		return iterator_pair(it, it);
+	return iterator_pair(it, it + 1);
+}
+
+template<typename key_type, typename val_type, size_t N>
+inline size_t small_flat_map<key_type, val_type, N>::count(const key_type &k)
+{
+	if (find(k) == ar.end()) return 0;
+	return 1;
+}
+
+template<typename key_type, typename val_type, size_t N>
+inline size_t small_flat_map<key_type, val_type, N>::size()
+{
+	if (!m_bSorted) sort();
+	return ar.size();
+}
+
+template<typename key_type, typename val_type, size_t N>
+inline bool small_flat_map<key_type, val_type, N>::empty()
+{
+	return ar.size()==0;
+}
+
+template<typename key_type, typename val_type, size_t N>
+inline typename small_flat_map<key_type, val_type, N>::iterator small_flat_map<key_type, val_type, N>::erase(const key_type &k)
+{
+	iterator it = find(k);
+	if (it == ar.end()) return it;
+	return ar.erase(it);
+}
+
+template<typename key_type, typename val_type, size_t N>
+inline typename small_flat_map<key_type, val_type, N>::iterator small_flat_map<key_type, val_type, N>::erase(iterator i0)
+{
+	return ar.erase(i0);
+}
+
+template<typename key_type, typename val_type, size_t N>
+inline typename small_flat_map<key_type, val_type, N>::iterator small_flat_map<key_type, val_type, N>::erase(iterator i0, iterator i1)
+{
+	return ar.erase(i0, i1);
+}
+
+template<typename key_type, typename val_type, size_t N>
+inline void small_flat_map<key_type, val_type, N>::swap(small_flat_map<key_type, val_type, N>& other)
+{
+	std::swap(m_bSorted, other.m_bSorted);
+	ar.swap(other.ar);
+}
+
+template<typename key_type, typename val_type, size_t N>
+inline typename small_flat_map<key_type, val_type, N>::iterator small_flat_map<key_type, val_type, N>::begin()
+{
+	if (!m_bSorted) sort();
+	return ar.begin();
+}
+
+template<typename key_type, typename val_type, size_t N>
+inline typename small_flat_map<key_type, val_type, N>::iterator small_flat_map<key_type, val_type, N>::end()
+{
+	if (!m_bSorted) sort();
+	return ar.end();
+}
+
+template<typename key_type, typename val_type, size_t N>
+void inline small_flat_map<key_type, val_type, N>::sort()
+{
+	m_bSorted = true;
+	if (ar.size() < 2) return;
+	iterator i0 = ar.begin();
+	iterator i1 = ar.end();
+	std::stable_sort(i0, i1, small_flat_map_less_key<pair_type>());
+
+	// keeping the last added value of each key
+	iterator out = i0;
+	for (iterator it = i0; it != i1; )
+	{
+		iterator last = it;
+		while (++it != i1 && !(last->first < it->first))
+			last = it;
+		if (out != last) *out = *last;
+		++out;
+	}
+	ar.erase(out, i1);
+}
+
+#endif // _SMALL_FLAT_MAP_H_INCLUDED_2026_10_19
@@ -0,0 +1,216 @@
+#ifndef _SMALL_FLAT_SET_H_INCLUDED_2026_10_19
+#define _SMALL_FLAT_SET_H_INCLUDED_2026_10_19
+
+#include <vector>
+#include <algorithm>
+#include "flat_small_vector.h"
+
+/*
+ * Minimalistic set C++ template with inline storage for a few elements
+ *
+ * Small flat set features
+ * - Up to N elements are stored inside the object, no heap allocation
+ * - Below N elements insert() keeps the elements sorted, lookups never sort
+ * - Beyond N elements works as flat_set: adds are appended and sorted on lookup
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Ruslan Yushchenko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * For more information, please refer to <http://opensource.org/licenses/MIT>
+ */
+
+template<typename T, size_t N = 16>
+class small_flat_set
+{
+public:
+	typedef typename flat_small_vector<T, N>::iterator iterator;
+	typedef std::pair<iterator, iterator> iterator_pair;
+
+	small_flat_set() : m_bSorted(true) {};
+
+	void clear();
+	void reserve(size_t size);
+	void insert(const T &v);
+	iterator find(const T &v);
+	iterator lower_bound(const T &v);
+	iterator upper_bound(const T &v);
+	iterator_pair equal_range(const T &v);
+	size_t count(const T &v);
+	bool empty();
+	size_t size();
+	iterator erase(const T &v);
+	iterator erase(iterator i0);
+	iterator erase(iterator i0, iterator i1);
+	void swap(small_flat_set& other);
+
+	iterator begin();
+	iterator end();
+
+	bool is_inline() const { return ar.is_inline(); }
+
+	void sort();
+
+private:
+	flat_small_vector<T, N> ar;
+	bool m_bSorted;
+};
+
+//------------------------------------- small_flat_set -----------------------------------------
+
+template<typename T, size_t N>
+inline void small_flat_set<T, N>::clear()
+{
+	ar.clear();
+	m_bSorted = true;
+}
+
+template<typename T, size_t N>
+inline void small_flat_set<T, N>::reserve(size_t size)
+{
+	ar.reserve(size);
+}
+
+template<typename T, size_t N>
+inline void small_flat_set<T, N>::insert(const T &v)
+{
+	if (m_bSorted)
+	{
+		// sorted insertion, elements are moved inside the inline buffer only
+		iterator it = std::lower_bound(ar.begin(), ar.end(), v);
+		if (it != ar.end() && !(v < *it))
+			return;
+		if (ar.size() < N)
+		{
+			ar.insert(it, v);
+			return;
+		}
+	}
+	ar.push_back(v);
+	m_bSorted = false;
+}
+
+template<typename T, size_t N>
+inline typename small_flat_set<T, N>::iterator small_flat_set<T, N>::find(const T &v)
+{
+	if (!m_bSorted) sort();
+	iterator it = std::lower_bound(ar.begin(), ar.end(), v);
+	if (it != ar.end() && v < *it)
+		return ar.end();
+	return it;
+}
+
+template<typename T, size_t N>
+inline typename small_flat_set<T, N>::iterator small_flat_set<T, N>::lower_bound(const T &v)
+{
+	if (!m_bSorted) sort();
+	return std::lower_bound(ar.begin(), ar.end(), v);
+}
+
+template<typename T, size_t N>
+inline typename small_flat_set<T, N>::iterator small_flat_set<T, N>::upper_bound(const T &v)
+{
+	if (!m_bSorted) sort();
+	return std::upper_bound(ar.begin(), ar.end(), v);
+}
+
+template<typename T, size_t N>
+inline typename small_flat_set<T, N>::iterator_pair small_flat_set<T, N>::equal_range(const T &v)
+{
+	iterator it = find(v);
+	if (it == ar.end())
+		return iterator_pair(it, it);
+	return iterator_pair(it, it + 1);
+}
+
+template<typename T, size_t N>
+inline size_t small_flat_set<T, N>::count(const T &v)
+{
+	if (find(v) == ar.end()) return 0;
+	return 1;
+}
+
+template<typename T, size_t N>
+inline size_t small_flat_set<T, N>::size()
+{
+	if (!m_bSorted) sort();
+	return ar.size();
+}
+
+template<typename T, size_t N>
+inline bool small_flat_set<T, N>::empty()
+{
+	return ar.size()==0;
+}
+
+template<typename T, size_t N>
+inline typename small_flat_set<T, N>::iterator small_flat_set<T, N>::erase(const T &v)
+{
+	iterator it = find(v);
+	if (it == ar.end()) return it;
+	return ar.erase(it);
+}
+
+template<typename T, size_t N>
+inline typename small_flat_set<T, N>::iterator small_flat_set<T, N>::erase(iterator i0)
+{
+	return ar.erase(i0);
+}
+
+template<typename T, size_t N>
+inline typename small_flat_set<T, N>::iterator small_flat_set<T, N>::erase(iterator i0, iterator i1)
+{
+	return ar.erase(i0, i1);
+}
+
+template<typename T, size_t N>
+inline void small_flat_set<T, N>::swap(small_flat_set<T, N>& other)
+{
+	std::swap(m_bSorted, other.m_bSorted);
+	ar.swap(other.ar);
+}
+
+template<typename T, size_t N>
+inline typename small_flat_set<T, N>::iterator small_flat_set<T, N>::begin()
+{
+	if (!m_bSorted) sort();
+	return ar.begin();
+}
+
+template<typename T, size_t N>
+inline typename small_flat_set<T, N>::iterator small_flat_set<T, N>::end()
+{
+	if (!m_bSorted) sort();
+	return ar.end();
+}
+
+template<typename T, size_t N>
+void inline small_flat_set<T, N>::sort()
+{
+	m_bSorted = true;
+	if (ar.size() < 2) return;
+	iterator i0 = ar.begin();
+	iterator i1 = ar.end();
+	std::sort(i0, i1);
+	ar.erase(std::unique(i0, i1), i1);
+}
+
+#endif // _SMALL_FLAT_SET_H_INCLUDED_2026_10_19